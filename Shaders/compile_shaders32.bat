@@ -1,3 +1,6 @@
 %VULKAN_SDK%/Bin32/glslangValidator.exe -V shader.vert
+%VULKAN_SDK%/Bin32/glslangValidator.exe -V -DINSTANCED shader.vert -o vert_instanced.spv
 %VULKAN_SDK%/Bin32/glslangValidator.exe -V shader.frag
+%VULKAN_SDK%/Bin32/glslangValidator.exe -V cull.comp -o cull.spv
+%VULKAN_SDK%/Bin32/glslangValidator.exe -V cull_clusters.comp -o cull_clusters.spv
 pause
\ No newline at end of file
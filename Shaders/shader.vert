@@ -1,18 +1,67 @@
 #version 450        // Use GLSL 4.5
 
-layout(location = 0) in vec3 pos;
-layout(location = 1) in vec3 col;
+layout(location = 0) in vec3 pos;     // Float, or snorm16 inside the mesh bounding box (VertexFormat::Quantized)
+layout(location = 1) in vec3 col;     // Float or unorm8
 
-layout(binding = 0) uniform MVP {
+#ifdef INSTANCED
+// Per-instance data (binding 1, instance rate): compiled to vert_instanced.spv with -DINSTANCED
+layout(location = 2) in mat4 instanceTransform;     // Locations 2 to 5 (a column each)
+layout(location = 6) in vec4 instanceColour;
+#endif
+
+layout(set = 0, binding = 0) uniform UboViewProjection {
 	mat4 projection;
 	mat4 view;
+} uboViewProjection;
+
+// Per-object data (UboModel on the CPU side): Model matrix and dequantization of the vertex positions
+// (position = positionOffset + pos * positionScale: offset 0 and scale 1 for float vertices)
+struct ModelData {
 	mat4 model;
-} mvp;
+	vec4 positionOffset;
+	vec4 positionScale;
+};
+
+// Dynamic uniform buffer: the offset of the object being drawn is given when binding the descriptor set
+layout(set = 0, binding = 1) uniform UboModel {
+	ModelData data;
+} uboModel;
+
+// Storage buffer: all the objects, the one being drawn is at its instance index (firstInstance of the draw)
+layout(set = 0, binding = 2) readonly buffer ModelStorage {
+	ModelData models[];
+} modelStorage;
+
+layout(push_constant) uniform PushModel {
+	ModelData data;
+} pushModel;
+
+// Where the Model matrix is read from (ModelTransfer), chosen when the pipeline is created:
+// 0 = push constant, 1 = dynamic uniform buffer, 2 = storage buffer
+layout(constant_id = 0) const int MODEL_SOURCE = 0;
 
 layout(location = 0) out vec3 fragColour;   // Output colour for vertex (layout location is required for Vulkan SPIR-V)
 
 void main() {
-    gl_Position = mvp.projection * mvp.view * mvp.model * vec4(pos, 1.0);
+    ModelData object;
+    if (MODEL_SOURCE == 0) {
+        object = pushModel.data;
+    } else if (MODEL_SOURCE == 1) {
+        object = uboModel.data;
+    } else {
+        object = modelStorage.models[gl_InstanceIndex];
+    }
+
+    mat4 model = object.model;
+#ifdef INSTANCED
+    model = model * instanceTransform;
+#endif
+    vec3 position = object.positionOffset.xyz + pos * object.positionScale.xyz;
+    gl_Position = uboViewProjection.projection * uboViewProjection.view * model * vec4(position, 1.0);
 
+#ifdef INSTANCED
+    fragColour = col * instanceColour.rgb;
+#else
     fragColour = col;
+#endif
 }
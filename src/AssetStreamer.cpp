@@ -0,0 +1,203 @@
+#include "AssetStreamer.h"
+
+// C++ STL
+#include <iostream>
+#include <stdexcept>
+
+// Project includes
+#include "MeshCache.h"
+
+// Disable warning about Vulkan unscoped enums for this entire file
+#pragma warning( push )
+#pragma warning(disable : 26812) // The enum type * is unscoped. Prefer 'enum class' over 'enum'.
+
+//------------------------------------------------------------------------------
+EncodedMeshData StreamedMesh::getMeshData() const
+{
+    EncodedMeshData data = meshData;
+    data.vertexData = vertexData.data();
+    data.indexData = indexData.data();
+    return data;
+}
+
+//------------------------------------------------------------------------------
+AssetStreamer::AssetStreamer()
+{
+}
+//------------------------------------------------------------------------------
+void AssetStreamer::init(ThreadPool * threadPool, VertexFormat vertexFormat)
+{
+    m_threadPool = threadPool;
+    m_vertexFormat = vertexFormat;
+    m_stopping = false;
+}
+//------------------------------------------------------------------------------
+void AssetStreamer::destroy()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_stopping = true;
+    m_requests.clear();
+
+    // The queued tasks still run (and return right away): wait for all of them
+    m_tasksDone.wait(lock, [this]() { return m_taskCount == 0; });
+    m_decoded.clear();
+}
+//------------------------------------------------------------------------------
+void AssetStreamer::request(const std::string &filename, const glm::mat4 &model, int priority)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        StreamRequest streamRequest;
+        streamRequest.filename = filename;
+        streamRequest.model = model;
+        streamRequest.priority = priority;
+        m_requests.push_back(streamRequest);
+        m_taskCount++;
+    }
+
+    // One task per request, but each task reads the best request when it starts (not necessarily this one)
+    m_threadPool->submit([this]() { loadNext(); });
+}
+//------------------------------------------------------------------------------
+std::vector<StreamedMesh> AssetStreamer::takeDecoded(VkDeviceSize maxBytes, const glm::vec3 &cameraPosition)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cameraPosition = cameraPosition;
+
+    std::vector<StreamedMesh> meshes;
+    VkDeviceSize takenBytes = 0;
+    while (!m_decoded.empty())
+    {
+        // Closest to the camera now (the camera may have moved since the mesh was decoded)
+        size_t best = 0;
+        for (size_t i = 1; i < m_decoded.size(); i++)
+        {
+            glm::vec3 position = glm::vec3(m_decoded[i].model * glm::vec4(glm::vec3(m_decoded[i].meshData.boundingSphere), 1.0f));
+            glm::vec3 bestPosition = glm::vec3(m_decoded[best].model * glm::vec4(glm::vec3(m_decoded[best].meshData.boundingSphere), 1.0f));
+            if (isBetter(m_decoded[i].priority, position, m_decoded[best].priority, bestPosition))
+            {
+                best = i;
+            }
+        }
+
+        VkDeviceSize meshBytes = m_decoded[best].vertexData.size() + m_decoded[best].indexData.size();
+        if (!meshes.empty() && takenBytes + meshBytes > maxBytes)
+        {
+            break;
+        }
+        takenBytes += meshBytes;
+
+        meshes.push_back(std::move(m_decoded[best]));
+        m_decoded[best] = std::move(m_decoded.back());
+        m_decoded.pop_back();
+    }
+
+    return meshes;
+}
+//------------------------------------------------------------------------------
+uint32_t AssetStreamer::getPendingCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<uint32_t>(m_requests.size() + m_decoded.size()) + m_loadingCount;
+}
+//------------------------------------------------------------------------------
+AssetStreamer::~AssetStreamer()
+{
+}
+//------------------------------------------------------------------------------
+void AssetStreamer::loadNext()
+{
+    StreamRequest streamRequest;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping || m_requests.empty())
+        {
+            m_taskCount--;
+            m_tasksDone.notify_all();
+            return;
+        }
+
+        size_t best = 0;
+        for (size_t i = 1; i < m_requests.size(); i++)
+        {
+            if (isBetter(m_requests[i].priority, glm::vec3(m_requests[i].model[3]), m_requests[best].priority, glm::vec3(m_requests[best].model[3])))
+            {
+                best = i;
+            }
+        }
+
+        streamRequest = std::move(m_requests[best]);
+        m_requests[best] = std::move(m_requests.back());
+        m_requests.pop_back();
+        m_loadingCount++;
+    }
+
+    // File reads and copies outside of the lock: the render thread keeps taking the meshes already decoded
+    std::vector<StreamedMesh> meshes;
+    try
+    {
+        decode(streamRequest, meshes);
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::cout << "ERROR: streaming '" << streamRequest.filename << "': " << e.what() << std::endl;
+        meshes.clear();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_stopping)
+    {
+        for (auto &mesh : meshes)
+        {
+            m_decoded.push_back(std::move(mesh));
+        }
+    }
+    m_loadingCount--;
+    m_taskCount--;
+    m_tasksDone.notify_all();
+}
+//------------------------------------------------------------------------------
+void AssetStreamer::decode(const StreamRequest &streamRequest, std::vector<StreamedMesh> &meshes) const
+{
+    MeshCache meshCache;
+    meshCache.open(streamRequest.filename);
+
+    // The pipeline has a single vertex layout
+    if (meshCache.getVertexFormat() != m_vertexFormat)
+    {
+        throw std::runtime_error("The vertex format of the file isn't the one of the renderer!");
+    }
+
+    // Copies of the sections: the pages are read here, by the worker, not by the render thread at upload time
+    meshes.reserve(meshCache.getMeshCount());
+    for (uint32_t i = 0; i < meshCache.getMeshCount(); i++)
+    {
+        EncodedMeshData meshData = meshCache.getMesh(i);
+        size_t vertexBytes = static_cast<size_t>(meshData.vertexStride * meshData.vertexCount);
+        size_t indexBytes = meshData.indexCount * ((meshData.indexType == VK_INDEX_TYPE_UINT16) ? sizeof(uint16_t) : sizeof(uint32_t));
+
+        StreamedMesh mesh;
+        mesh.vertexData.assign(static_cast<const char *>(meshData.vertexData), static_cast<const char *>(meshData.vertexData) + vertexBytes);
+        mesh.indexData.assign(static_cast<const char *>(meshData.indexData), static_cast<const char *>(meshData.indexData) + indexBytes);
+        mesh.meshData = meshData;
+        mesh.meshData.vertexData = nullptr;     // See getMeshData()
+        mesh.meshData.indexData = nullptr;
+        mesh.model = streamRequest.model;
+        mesh.priority = streamRequest.priority;
+        meshes.push_back(std::move(mesh));
+    }
+}
+//------------------------------------------------------------------------------
+bool AssetStreamer::isBetter(int priority, const glm::vec3 &position, int otherPriority, const glm::vec3 &otherPosition) const
+{
+    if (priority != otherPriority)
+    {
+        return priority > otherPriority;
+    }
+
+    glm::vec3 toCamera = position - m_cameraPosition;
+    glm::vec3 otherToCamera = otherPosition - m_cameraPosition;
+    return glm::dot(toCamera, toCamera) < glm::dot(otherToCamera, otherToCamera);
+}
+
+#pragma warning( pop )
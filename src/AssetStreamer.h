@@ -0,0 +1,84 @@
+#pragma once
+
+// C++ STL
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Project includes
+#include "Mesh.h"
+#include "ThreadPool.h"
+#include "Utilities.h"
+#include "VertexFormat.h"
+
+// Disable warning about Vulkan unscoped enums for this entire file
+#pragma warning( push )
+#pragma warning(disable : 26812) // The enum type * is unscoped. Prefer 'enum class' over 'enum'.
+
+// A mesh read and decoded by a streaming worker, waiting for its upload
+struct StreamedMesh {
+    std::vector<char>   vertexData;             // In the GPU layout (owned copies: the file is closed once decoded)
+    std::vector<char>   indexData;
+    EncodedMeshData     meshData;               // Points into vertexData/indexData (see getMeshData())
+    glm::mat4           model = glm::mat4(1.0f);
+    int                 priority = 0;
+
+    EncodedMeshData     getMeshData() const;    // meshData with the pointers of this object (it may have been moved)
+};
+
+// Background loading of mesh files: the files are read and decoded by ThreadPool workers, then handed out to the
+// render thread, which does the uploads (Vulkan queues stay on one thread). Both stages pick the best request
+// first: highest priority, then closest to the camera.
+// Files are mesh caches (see MeshCache) in the vertex format of the renderer.
+class AssetStreamer
+{
+public:
+    AssetStreamer();
+
+    void        init(ThreadPool * threadPool, VertexFormat vertexFormat);
+    // Drops the requests not started yet and waits for the running ones
+    void        destroy();
+
+    // Every mesh of 'filename' placed with 'model' (non-blocking)
+    void        request(const std::string &filename, const glm::mat4 &model, int priority = 0);
+
+    // Render thread: the decoded meshes, best first, up to 'maxBytes' of geometry (at least one mesh if any).
+    // 'cameraPosition' also orders the files not read yet
+    std::vector<StreamedMesh> takeDecoded(VkDeviceSize maxBytes, const glm::vec3 &cameraPosition);
+
+    uint32_t    getPendingCount() const;    // Meshes requested or decoded, not taken yet (files not read count as 1)
+
+    ~AssetStreamer();
+
+private:
+    struct StreamRequest {
+        std::string filename;
+        glm::mat4   model = glm::mat4(1.0f);
+        int         priority = 0;
+    };
+
+    ThreadPool *                m_threadPool = nullptr;
+    VertexFormat                m_vertexFormat = VertexFormat::Float;
+
+    mutable std::mutex          m_mutex;            // Guards everything below
+    std::vector<StreamRequest>  m_requests;         // Not read yet
+    std::vector<StreamedMesh>   m_decoded;          // Not uploaded yet
+    glm::vec3                   m_cameraPosition = glm::vec3(0.0f);
+    uint32_t                    m_loadingCount = 0; // Files being read by a worker
+    uint32_t                    m_taskCount = 0;    // Tasks submitted to the pool, not finished (they point to this object)
+    std::condition_variable     m_tasksDone;        // Signalled when m_taskCount drops
+    bool                        m_stopping = false;
+
+    // Methods
+    void        loadNext();                 // Worker task: reads and decodes the best request
+    void        decode(const StreamRequest &request, std::vector<StreamedMesh> &meshes) const;
+    bool        isBetter(int priority, const glm::vec3 &position, int otherPriority, const glm::vec3 &otherPosition) const;
+
+    // prevent copying (the worker tasks point to this object)
+    AssetStreamer(const AssetStreamer&) = delete;
+    AssetStreamer& operator=(const AssetStreamer&) = delete;
+};
+
+#pragma warning( pop )
@@ -0,0 +1,655 @@
+#include "Benchmarks.h"
+
+// C++ STL
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+// OpenGL Mathematics
+#include <glm/gtc/matrix_transform.hpp>
+
+using std::cout;
+using std::endl;
+
+// Disable warning about Vulkan unscoped enums for this entire file
+#pragma warning( push )
+#pragma warning(disable : 26812) // The enum type * is unscoped. Prefer 'enum class' over 'enum'.
+
+//------------------------------------------------------------------------------
+void Benchmarks::meshUploads(VkPhysicalDevice physicalDevice, VkDevice device, DeviceMemoryAllocator * allocator, VkQueue transferQueue,
+                             VkCommandPool transferCommandPool, UploadBatcher * uploadBatcher, size_t meshCount, size_t verticesPerMesh)
+{
+    // Synthetic mesh: a strip of quads
+    std::vector<Vertex> vertices(verticesPerMesh);
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        vertices[i].pos = glm::vec3(static_cast<float>(i / 2), static_cast<float>(i % 2), 0.0f);
+        vertices[i].col = glm::vec3(1.0f, 0.0f, 0.0f);
+    }
+    std::vector<uint32_t> indices;
+    for (uint32_t i = 0; i + 3 < static_cast<uint32_t>(vertices.size()); i += 2)
+    {
+        indices.insert(indices.end(), { i, i + 1, i + 2, i + 2, i + 1, i + 3 });
+    }
+
+    VkDeviceSize vertexBytes = sizeof(Vertex) * vertices.size();
+    VkDeviceSize indexBytes = sizeof(uint32_t) * indices.size();
+    VkDeviceSize totalBytes = (vertexBytes + indexBytes) * meshCount;
+
+    cout << endl << "[BENCHMARK] Mesh uploads: " << meshCount << " meshes, " << (vertexBytes + indexBytes) << " bytes each" << endl;
+
+    // -- BEFORE: allocate, map, fill, unmap and free a host visible staging buffer for every upload, waiting for every copy --
+    // (the memory of every buffer straight from vkAllocateMemory, as before the sub-allocator)
+    {
+        std::vector<VkBuffer> gpuBuffers;
+        std::vector<VkDeviceMemory> gpuBufferMemory;
+        gpuBuffers.reserve(meshCount * 2);
+        gpuBufferMemory.reserve(meshCount * 2);
+
+        auto start = Clock::now();
+        for (size_t meshIdx = 0; meshIdx < meshCount; meshIdx++)
+        {
+            const void * sources[] = { vertices.data(), indices.data() };
+            VkDeviceSize sizes[] = { vertexBytes, indexBytes };
+            VkBufferUsageFlags usages[] = { VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_BUFFER_USAGE_INDEX_BUFFER_BIT };
+
+            for (size_t i = 0; i < ARRAY_SIZE(sources); i++)
+            {
+                VkBuffer stagingBuffer;
+                VkDeviceMemory stagingBufferMemory;
+                createDedicatedBuffer(physicalDevice, device, sizes[i], VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, &stagingBufferMemory);
+
+                void * data;
+                vkMapMemory(device, stagingBufferMemory, 0, sizes[i], 0, &data);
+                memcpy(data, sources[i], (size_t)sizes[i]);
+                vkUnmapMemory(device, stagingBufferMemory);
+
+                gpuBuffers.push_back(0);
+                gpuBufferMemory.push_back(0);
+                createDedicatedBuffer(physicalDevice, device, sizes[i], VK_BUFFER_USAGE_TRANSFER_DST_BIT | usages[i],
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &gpuBuffers.back(), &gpuBufferMemory.back());
+
+                copyBuffer(device, transferQueue, transferCommandPool, stagingBuffer, gpuBuffers.back(), sizes[i]);
+
+                vkDestroyBuffer(device, stagingBuffer, nullptr);
+                vkFreeMemory(device, stagingBufferMemory, nullptr);
+            }
+        }
+        printThroughput("Staging buffer per upload", totalBytes, elapsedMilliseconds(start));
+
+        for (size_t i = 0; i < gpuBuffers.size(); i++)
+        {
+            vkDestroyBuffer(device, gpuBuffers[i], nullptr);
+            vkFreeMemory(device, gpuBufferMemory[i], nullptr);
+        }
+    }
+
+    // -- AFTER: Mesh uploads staged in the persistent ring and submitted in batches (one wait at the end) --
+    {
+        // Pool big enough for all the meshes (growing isn't part of the measure)
+        GeometryPool geometryPool;
+        geometryPool.init(device, allocator, uploadBatcher, transferQueue, transferCommandPool,
+            (vertexBytes + sizeof(Vertex)) * meshCount, (indexBytes + sizeof(uint32_t)) * meshCount);
+
+        std::vector<Mesh> meshes;
+        meshes.reserve(meshCount);
+
+        auto start = Clock::now();
+        for (size_t meshIdx = 0; meshIdx < meshCount; meshIdx++)
+        {
+            meshes.push_back(Mesh(&geometryPool, &vertices, &indices, false));     // Same bytes as the old path: uint32_t indices
+        }
+        uploadBatcher->wait(uploadBatcher->flush());
+        printThroughput("Batched staging ring uploads", totalBytes, elapsedMilliseconds(start));
+
+        for (auto &mesh : meshes)
+        {
+            mesh.destroyBuffers();
+        }
+        geometryPool.destroy();
+    }
+
+    cout << endl;
+}
+
+//------------------------------------------------------------------------------
+void Benchmarks::drawRecording( VkDevice device, uint32_t graphicsFamily, const DrawRecordingTarget &target, Mesh * mesh,
+                                size_t drawCount, size_t frameCount)
+{
+    // Every draw needs its own slot in the dynamic uniform buffer
+    drawCount = std::min(drawCount, static_cast<size_t>(MAX_OBJECTS));
+
+    // A grid of objects, computed up front: only the cost of getting the matrices to the GPU is measured
+    std::vector<UboModel> models(drawCount);
+    for (size_t i = 0; i < models.size(); i++)
+    {
+        models[i].model = glm::translate(glm::mat4(1.0f), glm::vec3(static_cast<float>(i % 100) * 0.01f, static_cast<float>(i / 100) * 0.01f, 0.0f));
+    }
+
+    cout << endl << "[BENCHMARK] Draw recording: " << drawCount << " draws per frame, " << frameCount << " frames" << endl;
+
+    // Own pool, reset as a whole before every frame
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = graphicsFamily;
+
+    VkCommandPool commandPool;
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create the Benchmark Command Pool!");
+    }
+
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate the Benchmark Command Buffer!");
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    VkClearValue clearValue = { {0.0f, 0.0f, 0.0f, 1.0f} };
+    VkRenderPassBeginInfo renderPassBeginInfo = {};
+    renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassBeginInfo.renderPass = target.renderPass;
+    renderPassBeginInfo.framebuffer = target.framebuffer;
+    renderPassBeginInfo.renderArea.offset = { 0, 0 };
+    renderPassBeginInfo.renderArea.extent = target.extent;
+    renderPassBeginInfo.clearValueCount = 1;
+    renderPassBeginInfo.pClearValues = &clearValue;
+
+    VkBuffer vertexBuffers[] = { mesh->getVertexBuffer() };
+    VkDeviceSize offsets[] = { 0 };
+
+    enum Variant { DynamicUniform, PushConstants, Indirect, VariantCount };
+
+    auto recordFrame = [&](Variant variant)
+    {
+        vkResetCommandPool(device, commandPool, 0);
+        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+        vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, target.pipeline);
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+        vkCmdBindIndexBuffer(commandBuffer, mesh->getIndexBuffer(), 0, mesh->getIndexType());
+
+        if (variant != DynamicUniform)
+        {
+            uint32_t dynamicOffset = 0;
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, target.pipelineLayout, 0, 1, &target.descriptorSet, 1, &dynamicOffset);
+        }
+
+        if (variant == Indirect)
+        {
+            // The CPU still writes every Model matrix and draw command, but records a single draw call
+            memcpy(target.modelStorageData, models.data(), drawCount * sizeof(UboModel));
+
+            VkDrawIndexedIndirectCommand * drawCommands = static_cast<VkDrawIndexedIndirectCommand *>(target.drawIndirectData);
+            for (size_t i = 0; i < drawCount; i++)
+            {
+                drawCommands[i].indexCount = mesh->getIndexCount();
+                drawCommands[i].instanceCount = 1;
+                drawCommands[i].firstIndex = mesh->getFirstIndex();
+                drawCommands[i].vertexOffset = mesh->getVertexOffset();
+                drawCommands[i].firstInstance = static_cast<uint32_t>(i);
+            }
+
+            uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+            if (target.multiDrawIndirect)
+            {
+                vkCmdDrawIndexedIndirect(commandBuffer, target.drawIndirectBuffer, 0, static_cast<uint32_t>(drawCount), stride);
+            }
+            else
+            {
+                for (size_t i = 0; i < drawCount; i++)
+                {
+                    vkCmdDrawIndexedIndirect(commandBuffer, target.drawIndirectBuffer, i * stride, 1, stride);
+                }
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < drawCount; i++)
+            {
+                if (variant == PushConstants)
+                {
+                    vkCmdPushConstants(commandBuffer, target.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(UboModel), &models[i]);
+                }
+                else
+                {
+                    memcpy(static_cast<char *>(target.modelUniformData) + i * target.modelUniformAlignment, &models[i], sizeof(UboModel));
+
+                    uint32_t dynamicOffset = static_cast<uint32_t>(i * target.modelUniformAlignment);
+                    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, target.pipelineLayout, 0, 1, &target.descriptorSet, 1, &dynamicOffset);
+                }
+                vkCmdDrawIndexed(commandBuffer, mesh->getIndexCount(), 1, mesh->getFirstIndex(), mesh->getVertexOffset(), 0);
+            }
+        }
+
+        vkCmdEndRenderPass(commandBuffer);
+        vkEndCommandBuffer(commandBuffer);
+    };
+
+    const char * names[] = { "Dynamic uniform buffer", "Push constants",
+                             target.multiDrawIndirect ? "Indirect (multi-draw)" : "Indirect (one call per draw)" };
+    for (int variant = 0; variant < VariantCount; variant++)
+    {
+        recordFrame(static_cast<Variant>(variant));     // Warm up (driver allocations, caches)
+
+        auto start = Clock::now();
+        for (size_t frame = 0; frame < frameCount; frame++)
+        {
+            recordFrame(static_cast<Variant>(variant));
+        }
+        printFrameTime(names[variant], elapsedMilliseconds(start) / frameCount, drawCount);
+    }
+
+    vkDestroyCommandPool(device, commandPool, nullptr);
+
+    cout << endl;
+}
+//------------------------------------------------------------------------------
+void Benchmarks::parallelRecording( VkDevice device, uint32_t graphicsFamily, const DrawRecordingTarget &target, Mesh * mesh,
+                                    ThreadPool * threadPool, size_t drawCount, size_t frameCount)
+{
+    uint32_t maxThreadCount = threadPool->getThreadCount() + 1;
+
+    // Push constants only: no buffer slot per draw, any draw count fits
+    std::vector<UboModel> models(drawCount);
+    for (size_t i = 0; i < models.size(); i++)
+    {
+        models[i].model = glm::translate(glm::mat4(1.0f), glm::vec3(static_cast<float>(i % 100) * 0.01f, static_cast<float>(i / 100 % 100) * 0.01f, 0.0f));
+    }
+
+    cout << endl << "[BENCHMARK] Parallel recording: " << drawCount << " draws per frame, " << frameCount << " frames, up to "
+         << maxThreadCount << " threads" << endl;
+
+    // One pool per recording thread and one for the primary command buffer, each reset as a whole before every frame
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = graphicsFamily;
+
+    std::vector<VkCommandPool> commandPools(maxThreadCount + 1);
+    std::vector<VkCommandBuffer> commandBuffers(maxThreadCount + 1);   // Secondary ones, then the primary one
+    for (uint32_t i = 0; i <= maxThreadCount; i++)
+    {
+        if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPools[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create the Benchmark Command Pool!");
+        }
+
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = (i < maxThreadCount) ? VK_COMMAND_BUFFER_LEVEL_SECONDARY : VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = commandPools[i];
+        allocInfo.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffers[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to allocate the Benchmark Command Buffer!");
+        }
+    }
+    VkCommandPool primaryCommandPool = commandPools[maxThreadCount];
+    VkCommandBuffer primaryCommandBuffer = commandBuffers[maxThreadCount];
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    VkCommandBufferInheritanceInfo inheritanceInfo = {};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = target.renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = target.framebuffer;
+
+    VkCommandBufferBeginInfo secondaryBeginInfo = beginInfo;
+    secondaryBeginInfo.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    secondaryBeginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    VkClearValue clearValue = { {0.0f, 0.0f, 0.0f, 1.0f} };
+    VkRenderPassBeginInfo renderPassBeginInfo = {};
+    renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassBeginInfo.renderPass = target.renderPass;
+    renderPassBeginInfo.framebuffer = target.framebuffer;
+    renderPassBeginInfo.renderArea.offset = { 0, 0 };
+    renderPassBeginInfo.renderArea.extent = target.extent;
+    renderPassBeginInfo.clearValueCount = 1;
+    renderPassBeginInfo.pClearValues = &clearValue;
+
+    VkBuffer vertexBuffers[] = { mesh->getVertexBuffer() };
+    VkDeviceSize offsets[] = { 0 };
+
+    // No state is inherited by a secondary command buffer: every slice binds everything
+    auto recordSlice = [&](VkCommandBuffer commandBuffer, size_t firstDraw, size_t drawEnd)
+    {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, target.pipeline);
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+        vkCmdBindIndexBuffer(commandBuffer, mesh->getIndexBuffer(), 0, mesh->getIndexType());
+
+        uint32_t dynamicOffset = 0;
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, target.pipelineLayout, 0, 1, &target.descriptorSet, 1, &dynamicOffset);
+
+        for (size_t i = firstDraw; i < drawEnd; i++)
+        {
+            vkCmdPushConstants(commandBuffer, target.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(UboModel), &models[i]);
+            vkCmdDrawIndexed(commandBuffer, mesh->getIndexCount(), 1, mesh->getFirstIndex(), mesh->getVertexOffset(), 0);
+        }
+    };
+
+    // threadCount 0: inline in the primary command buffer
+    auto recordFrame = [&](uint32_t threadCount)
+    {
+        if (threadCount > 0)
+        {
+            // One range per secondary command buffer, reset and recorded by a single thread
+            threadPool->parallelFor(threadCount, [&](uint32_t begin, uint32_t end) {
+                for (uint32_t slice = begin; slice < end; slice++)
+                {
+                    vkResetCommandPool(device, commandPools[slice], 0);
+                    vkBeginCommandBuffer(commandBuffers[slice], &secondaryBeginInfo);
+                    recordSlice(commandBuffers[slice], drawCount * slice / threadCount, drawCount * (slice + 1) / threadCount);
+                    vkEndCommandBuffer(commandBuffers[slice]);
+                }
+            });
+        }
+
+        vkResetCommandPool(device, primaryCommandPool, 0);
+        vkBeginCommandBuffer(primaryCommandBuffer, &beginInfo);
+        if (threadCount > 0)
+        {
+            vkCmdBeginRenderPass(primaryCommandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            vkCmdExecuteCommands(primaryCommandBuffer, threadCount, commandBuffers.data());
+        }
+        else
+        {
+            vkCmdBeginRenderPass(primaryCommandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+            recordSlice(primaryCommandBuffer, 0, drawCount);
+        }
+        vkCmdEndRenderPass(primaryCommandBuffer);
+        vkEndCommandBuffer(primaryCommandBuffer);
+    };
+
+    // Inline, then 1, 2, 4... threads (and all of them)
+    std::vector<uint32_t> threadCounts = { 0 };
+    for (uint32_t threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+    {
+        threadCounts.push_back(threadCount);
+    }
+    threadCounts.push_back(maxThreadCount);
+
+    double inlineMilliseconds = 0.0;
+    for (uint32_t threadCount : threadCounts)
+    {
+        recordFrame(threadCount);   // Warm up (driver allocations, caches)
+
+        auto start = Clock::now();
+        for (size_t frame = 0; frame < frameCount; frame++)
+        {
+            recordFrame(threadCount);
+        }
+        double milliseconds = elapsedMilliseconds(start) / frameCount;
+
+        if (threadCount == 0)
+        {
+            inlineMilliseconds = milliseconds;
+            printFrameTime("Inline, 1 thread", milliseconds, drawCount);
+        }
+        else
+        {
+            printFrameTime("Secondary, " + std::to_string(threadCount) + " thread(s)", milliseconds, drawCount);
+            cout << "    speedup: " << inlineMilliseconds / milliseconds << "x" << endl;
+        }
+    }
+
+    for (auto commandPool : commandPools)
+    {
+        vkDestroyCommandPool(device, commandPool, nullptr);
+    }
+
+    cout << endl;
+}
+
+//------------------------------------------------------------------------------
+void Benchmarks::frustumCulling(size_t objectCount, size_t iterationCount)
+{
+    cout << endl << "[BENCHMARK] Frustum culling: " << objectCount << " bounding spheres, " << iterationCount << " iterations (SIMD: "
+         << FrustumCuller::getSimdName() << ")" << endl;
+
+    // Spheres scattered around the camera (deterministic: a simple LCG), about a third of them visible
+    FrustumCuller culler;
+    culler.resize(static_cast<uint32_t>(objectCount));
+    uint32_t seed = 12345U;
+    auto random = [&seed]() { seed = seed * 1664525U + 1013904223U; return static_cast<float>(seed >> 8) / 16777216.0f; };
+    for (uint32_t i = 0; i < static_cast<uint32_t>(objectCount); i++)
+    {
+        glm::vec3 center(random() * 200.0f - 100.0f, random() * 200.0f - 100.0f, random() * 200.0f - 100.0f);
+        culler.setSphere(i, glm::vec4(center, 0.1f + random()));
+    }
+
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 viewProjection = projection * view;
+
+    std::vector<uint32_t> visibleObjects;
+    visibleObjects.reserve(objectCount);
+    uint32_t visibleCounts[2] = {};
+    const char * names[2] = { "Scalar", "SIMD" };
+    for (int simd = 0; simd < 2; simd++)
+    {
+        // Warm up (and sizes the output once)
+        visibleCounts[simd] = culler.cull(viewProjection, visibleObjects, simd != 0);
+
+        auto start = Clock::now();
+        for (size_t iteration = 0; iteration < iterationCount; iteration++)
+        {
+            culler.cull(viewProjection, visibleObjects, simd != 0);
+        }
+        double milliseconds = elapsedMilliseconds(start) / iterationCount;
+
+        cout    << "  " << names[simd] << ": " << milliseconds << " ms per pass, "
+                << static_cast<double>(objectCount) / milliseconds << " objects culled per ms ("
+                << visibleCounts[simd] << " visible)" << endl;
+    }
+
+    if (visibleCounts[0] != visibleCounts[1])
+    {
+        cout << "  WARNING: scalar and SIMD visibility differ!" << endl;
+    }
+
+    cout << endl;
+}
+//------------------------------------------------------------------------------
+bool Benchmarks::meshOptimizer(uint32_t gridSize, size_t iterationCount)
+{
+    // Grid of quads: the vertex (x, y) is the only one at that position, which identifies it after any reordering
+    uint32_t rowVertices = gridSize + 1;
+    std::vector<Vertex> sourceVertices(static_cast<size_t>(rowVertices) * rowVertices);
+    for (uint32_t y = 0; y < rowVertices; y++)
+    {
+        for (uint32_t x = 0; x < rowVertices; x++)
+        {
+            sourceVertices[y * rowVertices + x].pos = glm::vec3(static_cast<float>(x), static_cast<float>(y), 0.0f);
+            sourceVertices[y * rowVertices + x].col = glm::vec3(1.0f, 0.0f, 0.0f);
+        }
+    }
+
+    // Triangles shuffled (deterministic: a simple LCG), for a vertex cache close to the worst case
+    std::vector<std::array<uint32_t, 3>> sourceTriangles;
+    for (uint32_t y = 0; y < gridSize; y++)
+    {
+        for (uint32_t x = 0; x < gridSize; x++)
+        {
+            uint32_t corner = y * rowVertices + x;
+            sourceTriangles.push_back({ corner, corner + 1, corner + rowVertices });
+            sourceTriangles.push_back({ corner + rowVertices, corner + 1, corner + rowVertices + 1 });
+        }
+    }
+    uint32_t seed = 12345U;
+    for (size_t i = sourceTriangles.size() - 1; i > 0; i--)
+    {
+        seed = seed * 1664525U + 1013904223U;
+        std::swap(sourceTriangles[i], sourceTriangles[(seed >> 8) % (i + 1)]);
+    }
+    std::vector<uint32_t> sourceIndices;
+    for (const auto &triangle : sourceTriangles)
+    {
+        sourceIndices.insert(sourceIndices.end(), triangle.begin(), triangle.end());
+    }
+
+    cout << endl << "[BENCHMARK] Mesh optimizer: " << sourceVertices.size() << " vertices, " << sourceTriangles.size()
+         << " shuffled triangles, " << iterationCount << " iterations" << endl;
+
+    // Every iteration optimizes the same input: its output must be the one of the first iteration
+    iterationCount = std::max<size_t>(iterationCount, 2);
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<Vertex> firstVertices;
+    std::vector<uint32_t> firstIndices;
+    MeshOptimizer::Statistics statistics;
+    bool deterministic = true;
+    double milliseconds = 0.0;
+    for (size_t iteration = 0; iteration < iterationCount; iteration++)
+    {
+        vertices = sourceVertices;
+        indices = sourceIndices;
+
+        auto start = Clock::now();
+        statistics = MeshOptimizer::optimize(vertices, indices);
+        milliseconds += elapsedMilliseconds(start);
+
+        if (iteration == 0)
+        {
+            firstVertices = vertices;
+            firstIndices = indices;
+        }
+        else
+        {
+            deterministic = deterministic && indices == firstIndices && vertices.size() == firstVertices.size() &&
+                            (vertices.empty() || memcmp(vertices.data(), firstVertices.data(), sizeof(Vertex) * vertices.size()) == 0);
+        }
+    }
+    milliseconds /= static_cast<double>(iterationCount);
+
+    cout    << "  Optimize: " << milliseconds << " ms, ACMR " << statistics.acmrBefore << " -> " << statistics.acmrAfter
+            << ", " << statistics.vertexCountBefore << " -> " << statistics.vertexCountAfter << " vertices" << endl;
+
+    // Every index in range of the remapped vertices
+    bool indicesValid = (indices.size() == sourceIndices.size() && statistics.vertexCountAfter == vertices.size());
+    for (size_t i = 0; indicesValid && i < indices.size(); i++)
+    {
+        indicesValid = (indices[i] < vertices.size());
+    }
+
+    // Same triangles: back to the source vertices by position, each starting from its smallest vertex (same winding)
+    auto normalize = [](std::array<uint32_t, 3> triangle) {
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+        return triangle;
+    };
+    bool trianglesKept = indicesValid;
+    if (trianglesKept)
+    {
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            std::array<uint32_t, 3> triangle;
+            for (size_t k = 0; k < 3; k++)
+            {
+                const glm::vec3 &pos = vertices[indices[i + k]].pos;
+                triangle[k] = static_cast<uint32_t>(pos.y) * rowVertices + static_cast<uint32_t>(pos.x);
+            }
+            triangles.push_back(normalize(triangle));
+        }
+        for (auto &triangle : sourceTriangles)
+        {
+            triangle = normalize(triangle);
+        }
+        std::sort(triangles.begin(), triangles.end());
+        std::sort(sourceTriangles.begin(), sourceTriangles.end());
+        trianglesKept = (triangles == sourceTriangles);
+    }
+
+    bool acmrKept = (statistics.acmrAfter <= statistics.acmrBefore);
+    cout    << "  Checks: output " << (deterministic ? "deterministic" : "NOT DETERMINISTIC") << ", triangles "
+            << (trianglesKept ? "kept" : "CHANGED") << ", indices " << (indicesValid ? "valid" : "OUT OF RANGE")
+            << ", ACMR " << (acmrKept ? "not worse" : "WORSE") << endl;
+    bool passed = deterministic && trianglesKept && indicesValid && acmrKept;
+    if (!passed)
+    {
+        cout << "  ERROR: the mesh optimizer output is wrong!" << endl;
+    }
+
+    cout << endl;
+    return passed;
+}
+//------------------------------------------------------------------------------
+void Benchmarks::createDedicatedBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsage,
+                                       VkMemoryPropertyFlags bufferProperties, VkBuffer * buffer, VkDeviceMemory * bufferMemory)
+{
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = bufferSize;
+    bufferInfo.usage = bufferUsage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a Buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, *buffer, &memRequirements);
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    uint32_t memoryTypeIndex = std::numeric_limits<uint32_t>::max();
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount && memoryTypeIndex == std::numeric_limits<uint32_t>::max(); i++)
+    {
+        if ((memRequirements.memoryTypeBits & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & bufferProperties) == bufferProperties)
+        {
+            memoryTypeIndex = i;
+        }
+    }
+
+    VkMemoryAllocateInfo memoryAllocInfo = {};
+    memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memoryAllocInfo.allocationSize = memRequirements.size;
+    memoryAllocInfo.memoryTypeIndex = memoryTypeIndex;
+    if (vkAllocateMemory(device, &memoryAllocInfo, nullptr, bufferMemory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate Buffer Memory!");
+    }
+
+    vkBindBufferMemory(device, *buffer, *bufferMemory, 0);
+}
+//------------------------------------------------------------------------------
+double Benchmarks::elapsedMilliseconds(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+//------------------------------------------------------------------------------
+void Benchmarks::printThroughput(const std::string &name, VkDeviceSize bytes, double milliseconds)
+{
+    double megabytes = static_cast<double>(bytes) / (1024.0 * 1024.0);
+    cout    << "  " << name << ": " << milliseconds << " ms, "
+            << (megabytes / (milliseconds / 1000.0)) << " MB/s" << endl;
+}
+//------------------------------------------------------------------------------
+void Benchmarks::printFrameTime(const std::string &name, double milliseconds, size_t drawCount)
+{
+    cout    << "  " << name << ": " << milliseconds << " ms per frame, "
+            << (milliseconds * 1000000.0 / static_cast<double>(drawCount)) << " ns per draw" << endl;
+}
+
+#pragma warning( pop )
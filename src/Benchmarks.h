@@ -0,0 +1,85 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+// C++ STL
+#include <chrono>
+#include <string>
+
+// Project includes
+#include "FrustumCuller.h"
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "ThreadPool.h"
+#include "UploadBatcher.h"
+#include "Utilities.h"
+
+// Disable warning about Vulkan unscoped enums for this entire file
+#pragma warning( push )
+#pragma warning(disable : 26812) // The enum type * is unscoped. Prefer 'enum class' over 'enum'.
+
+// Static class (only static methods, not instantiable) with the performance measurements run by "--benchmark"
+class Benchmarks
+{
+public:
+    // Render target and per-object resources the draws are recorded against
+    struct DrawRecordingTarget {
+        VkRenderPass        renderPass;
+        VkFramebuffer       framebuffer;
+        VkExtent2D          extent;
+        VkPipeline          pipeline;
+        VkPipelineLayout    pipelineLayout;
+        VkDescriptorSet     descriptorSet;
+        void *              modelUniformData;       // Mapped dynamic uniform buffer (Model matrices)
+        VkDeviceSize        modelUniformAlignment;  // Distance between two Model matrices in the dynamic uniform buffer
+        void *              modelStorageData;       // Mapped storage buffer (Model matrices, tightly packed)
+        VkBuffer            drawIndirectBuffer;     // Indirect buffer (VkDrawIndexedIndirectCommand records)
+        void *              drawIndirectData;       // Mapped drawIndirectBuffer
+        bool                multiDrawIndirect;      // Whole frame in one vkCmdDrawIndexedIndirect (otherwise one per draw)
+    };
+
+    // Upload throughput (MB/s) of many small meshes: staging buffer + blocking submit per upload, each buffer with its own
+    // vkAllocateMemory (and the staging one mapped/unmapped) like the old path, vs. batched staging ring uploads
+    static void meshUploads(VkPhysicalDevice physicalDevice, VkDevice device, DeviceMemoryAllocator * allocator, VkQueue transferQueue,
+                            VkCommandPool transferCommandPool, UploadBatcher * uploadBatcher, size_t meshCount = 1000, size_t verticesPerMesh = 4096);
+
+    // CPU time to produce a frame of 'drawCount' draws: Model matrix through the dynamic uniform buffer
+    // (buffer write + descriptor rebind per draw) vs. push constants vs. indirect draws (Model matrices and draw commands
+    // written to buffers, a single draw call). Command buffers are recorded, never submitted
+    static void drawRecording(  VkDevice device, uint32_t graphicsFamily, const DrawRecordingTarget &target, Mesh * mesh,
+                                size_t drawCount = 10000, size_t frameCount = 100);
+
+    // CPU time to record a frame of 'drawCount' push constant draws on one thread (inline in the primary command buffer)
+    // vs. split in secondary command buffers recorded in parallel, each from its own command pool, by 1 to all the
+    // threads of 'threadPool' plus the calling one (vkCmdExecuteCommands in the primary). Never submitted
+    static void parallelRecording(  VkDevice device, uint32_t graphicsFamily, const DrawRecordingTarget &target, Mesh * mesh,
+                                    ThreadPool * threadPool, size_t drawCount = 100000, size_t frameCount = 20);
+
+    // CPU frustum culling rate (objects per millisecond) of 'objectCount' random bounding spheres: scalar vs. SIMD
+    static void frustumCulling(size_t objectCount = 1000000, size_t iterationCount = 20);
+
+    // MeshOptimizer::optimize() time on a 'gridSize' x 'gridSize' quad grid with shuffled triangles, and its checks:
+    // same output for every iteration (at least 2), same triangles (as a set, winding kept), every index in range after
+    // the vertex fetch remap, ACMR not worse. CPU only (no device): returns false if a check fails
+    static bool meshOptimizer(uint32_t gridSize = 256, size_t iterationCount = 10);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Buffer bound to a vkAllocateMemory of its own (no sub-allocation): the old path measured by meshUploads()
+    static void     createDedicatedBuffer(  VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsage,
+                                            VkMemoryPropertyFlags bufferProperties, VkBuffer * buffer, VkDeviceMemory * bufferMemory);
+    static double   elapsedMilliseconds(Clock::time_point start);
+    static void     printThroughput(const std::string &name, VkDeviceSize bytes, double milliseconds);
+    static void     printFrameTime(const std::string &name, double milliseconds, size_t drawCount);
+
+    // Disallow creating an instance of this object
+    Benchmarks() = delete;
+    ~Benchmarks() = delete;
+    // prevent copying
+    Benchmarks(const Benchmarks&) = delete;
+    Benchmarks& operator=(const Benchmarks&) = delete;
+};
+
+#pragma warning( pop )
@@ -0,0 +1,281 @@
+#include "DeviceMemoryAllocator.h"
+
+// C++ STL
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+// Disable warning about Vulkan unscoped enums for this entire file
+#pragma warning( push )
+#pragma warning(disable : 26812) // The enum type * is unscoped. Prefer 'enum class' over 'enum'.
+
+DeviceMemoryAllocator::DeviceMemoryAllocator()
+{
+}
+
+void DeviceMemoryAllocator::init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize)
+{
+    m_physicalDevice = physicalDevice;
+    m_device = device;
+
+    // Memory properties never change for a device, so query them once instead of at every allocation
+    vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &m_memoryProperties);
+
+    // Small heaps (e.g. the 256 MiB host visible + device local heap of many discrete GPUs) get smaller blocks,
+    // so a single block doesn't eat up most of the heap
+    for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; i++)
+    {
+        VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[i].size;
+        m_preferredBlockSize[i] = (heapSize <= 1024ULL * 1024 * 1024) ? std::min(blockSize, heapSize / 8) : blockSize;
+    }
+
+    m_blocks.resize(m_memoryProperties.memoryTypeCount);
+}
+
+void DeviceMemoryAllocator::destroy()
+{
+    for (auto &typeBlocks : m_blocks)
+    {
+        for (auto &block : typeBlocks)
+        {
+            destroyBlock(block.get());
+        }
+        typeBlocks.clear();
+    }
+    m_blocks.clear();
+}
+
+MemoryAllocation DeviceMemoryAllocator::allocate(const VkMemoryRequirements &memRequirements, VkMemoryPropertyFlags properties)
+{
+    uint32_t memoryTypeIndex = findMemoryTypeIndex(memRequirements.memoryTypeBits, properties);
+    if (memoryTypeIndex == std::numeric_limits<uint32_t>::max())
+    {
+        throw std::runtime_error("Failed to find a suitable Memory Type!");
+    }
+
+    uint32_t heapIndex = m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    VkDeviceSize blockSize = m_preferredBlockSize[heapIndex];
+
+    // N.B.: only buffers are sub-allocated for now. If images get in here too, bufferImageGranularity must be honoured between neighbours.
+    MemoryBlock * targetBlock = nullptr;
+    VkDeviceSize offset = RangeAllocator::INVALID_OFFSET;
+
+    // Requests bigger than half a block get their own dedicated block, otherwise they would waste most of a shared one
+    if (memRequirements.size > blockSize / 2)
+    {
+        targetBlock = createBlock(memoryTypeIndex, memRequirements.size, true);
+        if (targetBlock != nullptr)
+        {
+            offset = targetBlock->ranges.allocate(memRequirements.size, memRequirements.alignment);
+        }
+    }
+    else
+    {
+        // Look for room in existing blocks of this memory type first
+        for (auto &block : m_blocks[memoryTypeIndex])
+        {
+            if (block->dedicated)
+            {
+                continue;
+            }
+
+            offset = block->ranges.allocate(memRequirements.size, memRequirements.alignment);
+            if (offset != RangeAllocator::INVALID_OFFSET)
+            {
+                targetBlock = block.get();
+                break;
+            }
+        }
+
+        // No room: create a new block (halving its size if the heap is running out, as long as the request still fits)
+        while (targetBlock == nullptr && blockSize >= memRequirements.size + memRequirements.alignment)
+        {
+            targetBlock = createBlock(memoryTypeIndex, blockSize, false);
+            if (targetBlock != nullptr)
+            {
+                offset = targetBlock->ranges.allocate(memRequirements.size, memRequirements.alignment);
+            }
+            blockSize /= 2;
+        }
+    }
+
+    if (targetBlock == nullptr || offset == RangeAllocator::INVALID_OFFSET)
+    {
+        throw std::runtime_error("Failed to allocate Device Memory!");
+    }
+
+    targetBlock->allocationCount++;
+
+    MemoryAllocation allocation = {};
+    allocation.memory = targetBlock->memory;
+    allocation.offset = offset;
+    allocation.size = memRequirements.size;
+    allocation.mappedData = (targetBlock->mappedData != nullptr) ? static_cast<char *>(targetBlock->mappedData) + offset : nullptr;
+    allocation.memoryTypeIndex = memoryTypeIndex;
+
+    return allocation;
+}
+
+void DeviceMemoryAllocator::free(MemoryAllocation &allocation)
+{
+    if (allocation.memory == 0)
+    {
+        return;
+    }
+
+    auto &typeBlocks = m_blocks[allocation.memoryTypeIndex];
+    for (size_t i = 0; i < typeBlocks.size(); i++)
+    {
+        MemoryBlock * block = typeBlocks[i].get();
+        if (block->memory != allocation.memory)
+        {
+            continue;
+        }
+
+        block->ranges.free(allocation.offset, allocation.size);
+        block->allocationCount--;
+
+        // Give back empty blocks to the driver, but keep one shared block per memory type around to avoid thrashing
+        if (block->allocationCount == 0)
+        {
+            bool keepBlock = false;
+            if (!block->dedicated)
+            {
+                keepBlock = true;
+                for (auto &other : typeBlocks)
+                {
+                    if (other.get() != block && !other->dedicated && other->allocationCount == 0)
+                    {
+                        keepBlock = false;
+                        break;
+                    }
+                }
+            }
+
+            if (!keepBlock)
+            {
+                destroyBlock(block);
+                typeBlocks.erase(typeBlocks.begin() + i);
+            }
+        }
+        break;
+    }
+
+    allocation = {};
+}
+
+uint32_t DeviceMemoryAllocator::getHeapCount() const
+{
+    return m_memoryProperties.memoryHeapCount;
+}
+
+HeapStatistics DeviceMemoryAllocator::getHeapStatistics(uint32_t heapIndex) const
+{
+    HeapStatistics stats = {};
+    if (heapIndex >= m_memoryProperties.memoryHeapCount)
+    {
+        return stats;
+    }
+
+    stats.heapSize = m_memoryProperties.memoryHeaps[heapIndex].size;
+    for (size_t typeIdx = 0; typeIdx < m_blocks.size(); typeIdx++)
+    {
+        if (m_memoryProperties.memoryTypes[typeIdx].heapIndex != heapIndex)
+        {
+            continue;
+        }
+
+        for (const auto &block : m_blocks[typeIdx])
+        {
+            stats.blockBytes += block->size;
+            stats.usedBytes += block->ranges.getUsedSize();
+            stats.blockCount++;
+            stats.allocationCount += block->allocationCount;
+        }
+    }
+    stats.freeBytes = stats.blockBytes - stats.usedBytes;
+
+    return stats;
+}
+
+void DeviceMemoryAllocator::printStatistics() const
+{
+    for (uint32_t i = 0; i < getHeapCount(); i++)
+    {
+        HeapStatistics stats = getHeapStatistics(i);
+        std::cout   << "Memory Heap " << i << ": "
+                    << stats.blockCount << " block(s), " << stats.allocationCount << " allocation(s), "
+                    << stats.usedBytes << " bytes used, " << stats.freeBytes << " bytes free "
+                    << "(" << stats.blockBytes << " of " << stats.heapSize << " bytes allocated)" << std::endl;
+    }
+}
+
+DeviceMemoryAllocator::~DeviceMemoryAllocator()
+{
+}
+
+
+// Private methods
+uint32_t DeviceMemoryAllocator::findMemoryTypeIndex(uint32_t allowedTypes, VkMemoryPropertyFlags properties) const
+{
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++)
+    {
+        if (    (allowedTypes & (1 << i))                                                       // Index of memory type must match corresponding bit in allowedTypes
+            &&  (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)   // Desired property bit flags are part of memory type's property flags
+        {
+            // This memory type is valid, so return its index
+            return i;
+        }
+    }
+
+    return std::numeric_limits<uint32_t>::max();
+}
+
+DeviceMemoryAllocator::MemoryBlock * DeviceMemoryAllocator::createBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated)
+{
+    std::unique_ptr<MemoryBlock> block(new MemoryBlock());
+
+    VkMemoryAllocateInfo memoryAllocInfo = {};
+    memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memoryAllocInfo.allocationSize = size;
+    memoryAllocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    // A failure here is not fatal yet: the caller may retry with a smaller block
+    VkResult result = vkAllocateMemory(m_device, &memoryAllocInfo, nullptr, &block->memory);
+    if (result != VK_SUCCESS)
+    {
+        return nullptr;
+    }
+
+    block->size = size;
+    block->ranges = RangeAllocator(size);
+    block->dedicated = dedicated;
+
+    // Host visible blocks are mapped once and stay mapped: a VkDeviceMemory can be mapped only once at a time,
+    // so sub-allocations can't map themselves anyway
+    if (m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        result = vkMapMemory(m_device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mappedData);
+        if (result != VK_SUCCESS)
+        {
+            vkFreeMemory(m_device, block->memory, nullptr);
+            throw std::runtime_error("Failed to map a Device Memory block!");
+        }
+    }
+
+    m_blocks[memoryTypeIndex].push_back(std::move(block));
+    return m_blocks[memoryTypeIndex].back().get();
+}
+
+void DeviceMemoryAllocator::destroyBlock(MemoryBlock * block)
+{
+    if (block->mappedData != nullptr)
+    {
+        vkUnmapMemory(m_device, block->memory);
+    }
+    vkFreeMemory(m_device, block->memory, nullptr);
+}
+
+#pragma warning( pop )
@@ -0,0 +1,81 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+// C++ STL
+#include <memory>
+#include <vector>
+
+// Project includes
+#include "RangeAllocator.h"
+
+// Disable warning about Vulkan unscoped enums for this entire file
+#pragma warning( push )
+#pragma warning(disable : 26812) // The enum type * is unscoped. Prefer 'enum class' over 'enum'.
+
+// A piece of a VkDeviceMemory block handed out by the DeviceMemoryAllocator
+struct MemoryAllocation {
+    VkDeviceMemory  memory = 0;                 // Block the allocation lives in ('0' instead of 'nullptr' for compatibility with 32bit version)
+    VkDeviceSize    offset = 0;                 // Offset inside the block (already aligned)
+    VkDeviceSize    size = 0;                   // Size requested (VkMemoryRequirements::size)
+    void *          mappedData = nullptr;       // Host pointer to offset, if the memory type is HOST_VISIBLE (blocks stay mapped for their whole life)
+    uint32_t        memoryTypeIndex = 0;
+};
+
+// Used/free bytes of a single memory heap
+struct HeapStatistics {
+    VkDeviceSize    heapSize = 0;               // Size of the heap as reported by the device
+    VkDeviceSize    blockBytes = 0;             // Bytes actually allocated from the heap (vkAllocateMemory)
+    VkDeviceSize    usedBytes = 0;              // Bytes handed out to buffers
+    VkDeviceSize    freeBytes = 0;              // Bytes allocated from the heap but not handed out (blockBytes - usedBytes)
+    uint32_t        blockCount = 0;             // Number of VkDeviceMemory objects
+    uint32_t        allocationCount = 0;        // Number of sub-allocations
+};
+
+// Sub-allocates buffers out of big VkDeviceMemory blocks (one list of blocks per memory type),
+// so that the number of vkAllocateMemory calls stays far below maxMemoryAllocationCount.
+class DeviceMemoryAllocator
+{
+public:
+    static const VkDeviceSize DEFAULT_BLOCK_SIZE = 64ULL * 1024 * 1024;    // 64 MiB
+
+    DeviceMemoryAllocator();
+
+    void                init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+    void                destroy();
+
+    MemoryAllocation    allocate(const VkMemoryRequirements &memRequirements, VkMemoryPropertyFlags properties);
+    void                free(MemoryAllocation &allocation);
+
+    uint32_t            getHeapCount() const;
+    HeapStatistics      getHeapStatistics(uint32_t heapIndex) const;
+    void                printStatistics() const;
+
+    ~DeviceMemoryAllocator();
+
+private:
+    struct MemoryBlock {
+        VkDeviceMemory  memory = 0;
+        VkDeviceSize    size = 0;
+        void *          mappedData = nullptr;
+        RangeAllocator  ranges;
+        uint32_t        allocationCount = 0;
+        bool            dedicated = false;      // Created for a single allocation bigger than the preferred block size
+    };
+
+    VkPhysicalDevice                    m_physicalDevice = nullptr;
+    VkDevice                            m_device = nullptr;
+    VkPhysicalDeviceMemoryProperties    m_memoryProperties = {};
+    VkDeviceSize                        m_preferredBlockSize[VK_MAX_MEMORY_HEAPS] = {};
+
+    // One list of blocks per memory type
+    std::vector<std::vector<std::unique_ptr<MemoryBlock>>>  m_blocks;
+
+    // Methods
+    uint32_t            findMemoryTypeIndex(uint32_t allowedTypes, VkMemoryPropertyFlags properties) const;
+    MemoryBlock *       createBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated);
+    void                destroyBlock(MemoryBlock * block);
+};
+
+#pragma warning( pop )
@@ -0,0 +1,187 @@
+#include "FrustumCuller.h"
+
+// No fused multiply-add in this file: with FMA enabled (-mfma, -march=native, /arch:AVX2) the compiler may otherwise
+// contract the scalar path's a * b + c, or the SIMD mul/add intrinsics, differently from one path to the other,
+// and a sphere right on a plane would be visible in one and culled in the other
+#if defined(_MSC_VER) && !defined(__clang__)
+#pragma fp_contract(off)
+#elif defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+//------------------------------------------------------------------------------
+FrustumCuller::FrustumCuller()
+{
+}
+//------------------------------------------------------------------------------
+void FrustumCuller::resize(uint32_t objectCount)
+{
+    // Padding spheres are never reported (their index is past the object count)
+    size_t paddedCount = (static_cast<size_t>(objectCount) + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    m_centerX.resize(paddedCount, 0.0f);
+    m_centerY.resize(paddedCount, 0.0f);
+    m_centerZ.resize(paddedCount, 0.0f);
+    m_radius.resize(paddedCount, 0.0f);
+    m_objectCount = objectCount;
+}
+//------------------------------------------------------------------------------
+void FrustumCuller::setSphere(uint32_t objectIdx, const glm::vec4 &worldSphere)
+{
+    m_centerX[objectIdx] = worldSphere.x;
+    m_centerY[objectIdx] = worldSphere.y;
+    m_centerZ[objectIdx] = worldSphere.z;
+    m_radius[objectIdx] = worldSphere.w;
+}
+//------------------------------------------------------------------------------
+uint32_t FrustumCuller::getObjectCount() const
+{
+    return m_objectCount;
+}
+//------------------------------------------------------------------------------
+void FrustumCuller::extractPlanes(const glm::mat4 &viewProjection, glm::vec4 planes[6])
+{
+    // Rows of the matrix (GLM is column major)
+    glm::mat4 rows = glm::transpose(viewProjection);
+    planes[0] = rows[3] + rows[0];      // Left
+    planes[1] = rows[3] - rows[0];      // Right
+    planes[2] = rows[3] + rows[1];      // Bottom
+    planes[3] = rows[3] - rows[1];      // Top
+    planes[4] = rows[2];                // Near
+    planes[5] = rows[3] - rows[2];      // Far
+
+    for (int i = 0; i < 6; i++)
+    {
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+}
+//------------------------------------------------------------------------------
+uint32_t FrustumCuller::cull(const glm::mat4 &viewProjection, std::vector<uint32_t> &visibleObjects, bool useSimd) const
+{
+    glm::vec4 planes[6];
+    extractPlanes(viewProjection, planes);
+
+    visibleObjects.clear();
+    if (useSimd)
+    {
+        cullSimd(planes, visibleObjects);
+    }
+    else
+    {
+        cullScalar(planes, visibleObjects);
+    }
+
+    return static_cast<uint32_t>(visibleObjects.size());
+}
+//------------------------------------------------------------------------------
+const char * FrustumCuller::getSimdName()
+{
+#if defined(FRUSTUM_CULLER_AVX)
+    return "AVX";
+#elif defined(FRUSTUM_CULLER_SSE2)
+    return "SSE2";
+#else
+    return "none";
+#endif
+}
+//------------------------------------------------------------------------------
+FrustumCuller::~FrustumCuller()
+{
+}
+//------------------------------------------------------------------------------
+void FrustumCuller::cullScalar(const glm::vec4 planes[6], std::vector<uint32_t> &visibleObjects) const
+{
+    // Same operations, in the same order, as the SIMD paths (contraction is off for this file): same results
+    for (uint32_t i = 0; i < m_objectCount; i++)
+    {
+        bool visible = true;
+        for (int p = 0; p < 6; p++)
+        {
+            float distance = planes[p].x * m_centerX[i] + planes[p].y * m_centerY[i] + planes[p].z * m_centerZ[i] + planes[p].w;
+            visible = visible && (distance >= -m_radius[i]);
+        }
+
+        if (visible)
+        {
+            visibleObjects.push_back(i);
+        }
+    }
+}
+//------------------------------------------------------------------------------
+void FrustumCuller::cullSimd(const glm::vec4 planes[6], std::vector<uint32_t> &visibleObjects) const
+{
+#if defined(FRUSTUM_CULLER_AVX)
+    // 8 spheres per test: distance to each plane >= -radius, for all 6 planes
+    __m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+    for (int p = 0; p < 6; p++)
+    {
+        planeX[p] = _mm256_set1_ps(planes[p].x);
+        planeY[p] = _mm256_set1_ps(planes[p].y);
+        planeZ[p] = _mm256_set1_ps(planes[p].z);
+        planeW[p] = _mm256_set1_ps(planes[p].w);
+    }
+
+    for (uint32_t i = 0; i < m_objectCount; i += 8)
+    {
+        __m256 centerX = _mm256_loadu_ps(&m_centerX[i]);
+        __m256 centerY = _mm256_loadu_ps(&m_centerY[i]);
+        __m256 centerZ = _mm256_loadu_ps(&m_centerZ[i]);
+        __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&m_radius[i]));
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; p++)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+                _mm256_mul_ps(planeX[p], centerX), _mm256_mul_ps(planeY[p], centerY)), _mm256_mul_ps(planeZ[p], centerZ)), planeW[p]);
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+        }
+
+        int mask = _mm256_movemask_ps(inside);
+        for (uint32_t k = 0; mask != 0; k++, mask >>= 1)
+        {
+            if ((mask & 1) && i + k < m_objectCount)
+            {
+                visibleObjects.push_back(i + k);
+            }
+        }
+    }
+#elif defined(FRUSTUM_CULLER_SSE2)
+    // 4 spheres per test: distance to each plane >= -radius, for all 6 planes
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+    for (int p = 0; p < 6; p++)
+    {
+        planeX[p] = _mm_set1_ps(planes[p].x);
+        planeY[p] = _mm_set1_ps(planes[p].y);
+        planeZ[p] = _mm_set1_ps(planes[p].z);
+        planeW[p] = _mm_set1_ps(planes[p].w);
+    }
+
+    for (uint32_t i = 0; i < m_objectCount; i += 4)
+    {
+        __m128 centerX = _mm_loadu_ps(&m_centerX[i]);
+        __m128 centerY = _mm_loadu_ps(&m_centerY[i]);
+        __m128 centerZ = _mm_loadu_ps(&m_centerZ[i]);
+        __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&m_radius[i]));
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; p++)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(planeX[p], centerX), _mm_mul_ps(planeY[p], centerY)), _mm_mul_ps(planeZ[p], centerZ)), planeW[p]);
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        for (uint32_t k = 0; mask != 0; k++, mask >>= 1)
+        {
+            if ((mask & 1) && i + k < m_objectCount)
+            {
+                visibleObjects.push_back(i + k);
+            }
+        }
+    }
+#else
+    cullScalar(planes, visibleObjects);
+#endif
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+// C++ STL
+#include <cstdint>
+#include <vector>
+
+// Project includes
+#include "Utilities.h"
+
+// SIMD width picked at compile time: AVX when the compiler targets it (/arch:AVX, -mavx), SSE2 on any x86-64
+#if defined(__AVX__)
+#define FRUSTUM_CULLER_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_CULLER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// CPU visibility of many bounding spheres against the view frustum. The spheres are stored as a structure of arrays
+// (one array per component, padded to the SIMD width) so that a SIMD test covers 4 (SSE2) or 8 (AVX) objects
+// per instruction; the scalar path gives the same results.
+class FrustumCuller
+{
+public:
+    static const uint32_t SIMD_WIDTH = 8;   // Padding of the arrays (enough for both SSE2 and AVX)
+
+    FrustumCuller();
+
+    void        resize(uint32_t objectCount);
+    void        setSphere(uint32_t objectIdx, const glm::vec4 &worldSphere);    // xyz center, w radius (world space)
+    uint32_t    getObjectCount() const;
+
+    // Normalized planes (xyz normal pointing inside, w distance) of the rows of the ViewProjection matrix
+    // (Vulkan depth range [0, 1]): left, right, bottom, top, near, far. Same planes as cull.comp
+    static void extractPlanes(const glm::mat4 &viewProjection, glm::vec4 planes[6]);
+
+    // Indices of the visible objects (in increasing order) into 'visibleObjects'. Returns their count
+    uint32_t    cull(const glm::mat4 &viewProjection, std::vector<uint32_t> &visibleObjects, bool useSimd = true) const;
+
+    static const char * getSimdName();      // "AVX", "SSE2" or "none" (scalar only)
+
+    ~FrustumCuller();
+
+private:
+    std::vector<float>  m_centerX;
+    std::vector<float>  m_centerY;
+    std::vector<float>  m_centerZ;
+    std::vector<float>  m_radius;
+    uint32_t            m_objectCount = 0;
+
+    // Methods
+    void        cullScalar(const glm::vec4 planes[6], std::vector<uint32_t> &visibleObjects) const;
+    void        cullSimd(const glm::vec4 planes[6], std::vector<uint32_t> &visibleObjects) const;
+};
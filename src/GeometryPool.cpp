@@ -0,0 +1,242 @@
+#include "GeometryPool.h"
+
+// C++ STL
+#include <algorithm>
+#include <stdexcept>
+
+// Disable warning about Vulkan unscoped enums for this entire file
+#pragma warning( push )
+#pragma warning(disable : 26812) // The enum type * is unscoped. Prefer 'enum class' over 'enum'.
+
+GeometryPool::GeometryPool()
+{
+}
+
+void GeometryPool::init(VkDevice device, DeviceMemoryAllocator * allocator, UploadBatcher * uploadBatcher,
+                        VkQueue graphicsQueue, VkCommandPool graphicsCommandPool,
+                        VkDeviceSize vertexCapacity, VkDeviceSize indexCapacity)
+{
+    m_device = device;
+    m_allocator = allocator;
+    m_uploadBatcher = uploadBatcher;
+    m_graphicsQueue = graphicsQueue;
+    m_graphicsCommandPool = graphicsCommandPool;
+
+    // TRANSFER_SRC too: the content is copied to the new buffer when growing
+    createPoolBuffer(m_vertices, vertexCapacity,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    createPoolBuffer(m_indices, indexCapacity,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+}
+
+void GeometryPool::destroy()
+{
+    destroyBuffer(m_device, m_allocator, m_vertices.buffer, &m_vertices.memory);
+    destroyBuffer(m_device, m_allocator, m_indices.buffer, &m_indices.memory);
+    m_vertices = PoolBuffer();
+    m_indices = PoolBuffer();
+}
+
+GeometryAllocation GeometryPool::allocate(const std::vector<Vertex> * vertices, const std::vector<uint32_t> * indices, bool allowShortIndices)
+{
+    return allocate(vertices->data(), static_cast<uint32_t>(vertices->size()), sizeof(Vertex), indices, allowShortIndices);
+}
+
+GeometryAllocation GeometryPool::allocate(  const void * vertexData, uint32_t vertexCount, VkDeviceSize vertexStride,
+                                            const std::vector<uint32_t> * indices, bool allowShortIndices)
+{
+    // Indices are relative to the first vertex of the mesh (vertexOffset), so only its own vertex count matters
+    bool shortIndices = allowShortIndices && vertexCount <= MAX_SHORT_INDEX_VERTICES;
+    if (shortIndices)
+    {
+        // Narrowed copy: the batcher stages the data right away, so it can be a temporary
+        std::vector<uint16_t> shortIndexData(indices->begin(), indices->end());
+        return allocate(vertexData, vertexCount, vertexStride, shortIndexData.data(), static_cast<uint32_t>(shortIndexData.size()), VK_INDEX_TYPE_UINT16);
+    }
+
+    return allocate(vertexData, vertexCount, vertexStride, indices->data(), static_cast<uint32_t>(indices->size()), VK_INDEX_TYPE_UINT32);
+}
+
+GeometryAllocation GeometryPool::allocate(  const void * vertexData, uint32_t vertexCount, VkDeviceSize vertexStride,
+                                            const void * indexData, uint32_t indexCount, VkIndexType indexType)
+{
+    VkDeviceSize indexSize = (indexType == VK_INDEX_TYPE_UINT16) ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    GeometryAllocation allocation = {};
+    allocation.vertexCount = vertexCount;
+    allocation.vertexBytes = vertexStride * vertexCount;
+    allocation.indexCount = indexCount;
+    allocation.indexBytes = indexSize * indexCount;
+    allocation.indexType = indexType;
+
+    // Ranges aligned to the element size, so that they can be addressed in vertices/indices by the draw
+    allocation.vertexByteOffset = allocateRange(m_vertices, allocation.vertexBytes, vertexStride);
+    allocation.indexByteOffset = allocateRange(m_indices, allocation.indexBytes, indexSize);
+
+    allocation.vertexOffset = static_cast<int32_t>(allocation.vertexByteOffset / vertexStride);
+    allocation.firstIndex = static_cast<uint32_t>(allocation.indexByteOffset / indexSize);
+
+    // "Stage" the data and record its copy to the shared buffers on GPU (submitted with the rest of the batch)
+    m_uploadBatcher->upload(vertexData, allocation.vertexBytes, m_vertices.buffer, allocation.vertexByteOffset);
+    allocation.uploadTicket = m_uploadBatcher->upload(indexData, allocation.indexBytes, m_indices.buffer, allocation.indexByteOffset);
+
+    return allocation;
+}
+
+void GeometryPool::free(GeometryAllocation &allocation)
+{
+    m_vertices.ranges.free(allocation.vertexByteOffset, allocation.vertexBytes);
+    m_indices.ranges.free(allocation.indexByteOffset, allocation.indexBytes);
+
+    allocation = {};
+}
+
+VkBuffer GeometryPool::getVertexBuffer() const
+{
+    return m_vertices.buffer;
+}
+
+VkBuffer GeometryPool::getIndexBuffer() const
+{
+    return m_indices.buffer;
+}
+
+uint64_t GeometryPool::getGeneration() const
+{
+    return m_generation;
+}
+
+VkDeviceSize GeometryPool::getVertexCapacity() const
+{
+    return m_vertices.ranges.getSize();
+}
+
+VkDeviceSize GeometryPool::getIndexCapacity() const
+{
+    return m_indices.ranges.getSize();
+}
+
+VkDeviceSize GeometryPool::getUsedVertexBytes() const
+{
+    return m_vertices.ranges.getUsedSize();
+}
+
+VkDeviceSize GeometryPool::getUsedIndexBytes() const
+{
+    return m_indices.ranges.getUsedSize();
+}
+
+GeometryPool::~GeometryPool()
+{
+}
+
+
+// Private methods
+void GeometryPool::createPoolBuffer(PoolBuffer &poolBuffer, VkDeviceSize capacity, VkBufferUsageFlags usage)
+{
+    // Buffer memory is to be DEVICE_LOCAL_BIT meaning memory is on the GPU and only accessible by it and not CPU (host)
+    createBuffer(m_device, m_allocator, capacity, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &poolBuffer.buffer, &poolBuffer.memory);
+    poolBuffer.ranges = RangeAllocator(capacity);
+    poolBuffer.usage = usage;
+}
+
+VkDeviceSize GeometryPool::allocateRange(PoolBuffer &poolBuffer, VkDeviceSize size, VkDeviceSize alignment)
+{
+    VkDeviceSize offset = poolBuffer.ranges.allocate(size, alignment);
+    if (offset == RangeAllocator::INVALID_OFFSET)
+    {
+        // Worst case the free range at the end of the grown buffer loses 'alignment - 1' bytes to padding
+        grow(poolBuffer, size + alignment);
+        offset = poolBuffer.ranges.allocate(size, alignment);
+    }
+
+    if (offset == RangeAllocator::INVALID_OFFSET)
+    {
+        throw std::runtime_error("Failed to allocate a Geometry Pool range!");
+    }
+
+    return offset;
+}
+
+void GeometryPool::grow(PoolBuffer &poolBuffer, VkDeviceSize minFreeSize)
+{
+    // Capacity doubles, so growing is rare and it's fine to stall here: pending uploads must land in the old buffer
+    // and no frame in flight may still be reading it
+    m_uploadBatcher->wait(m_uploadBatcher->flush());
+    vkDeviceWaitIdle(m_device);
+
+    VkDeviceSize oldCapacity = poolBuffer.ranges.getSize();
+    VkDeviceSize newCapacity = std::max(oldCapacity * 2, oldCapacity + minFreeSize);
+
+    PoolBuffer newBuffer;
+    createPoolBuffer(newBuffer, newCapacity, poolBuffer.usage);
+
+    // Copy the old content on the graphics queue (the ranges are owned by the graphics queue family by now)
+    copyPoolBuffer(poolBuffer.buffer, newBuffer.buffer, oldCapacity);
+
+    destroyBuffer(m_device, m_allocator, poolBuffer.buffer, &poolBuffer.memory);
+
+    // Same ranges as before, plus the new space at the end
+    poolBuffer.buffer = newBuffer.buffer;
+    poolBuffer.memory = newBuffer.memory;
+    poolBuffer.ranges.grow(newCapacity);
+
+    m_generation++;
+}
+
+void GeometryPool::copyPoolBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+{
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = m_graphicsCommandPool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    vkAllocateCommandBuffers(m_device, &allocInfo, &commandBuffer);
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    // A host wait doesn't make device writes visible: the uploads into the old buffer were only made visible to
+    // vertex input, the copy reads it as a transfer
+    VkBufferMemoryBarrier bufferBarrier = {};
+    bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.buffer = srcBuffer;
+    bufferBarrier.offset = 0;
+    bufferBarrier.size = size;
+    bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+    VkBufferCopy bufferCopyRegion = {};
+    bufferCopyRegion.size = size;
+    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &bufferCopyRegion);
+
+    // The copied geometry is read by the draws of the later submissions on this queue
+    bufferBarrier.buffer = dstBuffer;
+    bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0,
+        0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+    vkEndCommandBuffer(commandBuffer);
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    // The old buffer is destroyed right after: wait for the copy
+    vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+    vkQueueWaitIdle(m_graphicsQueue);
+
+    vkFreeCommandBuffers(m_device, m_graphicsCommandPool, 1, &commandBuffer);
+}
+
+#pragma warning( pop )
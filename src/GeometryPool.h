@@ -0,0 +1,103 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+// C++ STL
+#include <vector>
+
+// Project includes
+#include "DeviceMemoryAllocator.h"
+#include "RangeAllocator.h"
+#include "UploadBatcher.h"
+#include "Utilities.h"
+
+// Disable warning about Vulkan unscoped enums for this entire file
+#pragma warning( push )
+#pragma warning(disable : 26812) // The enum type * is unscoped. Prefer 'enum class' over 'enum'.
+
+// Where the geometry of a mesh lives inside the GeometryPool buffers
+struct GeometryAllocation {
+    VkDeviceSize    vertexByteOffset = RangeAllocator::INVALID_OFFSET;
+    VkDeviceSize    vertexBytes = 0;
+    int32_t         vertexOffset = 0;           // In vertices: 'vertexOffset' of vkCmdDrawIndexed
+    uint32_t        vertexCount = 0;
+
+    VkDeviceSize    indexByteOffset = RangeAllocator::INVALID_OFFSET;
+    VkDeviceSize    indexBytes = 0;
+    uint32_t        firstIndex = 0;             // In indices (of indexType): 'firstIndex' of vkCmdDrawIndexed
+    uint32_t        indexCount = 0;
+    VkIndexType     indexType = VK_INDEX_TYPE_UINT32;   // The index buffer must be bound with this type to draw the mesh
+
+    uint64_t        uploadTicket = 0;           // Upload batch filling the ranges (see UploadBatcher)
+};
+
+// One big vertex buffer and one big index buffer shared by all the meshes, so that they're bound once per
+// command buffer and every mesh is drawn through offsets. The index buffer holds both uint16_t and uint32_t indices
+// (each range aligned to its own index size): it's rebound only when the index type changes between two draws. Ranges are handed out by RangeAllocators; when a buffer
+// is full it's replaced by a bigger one (and getGeneration() changes: command buffers binding the old one must be re-recorded).
+class GeometryPool
+{
+public:
+    static const VkDeviceSize DEFAULT_VERTEX_CAPACITY = 16ULL * 1024 * 1024;  // 16 MiB
+    static const VkDeviceSize DEFAULT_INDEX_CAPACITY = 8ULL * 1024 * 1024;    // 8 MiB
+    static const size_t MAX_SHORT_INDEX_VERTICES = 65536;                      // Mesh-relative indices fit in uint16_t
+
+    GeometryPool();
+
+    // graphicsQueue/graphicsCommandPool are used to copy the old content when growing
+    void                init(   VkDevice device, DeviceMemoryAllocator * allocator, UploadBatcher * uploadBatcher,
+                                VkQueue graphicsQueue, VkCommandPool graphicsCommandPool,
+                                VkDeviceSize vertexCapacity = DEFAULT_VERTEX_CAPACITY, VkDeviceSize indexCapacity = DEFAULT_INDEX_CAPACITY);
+    void                destroy();
+
+    // Reserves the ranges of a mesh and uploads its data (non-blocking, see GeometryAllocation::uploadTicket).
+    // Indices are stored as uint16_t when the mesh has few enough vertices, unless 'allowShortIndices' is false
+    GeometryAllocation  allocate(const std::vector<Vertex> * vertices, const std::vector<uint32_t> * indices, bool allowShortIndices = true);
+    // Any vertex layout (see VertexFormat): 'vertexOffset' is counted in vertices of 'vertexStride' bytes
+    GeometryAllocation  allocate(const void * vertexData, uint32_t vertexCount, VkDeviceSize vertexStride,
+                                 const std::vector<uint32_t> * indices, bool allowShortIndices = true);
+    // Data already in its final layout (e.g. mapped from a MeshCache file): staged as is, without any conversion
+    GeometryAllocation  allocate(const void * vertexData, uint32_t vertexCount, VkDeviceSize vertexStride,
+                                 const void * indexData, uint32_t indexCount, VkIndexType indexType);
+    // N.B.: the GPU must be done with the ranges (they can be handed out again right away)
+    void                free(GeometryAllocation &allocation);
+
+    VkBuffer            getVertexBuffer() const;
+    VkBuffer            getIndexBuffer() const;
+    uint64_t            getGeneration() const;      // Incremented every time a buffer is replaced by a bigger one
+
+    VkDeviceSize        getVertexCapacity() const;
+    VkDeviceSize        getIndexCapacity() const;
+    VkDeviceSize        getUsedVertexBytes() const;
+    VkDeviceSize        getUsedIndexBytes() const;
+
+    ~GeometryPool();
+
+private:
+    struct PoolBuffer {
+        VkBuffer            buffer = 0;
+        MemoryAllocation    memory;
+        RangeAllocator      ranges;
+        VkBufferUsageFlags  usage = 0;
+    };
+
+    VkDevice                    m_device = nullptr;
+    DeviceMemoryAllocator *     m_allocator = nullptr;
+    UploadBatcher *             m_uploadBatcher = nullptr;
+    VkQueue                     m_graphicsQueue = nullptr;
+    VkCommandPool               m_graphicsCommandPool = 0;
+
+    PoolBuffer                  m_vertices;
+    PoolBuffer                  m_indices;
+    uint64_t                    m_generation = 1U;
+
+    // Methods
+    void                createPoolBuffer(PoolBuffer &poolBuffer, VkDeviceSize capacity, VkBufferUsageFlags usage);
+    VkDeviceSize        allocateRange(PoolBuffer &poolBuffer, VkDeviceSize size, VkDeviceSize alignment);
+    void                grow(PoolBuffer &poolBuffer, VkDeviceSize minFreeSize);
+    // Blocking copy between two pool buffers, with the barriers making it safe for the transfer and for vertex input
+    void                copyPoolBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+};
+
+#pragma warning( pop )
@@ -6,116 +6,245 @@
 
 Mesh::Mesh()
 {
+    m_uboModel.model = glm::mat4(1.0f);
+    m_lods.resize(1);
 }
 
-Mesh::Mesh( VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, 
-            VkQueue transferQueue, VkCommandPool transferCommandPool, 
-            std::vector<Vertex>* vertices, std::vector<uint32_t> * indices)
+Mesh::Mesh( GeometryPool * geometryPool,
+            std::vector<Vertex>* vertices, std::vector<uint32_t> * indices,
+            bool allowShortIndices, VertexFormat vertexFormat, uint32_t maxLodCount)
 {
-    m_vertexCount = static_cast<uint32_t>(vertices->size());
-    m_indexCount = static_cast<uint32_t>(indices->size());
-    m_physicalDevice = newPhysicalDevice;
-    m_device = newDevice;
-    createVertexBuffer(transferQueue, transferCommandPool, vertices);
-    createIndexBuffer(transferQueue, transferCommandPool, indices);
+    m_uboModel.model = glm::mat4(1.0f);
+    m_geometryPool = geometryPool;
+
+    // LOD chain: every LOD is simplified from the full mesh (so its error is relative to the full surface),
+    // and its indices are appended after those of the previous LOD
+    std::vector<uint32_t> lodIndices = *indices;
+    m_lods.push_back({ 0, static_cast<uint32_t>(indices->size()), 0.0f });
+    maxLodCount = std::min(maxLodCount, static_cast<uint32_t>(MAX_MESH_LODS));
+    while (m_lods.size() < maxLodCount)
+    {
+        const MeshLod &previousLod = m_lods.back();
+
+        float error = 0.0f;
+        std::vector<uint32_t> simplifiedIndices = MeshSimplifier::simplify(*vertices, *indices, previousLod.indexCount / 2, error);
+
+        // Not worth a LOD (the mesh can't be simplified much further)
+        if (simplifiedIndices.empty() || simplifiedIndices.size() > previousLod.indexCount * 3 / 4)
+        {
+            break;
+        }
+
+        m_lods.push_back({ static_cast<uint32_t>(lodIndices.size()), static_cast<uint32_t>(simplifiedIndices.size()), error });
+        lodIndices.insert(lodIndices.end(), simplifiedIndices.begin(), simplifiedIndices.end());
+    }
+
+    // Reserve ranges of the shared buffers and upload vertices and indices there
+    if (vertexFormat == VertexFormat::Quantized)
+    {
+        // Positions relative to the bounding box: the box goes to the vertex shader with the Model matrix
+        glm::vec3 positionOffset;
+        glm::vec3 positionScale;
+        std::vector<QuantizedVertex> quantizedVertices = quantizeVertices(*vertices, positionOffset, positionScale);
+        m_uboModel.positionOffset = glm::vec4(positionOffset, 0.0f);
+        m_uboModel.positionScale = glm::vec4(positionScale, 1.0f);
+
+        m_geometry = m_geometryPool->allocate(quantizedVertices.data(), static_cast<uint32_t>(quantizedVertices.size()),
+            sizeof(QuantizedVertex), &lodIndices, allowShortIndices);
+    }
+    else
+    {
+        m_geometry = m_geometryPool->allocate(vertices, &lodIndices, allowShortIndices);
+    }
+
+    m_boundingSphere = computeBoundingSphere(*vertices);
+}
+
+Mesh::Mesh(GeometryPool * geometryPool, const EncodedMeshData &meshData, bool allowShortIndices)
+{
+    m_uboModel.model = glm::mat4(1.0f);
+    m_uboModel.positionOffset = meshData.positionOffset;
+    m_uboModel.positionScale = meshData.positionScale;
+    m_boundingSphere = meshData.boundingSphere;
+    m_geometryPool = geometryPool;
+
+    if (meshData.indexType == VK_INDEX_TYPE_UINT16 && !allowShortIndices)
+    {
+        const uint16_t * shortIndices = static_cast<const uint16_t *>(meshData.indexData);
+        std::vector<uint32_t> indices(shortIndices, shortIndices + meshData.indexCount);
+        m_geometry = m_geometryPool->allocate(meshData.vertexData, meshData.vertexCount, meshData.vertexStride,
+            indices.data(), meshData.indexCount, VK_INDEX_TYPE_UINT32);
+    }
+    else
+    {
+        m_geometry = m_geometryPool->allocate(meshData.vertexData, meshData.vertexCount, meshData.vertexStride,
+            meshData.indexData, meshData.indexCount, meshData.indexType);
+    }
+
+    m_lods.push_back({ 0, meshData.indexCount, 0.0f });
+
+    Meshlet meshlet;
+    meshlet.boundingSphere = meshData.boundingSphere;
+    meshlet.normalCone = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);     // Never culled as backfacing
+    meshlet.firstIndex = 0;
+    meshlet.indexCount = meshData.indexCount;
+    m_meshlets.push_back(meshlet);
+}
+
+glm::vec4 Mesh::computeBoundingSphere(const std::vector<Vertex> &vertices)
+{
+    // Bounding sphere (for culling) around the center of the bounding box: not the tightest, but a single pass
+    if (vertices.empty())
+    {
+        return glm::vec4(0.0f);
+    }
+
+    glm::vec3 minPos = vertices.front().pos;
+    glm::vec3 maxPos = vertices.front().pos;
+    for (const auto &vertex : vertices)
+    {
+        minPos = glm::min(minPos, vertex.pos);
+        maxPos = glm::max(maxPos, vertex.pos);
+    }
+
+    glm::vec3 center = (minPos + maxPos) * 0.5f;
+    float radius = 0.0f;
+    for (const auto &vertex : vertices)
+    {
+        radius = std::max(radius, glm::length(vertex.pos - center));
+    }
+
+    return glm::vec4(center, radius);
 }
 
 uint32_t Mesh::getVertexCount()
 {
-    return m_vertexCount;
+    return m_geometry.vertexCount;
+}
+
+int32_t Mesh::getVertexOffset()
+{
+    return m_geometry.vertexOffset;
 }
 
 VkBuffer Mesh::getVertexBuffer()
 {
-    return m_vertexBuffer;
+    return m_geometryPool->getVertexBuffer();
 }
 
 uint32_t Mesh::getIndexCount()
 {
-    return m_indexCount;
+    return m_lods[0].indexCount;
+}
+
+uint32_t Mesh::getFirstIndex()
+{
+    return m_geometry.firstIndex;
+}
+
+VkIndexType Mesh::getIndexType()
+{
+    return m_geometry.indexType;
 }
 
 VkBuffer Mesh::getIndexBuffer()
 {
-    return m_indexBuffer;
+    return m_geometryPool->getIndexBuffer();
 }
 
-void Mesh::destroyBuffers()
+uint32_t Mesh::getLodCount()
 {
-    // Vertex Buffer Destroy + Free
-    vkDestroyBuffer(m_device, m_vertexBuffer, nullptr);
-    vkFreeMemory(m_device, m_vertexBufferMemory, nullptr);
-    // Index Buffer Destroy + Free
-    vkDestroyBuffer(m_device, m_indexBuffer, nullptr);
-    vkFreeMemory(m_device, m_indexBufferMemory, nullptr);
+    return static_cast<uint32_t>(m_lods.size());
 }
 
-Mesh::~Mesh()
+MeshLod Mesh::getLod(uint32_t lod)
+{
+    // Index range relative to the pool index buffer
+    MeshLod meshLod = m_lods[std::min(lod, getLodCount() - 1)];
+    meshLod.firstIndex += m_geometry.firstIndex;
+    return meshLod;
+}
+
+void Mesh::buildMeshlets(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices)
 {
+    m_meshlets = MeshletBuilder::build(vertices, indices);
 }
 
+uint32_t Mesh::getMeshletCount()
+{
+    return static_cast<uint32_t>(m_meshlets.size());
+}
 
-// Private methods
-void Mesh::createVertexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<Vertex>* vertices)
+Meshlet Mesh::getMeshlet(uint32_t meshlet)
 {
-    // Get size of buffer needed for vertices
-    VkDeviceSize bufferSize = sizeof(Vertex) * vertices->size();
+    // Index range relative to the pool index buffer
+    Meshlet poolMeshlet = m_meshlets[meshlet];
+    poolMeshlet.firstIndex += m_geometry.firstIndex;
+    return poolMeshlet;
+}
 
-    // Temporary buffer to "stage" vertex data before transferring to GPU
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
+uint64_t Mesh::getUploadTicket()
+{
+    return m_geometry.uploadTicket;
+}
 
-    // Create Staging Buffer and Allocate Memory to it
-    createBuffer(m_physicalDevice, m_device, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        &stagingBuffer, &stagingBufferMemory);
+glm::vec4 Mesh::getBoundingSphere()
+{
+    return m_boundingSphere;
+}
 
-    // MAP MEMORY TO VERTEX BUFFER (staging)
-    void * data;                                                            // 1. Create pointer to a point in normal memory
-    vkMapMemory(m_device, stagingBufferMemory, 0, bufferSize, 0, &data);    // 2. "Map" the vertex buffer memory to that point
-    memcpy(data, vertices->data(), (size_t)bufferSize);                     // 3. Copy memory from vertices vector to the point
-    vkUnmapMemory(m_device, stagingBufferMemory);                           // 4. Unmap the vertex buffer memory
+void Mesh::createInstanceBuffer(VkDevice device, DeviceMemoryAllocator * allocator, UploadBatcher * uploadBatcher,
+                                std::vector<InstanceData> * instances)
+{
+    m_device = device;
+    m_allocator = allocator;
+    m_instanceCount = static_cast<uint32_t>(instances->size());
 
-    // Create buffer with TRANSFER_DST_BIT to mark as recipient of transfer data (also VERTEX_BUFFER)
-    // Buffer memory is to be DEVICE_LOCAL_BIT meaning memory is on the GPU and only accessible by it and not CPU (host)
-    createBuffer(m_physicalDevice, m_device, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_vertexBuffer, &m_vertexBufferMemory);
+    // Device local, read by the vertex input at instance rate
+    VkDeviceSize bufferSize = sizeof(InstanceData) * instances->size();
+    createBuffer(device, allocator, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_instanceBuffer, &m_instanceBufferMemory);
 
-    // Copy staging buffer to vertex buffer on GPU
-    copyBuffer(m_device, transferQueue, transferCommandPool, stagingBuffer, m_vertexBuffer, bufferSize);
+    // Recorded only: visible to the vertex input once the batch is flushed (like the geometry)
+    uploadBatcher->upload(instances->data(), bufferSize, m_instanceBuffer);
+}
 
-    // Destroy + Release Staging Buffer resources
-    vkDestroyBuffer(m_device, stagingBuffer, nullptr);
-    vkFreeMemory(m_device, stagingBufferMemory, nullptr);
+VkBuffer Mesh::getInstanceBuffer()
+{
+    return m_instanceBuffer;
 }
 
-void Mesh::createIndexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<uint32_t>* indices)
+uint32_t Mesh::getInstanceCount()
 {
-    // Get size of buffer needed for indices
-    VkDeviceSize bufferSize = sizeof(uint32_t) * indices->size();
-    
-    // Temporary buffer to "stage" index data before transferring to GPU
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(m_physicalDevice, m_device, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, &stagingBufferMemory);
+    return m_instanceCount;
+}
 
-    // MAP MEMORY TO INDEX BUFFER (staging)
-    void * data;                                                                
-    vkMapMemory(m_device, stagingBufferMemory, 0, bufferSize, 0, &data);            
-    memcpy(data, indices->data(), (size_t)bufferSize);                            
-    vkUnmapMemory(m_device, stagingBufferMemory);
+void Mesh::setModel(glm::mat4 newModel)
+{
+    m_uboModel.model = newModel;
+}
 
-    // Create buffer for INDEX data on GPU access only area
-    createBuffer(m_physicalDevice, m_device, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_indexBuffer, &m_indexBufferMemory);
+UboModel Mesh::getModel()
+{
+    return m_uboModel;
+}
 
-    // Copy from staging buffer to GPU access buffer
-    copyBuffer(m_device, transferQueue, transferCommandPool, stagingBuffer, m_indexBuffer, bufferSize);
+void Mesh::destroyBuffers()
+{
+    if (m_geometryPool != nullptr)
+    {
+        m_geometryPool->free(m_geometry);
+    }
+
+    if (m_instanceBuffer != VK_NULL_HANDLE)
+    {
+        destroyBuffer(m_device, m_allocator, m_instanceBuffer, &m_instanceBufferMemory);
+        m_instanceBuffer = VK_NULL_HANDLE;
+    }
+}
 
-    // Destroy + Release Staging Buffer resources
-    vkDestroyBuffer(m_device, stagingBuffer, nullptr);
-    vkFreeMemory(m_device, stagingBufferMemory, nullptr);
+Mesh::~Mesh()
+{
 }
 
 #pragma warning( pop )
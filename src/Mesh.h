@@ -3,42 +3,104 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
 #include <vector>
 
+#include "GeometryPool.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
 #include "Utilities.h"
+#include "VertexFormat.h"
 
+// Per-object data of the dynamic uniform buffer (binding 1 of the vertex shader), push constants and model storage buffer
+struct UboModel {
+    glm::mat4 model;
+    glm::vec4 positionOffset = glm::vec4(0.0f);     // Dequantization of the vertex positions (xyz):
+    glm::vec4 positionScale = glm::vec4(1.0f);      // position = positionOffset + vertex position * positionScale
+};
+
+// Level of detail of a mesh: a range of the pool index buffer (all the LODs of a mesh share its vertices)
+struct MeshLod {
+    uint32_t    firstIndex = 0;     // In indices of the mesh index type (like Mesh::getFirstIndex())
+    uint32_t    indexCount = 0;
+    float       error = 0.0f;       // Model space distance to the full resolution surface (0 for LOD 0)
+};
+
+// Geometry already in its GPU layout (e.g. mapped from a MeshCache file): uploaded as is, without any conversion
+struct EncodedMeshData {
+    const void *    vertexData = nullptr;
+    uint32_t        vertexCount = 0;
+    VkDeviceSize    vertexStride = 0;           // Of the layout of the pipeline (see VertexFormat)
+    const void *    indexData = nullptr;
+    uint32_t        indexCount = 0;
+    VkIndexType     indexType = VK_INDEX_TYPE_UINT32;
+    glm::vec4       boundingSphere = glm::vec4(0.0f);       // Model space: xyz center, w radius
+    glm::vec4       positionOffset = glm::vec4(0.0f);       // Dequantization of the positions (see UboModel)
+    glm::vec4       positionScale = glm::vec4(1.0f);
+};
+
+// Handle to the geometry of a mesh inside the shared GeometryPool buffers (plus its Model matrix)
 class Mesh
 {
 public:
     Mesh();
-    Mesh(   VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, 
-            VkQueue transferQueue, VkCommandPool transferCommandPool, 
-            std::vector<Vertex> * vertices, std::vector<uint32_t> * indices);
+    Mesh(   GeometryPool * geometryPool,
+            std::vector<Vertex> * vertices, std::vector<uint32_t> * indices,
+            bool allowShortIndices = true,      // false: always uint32_t indices (e.g. all the draws share one index type)
+            VertexFormat vertexFormat = VertexFormat::Float,
+            uint32_t maxLodCount = 1);          // >1: chain of simplified LODs (each about half the triangles of the previous one)
+    // Single LOD, and a single meshlet covering the whole mesh (no per-cluster data without the vertices)
+    Mesh(   GeometryPool * geometryPool, const EncodedMeshData &meshData,
+            bool allowShortIndices = true);     // false: uint16_t indices are widened (slow path: not a straight copy anymore)
+
+    static glm::vec4    computeBoundingSphere(const std::vector<Vertex> &vertices);     // Around the center of the bounding box
 
     uint32_t    getVertexCount();
-    VkBuffer    getVertexBuffer();
+    int32_t     getVertexOffset();              // First vertex inside the pool vertex buffer
+    VkBuffer    getVertexBuffer();              // Shared by all the meshes of the pool
+
+    uint32_t    getIndexCount();                // Of LOD 0 (full resolution)
+    uint32_t    getFirstIndex();                // First index of LOD 0 inside the pool index buffer (in indices of getIndexType())
+    VkIndexType getIndexType();                 // uint16_t when the mesh has at most 65536 vertices
+    VkBuffer    getIndexBuffer();               // Shared by all the meshes of the pool
 
-    uint32_t    getIndexCount();
-    VkBuffer    getIndexBuffer();
+    uint32_t    getLodCount();                  // At least 1
+    MeshLod     getLod(uint32_t lod);           // 0: full resolution, then coarser and coarser
 
-    void        destroyBuffers();
+    // Meshlets of LOD 0, for culling clusters of triangles on their own ('vertices' and 'indices' as given to the constructor)
+    void        buildMeshlets(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices);
+    uint32_t    getMeshletCount();              // 0 if not built
+    Meshlet     getMeshlet(uint32_t meshlet);   // firstIndex inside the pool index buffer (like getFirstIndex())
+
+    uint64_t    getUploadTicket();              // Upload batch the geometry is filled by (see UploadBatcher)
+
+    glm::vec4   getBoundingSphere();            // Model space: xyz center, w radius
+
+    // Instanced mesh: per-instance transforms and colours in their own vertex buffer (uploaded through the batcher)
+    void        createInstanceBuffer(VkDevice device, DeviceMemoryAllocator * allocator, UploadBatcher * uploadBatcher,
+                                     std::vector<InstanceData> * instances);
+    VkBuffer    getInstanceBuffer();            // VK_NULL_HANDLE if not instanced
+    uint32_t    getInstanceCount();             // 1 if not instanced
+
+    void        setModel(glm::mat4 newModel);
+    UboModel    getModel();
+
+    void        destroyBuffers();               // Gives the geometry ranges back to the pool (and destroys the instance buffer)
 
     ~Mesh();
 
 private:
-    uint32_t            m_vertexCount = 0U;
-    VkBuffer            m_vertexBuffer = 0;             // '0' instead of 'nullptr' for compatibility with 32bit version
-    VkDeviceMemory      m_vertexBufferMemory = 0;       // '0' instead of 'nullptr' for compatibility with 32bit version
-
-    uint32_t            m_indexCount = 0U;
-    VkBuffer            m_indexBuffer = 0;              // '0' instead of 'nullptr' for compatibility with 32bit version
-    VkDeviceMemory      m_indexBufferMemory = 0;        // '0' instead of 'nullptr' for compatibility with 32bit version
+    UboModel            m_uboModel;
+    glm::vec4           m_boundingSphere = glm::vec4(0.0f);
 
-    VkPhysicalDevice    m_physicalDevice = nullptr;
-    VkDevice            m_device= nullptr;              // This is our Logical Device
+    GeometryPool *      m_geometryPool = nullptr;
+    GeometryAllocation  m_geometry;             // Ranges of the shared vertex/index buffers (the indices of all the LODs)
+    std::vector<MeshLod> m_lods;                // Index ranges inside m_geometry
+    std::vector<Meshlet> m_meshlets;            // Index ranges inside LOD 0
 
-    // Methods
-    void createVertexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<Vertex> * vertices);
-    void createIndexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<uint32_t> * indices);
+    VkDevice                m_device = nullptr;
+    DeviceMemoryAllocator * m_allocator = nullptr;
+    VkBuffer                m_instanceBuffer = VK_NULL_HANDLE;
+    MemoryAllocation        m_instanceBufferMemory = {};
+    uint32_t                m_instanceCount = 1;
 };
-
@@ -0,0 +1,325 @@
+#include "MeshCache.h"
+
+// C++ STL
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+// Platform (file mapping)
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Disable warning about Vulkan unscoped enums for this entire file
+#pragma warning( push )
+#pragma warning(disable : 26812) // The enum type * is unscoped. Prefer 'enum class' over 'enum'.
+
+const char MESH_CACHE_MAGIC[4] = { 'V', 'C', 'M', 'C' };
+
+static uint64_t alignToSection(uint64_t offset)
+{
+    return (offset + MeshCache::SECTION_ALIGNMENT - 1) / MeshCache::SECTION_ALIGNMENT * MeshCache::SECTION_ALIGNMENT;
+}
+
+// [offset, offset + count * elementSize) within [0, size), without overflowing
+static bool isSectionInBounds(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t size)
+{
+    return offset <= size && count <= (size - offset) / elementSize;
+}
+
+template <typename T>
+static bool areIndicesInRange(const char * indexData, uint32_t indexCount, uint32_t vertexCount)
+{
+    const T * indices = reinterpret_cast<const T *>(indexData);
+    for (uint32_t i = 0; i < indexCount; i++)
+    {
+        if (indices[i] >= vertexCount)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+uint64_t MeshCache::write(  const std::string &filename, const std::vector<MeshSource> &meshes,
+                            VertexFormat vertexFormat, bool allowShortIndices)
+{
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Failed to create the mesh cache '" + filename + "'!");
+    }
+
+    MeshCacheHeader header = {};
+    memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.meshCount = static_cast<uint32_t>(meshes.size());
+    header.vertexFormat = static_cast<uint32_t>(vertexFormat);
+    header.vertexStride = static_cast<uint32_t>(getVertexStride(vertexFormat));
+
+    // The sections are streamed one mesh at a time (the whole scene is never encoded in memory):
+    // header and entries are written last, once all the sections are placed
+    std::vector<MeshCacheEntry> entries(meshes.size());
+    uint64_t offset = alignToSection(sizeof(MeshCacheHeader) + sizeof(MeshCacheEntry) * meshes.size());
+
+    static const char padding[SECTION_ALIGNMENT] = {};
+    auto writeSection = [&](uint64_t sectionOffset, const void * data, uint64_t size) {
+        uint64_t position = static_cast<uint64_t>(file.tellp());
+        while (position < sectionOffset)
+        {
+            uint64_t paddingSize = std::min<uint64_t>(sectionOffset - position, sizeof(padding));
+            file.write(padding, static_cast<std::streamsize>(paddingSize));
+            position += paddingSize;
+        }
+        file.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+    };
+    writeSection(0, &header, sizeof(MeshCacheHeader));     // Placeholder, rewritten at the end
+
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        const MeshSource &mesh = meshes[i];
+        MeshCacheEntry &entry = entries[i];
+        entry = {};
+        entry.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+        entry.indexCount = static_cast<uint32_t>(mesh.indices.size());
+
+        // Bounds
+        glm::vec3 boundsMin = mesh.vertices.empty() ? glm::vec3(0.0f) : mesh.vertices.front().pos;
+        glm::vec3 boundsMax = boundsMin;
+        for (const auto &vertex : mesh.vertices)
+        {
+            boundsMin = glm::min(boundsMin, vertex.pos);
+            boundsMax = glm::max(boundsMax, vertex.pos);
+        }
+        entry.boundsMin = glm::vec4(boundsMin, 0.0f);
+        entry.boundsMax = glm::vec4(boundsMax, 0.0f);
+        entry.boundingSphere = Mesh::computeBoundingSphere(mesh.vertices);
+        entry.positionOffset = glm::vec4(0.0f);
+        entry.positionScale = glm::vec4(1.0f);
+
+        // Vertices, in the layout of the pipeline
+        entry.vertexDataOffset = offset;
+        if (vertexFormat == VertexFormat::Quantized)
+        {
+            glm::vec3 positionOffset;
+            glm::vec3 positionScale;
+            std::vector<QuantizedVertex> quantizedVertices = quantizeVertices(mesh.vertices, positionOffset, positionScale);
+            entry.positionOffset = glm::vec4(positionOffset, 0.0f);
+            entry.positionScale = glm::vec4(positionScale, 1.0f);
+            writeSection(offset, quantizedVertices.data(), sizeof(QuantizedVertex) * quantizedVertices.size());
+        }
+        else
+        {
+            writeSection(offset, mesh.vertices.data(), sizeof(Vertex) * mesh.vertices.size());
+        }
+        offset = alignToSection(offset + header.vertexStride * static_cast<uint64_t>(entry.vertexCount));
+
+        // Indices (relative to the first vertex of the mesh), narrowed like GeometryPool does
+        entry.indexDataOffset = offset;
+        bool shortIndices = allowShortIndices && mesh.vertices.size() <= GeometryPool::MAX_SHORT_INDEX_VERTICES;
+        if (shortIndices)
+        {
+            std::vector<uint16_t> shortIndexData(mesh.indices.begin(), mesh.indices.end());
+            entry.indexType = VK_INDEX_TYPE_UINT16;
+            writeSection(offset, shortIndexData.data(), sizeof(uint16_t) * shortIndexData.size());
+            offset = alignToSection(offset + sizeof(uint16_t) * shortIndexData.size());
+        }
+        else
+        {
+            entry.indexType = VK_INDEX_TYPE_UINT32;
+            writeSection(offset, mesh.indices.data(), sizeof(uint32_t) * mesh.indices.size());
+            offset = alignToSection(offset + sizeof(uint32_t) * mesh.indices.size());
+        }
+    }
+
+    // The file ends at a section boundary too (the last section can be read by whole pages)
+    writeSection(offset, nullptr, 0);
+    header.fileSize = offset;
+
+    file.seekp(0);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(MeshCacheHeader));
+    file.write(reinterpret_cast<const char *>(entries.data()), static_cast<std::streamsize>(sizeof(MeshCacheEntry) * entries.size()));
+
+    file.close();
+    if (file.fail())
+    {
+        throw std::runtime_error("Failed to write the mesh cache '" + filename + "'!");
+    }
+
+    return header.fileSize;
+}
+
+//------------------------------------------------------------------------------
+MeshCache::MeshCache()
+{
+}
+//------------------------------------------------------------------------------
+void MeshCache::open(const std::string &filename)
+{
+    close();
+
+#ifdef _WIN32
+    // Sequential scan: the sections are read once, in order (aggressive read ahead)
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("Failed to open the mesh cache '" + filename + "'!");
+    }
+    m_fileHandle = file;
+
+    LARGE_INTEGER fileSize = {};
+    HANDLE mapping = GetFileSizeEx(file, &fileSize) ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    if (mapping == nullptr)
+    {
+        close();
+        throw std::runtime_error("Failed to map the mesh cache '" + filename + "'!");
+    }
+    m_mappingHandle = mapping;
+
+    m_data = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    m_size = static_cast<uint64_t>(fileSize.QuadPart);
+#else
+    int fileDescriptor = ::open(filename.c_str(), O_RDONLY);
+    if (fileDescriptor < 0)
+    {
+        throw std::runtime_error("Failed to open the mesh cache '" + filename + "'!");
+    }
+    m_fileDescriptor = fileDescriptor;
+
+    struct stat fileStat = {};
+    void * data = (fstat(fileDescriptor, &fileStat) == 0 && fileStat.st_size > 0) ?
+        mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0) : MAP_FAILED;
+    if (data != MAP_FAILED)
+    {
+        // The sections are read once, in order (aggressive read ahead)
+        madvise(data, static_cast<size_t>(fileStat.st_size), MADV_SEQUENTIAL);
+        m_data = static_cast<const char *>(data);
+        m_size = static_cast<uint64_t>(fileStat.st_size);
+    }
+#endif
+
+    if (m_data == nullptr)
+    {
+        close();
+        throw std::runtime_error("Failed to map the mesh cache '" + filename + "'!");
+    }
+
+    // Validation: the header and the entries are read, the vertex sections are bounds-checked and the index sections
+    // are scanned once (an out of range index would make the GPU read past the mesh)
+    m_header = reinterpret_cast<const MeshCacheHeader *>(m_data);
+    bool valid = m_size >= sizeof(MeshCacheHeader) &&
+                 memcmp(m_header->magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) == 0 &&
+                 m_header->version == VERSION &&
+                 m_header->fileSize == m_size &&
+                 m_header->vertexFormat <= static_cast<uint32_t>(VertexFormat::Quantized) &&
+                 m_header->vertexStride == getVertexStride(static_cast<VertexFormat>(m_header->vertexFormat)) &&
+                 sizeof(MeshCacheHeader) + sizeof(MeshCacheEntry) * static_cast<uint64_t>(m_header->meshCount) <= m_size;
+
+    m_entries = reinterpret_cast<const MeshCacheEntry *>(m_data + sizeof(MeshCacheHeader));
+    for (uint32_t i = 0; valid && i < m_header->meshCount; i++)
+    {
+        const MeshCacheEntry &entry = m_entries[i];
+        uint64_t indexSize = (entry.indexType == VK_INDEX_TYPE_UINT16) ? sizeof(uint16_t) : sizeof(uint32_t);
+        valid = (entry.indexType == VK_INDEX_TYPE_UINT16 || entry.indexType == VK_INDEX_TYPE_UINT32) &&
+                entry.vertexDataOffset % SECTION_ALIGNMENT == 0 && entry.indexDataOffset % SECTION_ALIGNMENT == 0 &&
+                isSectionInBounds(entry.vertexDataOffset, entry.vertexCount, m_header->vertexStride, m_size) &&
+                isSectionInBounds(entry.indexDataOffset, entry.indexCount, indexSize, m_size);
+        if (valid)
+        {
+            const char * indexData = m_data + entry.indexDataOffset;
+            valid = (entry.indexType == VK_INDEX_TYPE_UINT16) ?
+                areIndicesInRange<uint16_t>(indexData, entry.indexCount, entry.vertexCount) :
+                areIndicesInRange<uint32_t>(indexData, entry.indexCount, entry.vertexCount);
+        }
+    }
+
+    if (!valid)
+    {
+        close();
+        throw std::runtime_error("'" + filename + "' is not a valid mesh cache (version " + std::to_string(VERSION) + ")!");
+    }
+}
+//------------------------------------------------------------------------------
+void MeshCache::close()
+{
+#ifdef _WIN32
+    if (m_data != nullptr)
+    {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mappingHandle != nullptr)
+    {
+        CloseHandle(m_mappingHandle);
+    }
+    if (m_fileHandle != nullptr)
+    {
+        CloseHandle(m_fileHandle);
+    }
+#else
+    if (m_data != nullptr)
+    {
+        munmap(const_cast<char *>(m_data), static_cast<size_t>(m_size));
+    }
+    if (m_fileDescriptor >= 0)
+    {
+        ::close(m_fileDescriptor);
+    }
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+    m_header = nullptr;
+    m_entries = nullptr;
+    m_fileHandle = nullptr;
+    m_mappingHandle = nullptr;
+    m_fileDescriptor = -1;
+}
+//------------------------------------------------------------------------------
+VertexFormat MeshCache::getVertexFormat() const
+{
+    return static_cast<VertexFormat>(m_header->vertexFormat);
+}
+//------------------------------------------------------------------------------
+uint32_t MeshCache::getMeshCount() const
+{
+    return (m_header != nullptr) ? m_header->meshCount : 0;
+}
+//------------------------------------------------------------------------------
+EncodedMeshData MeshCache::getMesh(uint32_t meshIdx) const
+{
+    const MeshCacheEntry &entry = m_entries[meshIdx];
+
+    EncodedMeshData meshData;
+    meshData.vertexData = m_data + entry.vertexDataOffset;
+    meshData.vertexCount = entry.vertexCount;
+    meshData.vertexStride = m_header->vertexStride;
+    meshData.indexData = m_data + entry.indexDataOffset;
+    meshData.indexCount = entry.indexCount;
+    meshData.indexType = static_cast<VkIndexType>(entry.indexType);
+    meshData.boundingSphere = entry.boundingSphere;
+    meshData.positionOffset = entry.positionOffset;
+    meshData.positionScale = entry.positionScale;
+
+    return meshData;
+}
+//------------------------------------------------------------------------------
+uint64_t MeshCache::getFileSize() const
+{
+    return m_size;
+}
+//------------------------------------------------------------------------------
+MeshCache::~MeshCache()
+{
+    close();
+}
+
+#pragma warning( pop )
@@ -0,0 +1,91 @@
+#pragma once
+
+// C++ STL
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Project includes
+#include "Mesh.h"
+#include "Utilities.h"
+#include "VertexFormat.h"
+
+// Disable warning about Vulkan unscoped enums for this entire file
+#pragma warning( push )
+#pragma warning(disable : 26812) // The enum type * is unscoped. Prefer 'enum class' over 'enum'.
+
+// Binary mesh container ("*.vcm"): the meshes are stored in their GPU layout (vertex format, index type), in sections
+// aligned to MeshCache::SECTION_ALIGNMENT, so that a mapped file is uploaded with a copy and no parsing.
+// Layout: MeshCacheHeader | MeshCacheEntry[meshCount] | vertex and index sections of every mesh
+// (N.B.: written and read by the same kind of machine, little endian: it's a cache, not an interchange format)
+struct MeshCacheHeader {
+    char        magic[4];               // "VCMC"
+    uint32_t    version;                // MeshCache::VERSION (files of other versions must be converted again)
+    uint32_t    meshCount;
+    uint32_t    vertexFormat;           // VertexFormat of all the meshes (the pipeline has a single vertex layout)
+    uint32_t    vertexStride;           // Size of a vertex of vertexFormat (checked when opening)
+    uint32_t    reserved;
+    uint64_t    fileSize;               // Truncated files are rejected
+};
+
+struct MeshCacheEntry {
+    glm::vec4   boundingSphere;         // Model space: xyz center, w radius
+    glm::vec4   boundsMin;              // Model space bounding box (w unused)
+    glm::vec4   boundsMax;
+    glm::vec4   positionOffset;         // Dequantization of the positions (see UboModel): identity for VertexFormat::Float
+    glm::vec4   positionScale;
+    uint64_t    vertexDataOffset;       // From the start of the file (multiple of SECTION_ALIGNMENT)
+    uint64_t    indexDataOffset;
+    uint32_t    vertexCount;
+    uint32_t    indexCount;
+    uint32_t    indexType;              // VkIndexType: VK_INDEX_TYPE_UINT16 or VK_INDEX_TYPE_UINT32
+    uint32_t    reserved;
+};
+
+// Source of a mesh to write to the cache
+struct MeshSource {
+    std::vector<Vertex>     vertices;
+    std::vector<uint32_t>   indices;
+};
+
+// Read-only memory mapping of a mesh cache file: the meshes are pointers into the mapping (see EncodedMeshData)
+class MeshCache
+{
+public:
+    static const uint32_t VERSION = 1;
+    static const uint64_t SECTION_ALIGNMENT = 4096;     // Page size: every section starts on its own page
+
+    // Encodes the meshes in 'vertexFormat' (and uint16_t indices when they fit, if allowed) and writes them to 'filename'.
+    // Returns the size of the file
+    static uint64_t     write(  const std::string &filename, const std::vector<MeshSource> &meshes,
+                                VertexFormat vertexFormat, bool allowShortIndices = true);
+
+    MeshCache();
+
+    void                open(const std::string &filename);     // Maps the file and validates its header (throws on failure)
+    void                close();
+
+    VertexFormat        getVertexFormat() const;
+    uint32_t            getMeshCount() const;
+    EncodedMeshData     getMesh(uint32_t meshIdx) const;        // Points into the mapping: valid until close()
+    uint64_t            getFileSize() const;
+
+    ~MeshCache();
+
+private:
+    const char *        m_data = nullptr;
+    uint64_t            m_size = 0;
+    const MeshCacheHeader * m_header = nullptr;
+    const MeshCacheEntry *  m_entries = nullptr;
+
+    // Platform handles (Win32 file and mapping, or POSIX file descriptor)
+    void *              m_fileHandle = nullptr;
+    void *              m_mappingHandle = nullptr;
+    int                 m_fileDescriptor = -1;
+
+    // prevent copying (the mapping is owned)
+    MeshCache(const MeshCache&) = delete;
+    MeshCache& operator=(const MeshCache&) = delete;
+};
+
+#pragma warning( pop )
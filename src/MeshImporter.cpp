@@ -0,0 +1,837 @@
+#include "MeshImporter.h"
+
+// C++ STL
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+const size_t OBJ_MIN_CHUNK_SIZE = 64 * 1024;        // Smaller files get fewer chunks (not worth a task each)
+const uint32_t OBJ_CHUNKS_PER_THREAD = 4;           // Lines don't all cost the same: smaller chunks balance the threads
+const uint32_t GLB_ELEMENTS_PER_RANGE = 64 * 1024;  // Vertices or indices converted by a work item
+const double GLB_MAX_INTEGER = 9007199254740992.0;  // 2^53: the largest range of integers a JSON number (double) holds exactly
+const double GLB_MAX_BYTE_STRIDE = 252.0;           // glTF bufferView.byteStride maximum
+
+//------------------------------------------------------------------------------
+// OBJ parsing helpers (on [cursor, end): the file data isn't null terminated)
+//------------------------------------------------------------------------------
+struct ObjChunk {
+    const char *    begin = nullptr;
+    const char *    end = nullptr;      // After the '\n' of its last line
+    uint32_t        positionCount = 0;
+    uint32_t        triangleCount = 0;
+    uint32_t        firstPosition = 0;  // Positions (and triangles) of the chunks before this one
+    uint32_t        firstTriangle = 0;
+};
+
+static const char * skipSpaces(const char * cursor, const char * end)
+{
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r'))
+    {
+        cursor++;
+    }
+    return cursor;
+}
+
+static const char * findLineEnd(const char * cursor, const char * end)
+{
+    const void * lineEnd = memchr(cursor, '\n', end - cursor);
+    return (lineEnd != nullptr) ? static_cast<const char *>(lineEnd) : end;
+}
+
+// Keyword of a line (e.g. "v", "f") followed by a blank
+static bool isKeyword(const char * cursor, const char * lineEnd, char keyword)
+{
+    return (lineEnd - cursor >= 2) && cursor[0] == keyword && (cursor[1] == ' ' || cursor[1] == '\t');
+}
+
+static bool parseFloat(const char * &cursor, const char * end, float &value)
+{
+    cursor = skipSpaces(cursor, end);
+
+    bool negative = (cursor < end && *cursor == '-');
+    if (cursor < end && (*cursor == '-' || *cursor == '+'))
+    {
+        cursor++;
+    }
+
+    // Mantissa as an integer (with the position of the decimal point), exact for up to 19 digits
+    const char * digitsStart = cursor;
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digitCount = 0;
+    for (; cursor < end && *cursor >= '0' && *cursor <= '9'; cursor++)
+    {
+        if (digitCount++ < 19) { mantissa = mantissa * 10 + (*cursor - '0'); } else { exponent++; }
+    }
+    if (cursor < end && *cursor == '.')
+    {
+        cursor++;
+        for (; cursor < end && *cursor >= '0' && *cursor <= '9'; cursor++)
+        {
+            if (digitCount++ < 19) { mantissa = mantissa * 10 + (*cursor - '0'); exponent--; }
+        }
+    }
+    if (cursor == digitsStart || digitCount == 0)
+    {
+        return false;
+    }
+
+    if (cursor < end && (*cursor == 'e' || *cursor == 'E'))
+    {
+        cursor++;
+        bool negativeExponent = (cursor < end && *cursor == '-');
+        if (cursor < end && (*cursor == '-' || *cursor == '+'))
+        {
+            cursor++;
+        }
+        int explicitExponent = 0;
+        for (; cursor < end && *cursor >= '0' && *cursor <= '9'; cursor++)
+        {
+            explicitExponent = std::min(explicitExponent * 10 + (*cursor - '0'), 1000);
+        }
+        exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    }
+
+    // Exact powers of ten for the usual exponents (std::pow is most of the parse time otherwise)
+    static const double POWERS_OF_TEN[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    double result = static_cast<double>(mantissa);
+    if (exponent >= -22 && exponent < 0)
+    {
+        result /= POWERS_OF_TEN[-exponent];
+    }
+    else if (exponent > 0 && exponent <= 22)
+    {
+        result *= POWERS_OF_TEN[exponent];
+    }
+    else if (exponent != 0)
+    {
+        result *= std::pow(10.0, exponent);
+    }
+    value = static_cast<float>(negative ? -result : result);
+    return true;
+}
+
+static bool parseInt(const char * &cursor, const char * end, int64_t &value)
+{
+    cursor = skipSpaces(cursor, end);
+
+    bool negative = (cursor < end && *cursor == '-');
+    if (cursor < end && (*cursor == '-' || *cursor == '+'))
+    {
+        cursor++;
+    }
+
+    const char * digitsStart = cursor;
+    int64_t result = 0;
+    for (; cursor < end && *cursor >= '0' && *cursor <= '9'; cursor++)
+    {
+        result = std::min<int64_t>(result * 10 + (*cursor - '0'), INT32_MAX);
+    }
+    value = negative ? -result : result;
+    return cursor != digitsStart;
+}
+
+// Pass 1: sizes only
+static void countObjChunk(ObjChunk &chunk)
+{
+    for (const char * line = chunk.begin; line < chunk.end;)
+    {
+        const char * lineEnd = findLineEnd(line, chunk.end);
+        const char * cursor = skipSpaces(line, lineEnd);
+
+        if (isKeyword(cursor, lineEnd, 'v'))
+        {
+            chunk.positionCount++;
+        }
+        else if (isKeyword(cursor, lineEnd, 'f'))
+        {
+            // One face vertex per blank separated token ("v", "v/vt", "v//vn", "v/vt/vn")
+            uint32_t faceVertexCount = 0;
+            cursor = skipSpaces(cursor + 1, lineEnd);
+            while (cursor < lineEnd)
+            {
+                while (cursor < lineEnd && *cursor != ' ' && *cursor != '\t' && *cursor != '\r')
+                {
+                    cursor++;
+                }
+                faceVertexCount++;
+                cursor = skipSpaces(cursor, lineEnd);
+            }
+            chunk.triangleCount += (faceVertexCount >= 3) ? faceVertexCount - 2 : 0;
+        }
+
+        line = lineEnd + 1;
+    }
+}
+
+// Pass 2: every element written at its final place
+static void parseObjChunk(const ObjChunk &chunk, MeshSource &mesh)
+{
+    uint32_t position = chunk.firstPosition;
+    uint32_t * index = mesh.indices.data() + chunk.firstTriangle * 3;
+    uint32_t positionCount = static_cast<uint32_t>(mesh.vertices.size());
+
+    for (const char * line = chunk.begin; line < chunk.end;)
+    {
+        const char * lineEnd = findLineEnd(line, chunk.end);
+        const char * cursor = skipSpaces(line, lineEnd);
+
+        if (isKeyword(cursor, lineEnd, 'v'))
+        {
+            // "v x y z [w]" or "v x y z r g b" (common colour extension)
+            float values[6];
+            uint32_t valueCount = 0;
+            cursor++;
+            while (valueCount < 6 && parseFloat(cursor, lineEnd, values[valueCount]))
+            {
+                valueCount++;
+            }
+            if (valueCount < 3)
+            {
+                throw std::runtime_error("Malformed OBJ vertex position!");
+            }
+
+            Vertex &vertex = mesh.vertices[position++];
+            vertex.pos = glm::vec3(values[0], values[1], values[2]);
+            vertex.col = (valueCount == 6) ? glm::vec3(values[3], values[4], values[5]) : glm::vec3(1.0f);
+        }
+        else if (isKeyword(cursor, lineEnd, 'f'))
+        {
+            // Fan triangulation (faces are convex in practice)
+            uint32_t firstVertex = 0;
+            uint32_t previousVertex = 0;
+            uint32_t faceVertexCount = 0;
+            cursor++;
+            int64_t value = 0;
+            while (parseInt(cursor, lineEnd, value))
+            {
+                // 1-based, or negative: relative to the positions defined so far
+                int64_t resolved = (value > 0) ? value - 1 : static_cast<int64_t>(position) + value;
+                if (value == 0 || resolved < 0 || resolved >= positionCount)
+                {
+                    throw std::runtime_error("OBJ face index out of range!");
+                }
+                uint32_t vertex = static_cast<uint32_t>(resolved);
+
+                if (faceVertexCount == 0)
+                {
+                    firstVertex = vertex;
+                }
+                else if (faceVertexCount >= 2)
+                {
+                    *index++ = firstVertex;
+                    *index++ = previousVertex;
+                    *index++ = vertex;
+                }
+                previousVertex = vertex;
+                faceVertexCount++;
+
+                // Skip the texture coordinate and normal indices
+                while (cursor < lineEnd && *cursor != ' ' && *cursor != '\t' && *cursor != '\r')
+                {
+                    cursor++;
+                }
+            }
+
+            // Every token counted by the first pass must have been read
+            if (skipSpaces(cursor, lineEnd) < lineEnd)
+            {
+                throw std::runtime_error("Malformed OBJ face!");
+            }
+        }
+
+        line = lineEnd + 1;
+    }
+}
+
+//------------------------------------------------------------------------------
+// glTF helpers
+//------------------------------------------------------------------------------
+const uint32_t GLB_MAGIC = 0x46546C67;          // "glTF"
+const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;     // "JSON"
+const uint32_t GLB_CHUNK_BIN = 0x004E4942;      // "BIN\0"
+const uint32_t GLTF_MODE_TRIANGLES = 4;
+
+// Minimal JSON document (the glTF description is small: allocations don't matter here, unlike the geometry)
+struct JsonValue {
+    enum class Type { Null, Boolean, Number, String, Array, Object };
+
+    Type        type = Type::Null;
+    double      number = 0.0;                                   // Number, Boolean (0 or 1)
+    std::string string;
+    std::vector<JsonValue> elements;                            // Array
+    std::vector<std::pair<std::string, JsonValue>> members;     // Object
+
+    const JsonValue * get(const char * key) const
+    {
+        for (const auto &member : members)
+        {
+            if (member.first == key)
+            {
+                return &member.second;
+            }
+        }
+        return nullptr;
+    }
+
+    const JsonValue * at(size_t elementIdx) const
+    {
+        return (elementIdx < elements.size()) ? &elements[elementIdx] : nullptr;
+    }
+
+    double getNumber(const char * key, double defaultValue) const
+    {
+        const JsonValue * value = get(key);
+        return (value != nullptr && value->type == Type::Number) ? value->number : defaultValue;
+    }
+};
+
+static void skipJsonSpaces(const char * &cursor)
+{
+    while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n')
+    {
+        cursor++;
+    }
+}
+
+static std::string parseJsonString(const char * &cursor)
+{
+    // At the opening quote
+    std::string result;
+    cursor++;
+    while (*cursor != '"')
+    {
+        if (*cursor == '\0')
+        {
+            throw std::runtime_error("Malformed glTF JSON (string)!");
+        }
+        if (*cursor == '\\')
+        {
+            cursor++;
+            switch (*cursor)
+            {
+            case 'b':   result += '\b'; break;
+            case 'f':   result += '\f'; break;
+            case 'n':   result += '\n'; break;
+            case 'r':   result += '\r'; break;
+            case 't':   result += '\t'; break;
+            case 'u':
+                // Only ASCII matters to the keys and values read here
+                for (int i = 0; i < 4; i++)
+                {
+                    if (!std::isxdigit(static_cast<unsigned char>(cursor[1])))
+                    {
+                        throw std::runtime_error("Malformed glTF JSON (escape)!");
+                    }
+                    cursor++;
+                }
+                result += '?';
+                break;
+            case '\0':
+                throw std::runtime_error("Malformed glTF JSON (escape)!");
+            default:    result += *cursor; break;
+            }
+            cursor++;
+        }
+        else
+        {
+            result += *cursor++;
+        }
+    }
+    cursor++;
+    return result;
+}
+
+static JsonValue parseJsonValue(const char * &cursor, int depth)
+{
+    if (depth > 64)
+    {
+        throw std::runtime_error("Malformed glTF JSON (nesting)!");
+    }
+
+    JsonValue value;
+    skipJsonSpaces(cursor);
+    if (*cursor == '{')
+    {
+        value.type = JsonValue::Type::Object;
+        cursor++;
+        skipJsonSpaces(cursor);
+        while (*cursor != '}')
+        {
+            if (*cursor != '"')
+            {
+                throw std::runtime_error("Malformed glTF JSON (object key)!");
+            }
+            std::string key = parseJsonString(cursor);
+            skipJsonSpaces(cursor);
+            if (*cursor++ != ':')
+            {
+                throw std::runtime_error("Malformed glTF JSON (object)!");
+            }
+            value.members.emplace_back(std::move(key), parseJsonValue(cursor, depth + 1));
+            skipJsonSpaces(cursor);
+            if (*cursor == ',')
+            {
+                cursor++;
+                skipJsonSpaces(cursor);
+            }
+            else if (*cursor != '}')
+            {
+                throw std::runtime_error("Malformed glTF JSON (object)!");
+            }
+        }
+        cursor++;
+    }
+    else if (*cursor == '[')
+    {
+        value.type = JsonValue::Type::Array;
+        cursor++;
+        skipJsonSpaces(cursor);
+        while (*cursor != ']')
+        {
+            value.elements.push_back(parseJsonValue(cursor, depth + 1));
+            skipJsonSpaces(cursor);
+            if (*cursor == ',')
+            {
+                cursor++;
+            }
+            else if (*cursor != ']')
+            {
+                throw std::runtime_error("Malformed glTF JSON (array)!");
+            }
+        }
+        cursor++;
+    }
+    else if (*cursor == '"')
+    {
+        value.type = JsonValue::Type::String;
+        value.string = parseJsonString(cursor);
+    }
+    else if (strncmp(cursor, "true", 4) == 0 || strncmp(cursor, "false", 5) == 0)
+    {
+        value.type = JsonValue::Type::Boolean;
+        value.number = (*cursor == 't') ? 1.0 : 0.0;
+        cursor += (*cursor == 't') ? 4 : 5;
+    }
+    else if (strncmp(cursor, "null", 4) == 0)
+    {
+        cursor += 4;
+    }
+    else
+    {
+        char * numberEnd = nullptr;
+        value.type = JsonValue::Type::Number;
+        value.number = strtod(cursor, &numberEnd);
+        if (numberEnd == cursor)
+        {
+            throw std::runtime_error("Malformed glTF JSON (value)!");
+        }
+        cursor = numberEnd;
+    }
+
+    return value;
+}
+
+// Typed view of the BIN chunk (bounds checked once, when created)
+struct GlbAccessor {
+    const uint8_t * data = nullptr;
+    uint32_t        count = 0;
+    uint32_t        stride = 0;
+    uint32_t        componentType = 0;      // GL enum: 5121 UNSIGNED_BYTE, 5123 UNSIGNED_SHORT, 5125 UNSIGNED_INT, 5126 FLOAT...
+    uint32_t        componentCount = 0;     // 1 (SCALAR) to 4 (VEC4)
+};
+
+// JSON numbers are doubles: a glTF index, count, offset or size must be an integer in [0, maxValue] before it is cast
+// (negative, fractional, NaN or huge values are rejected)
+static bool isGlbInteger(double value, double maxValue)
+{
+    return value >= 0.0 && value <= maxValue && std::floor(value) == value;
+}
+
+static GlbAccessor getGlbAccessor(const JsonValue &document, double accessorIdx, const uint8_t * bin, uint64_t binSize)
+{
+    const JsonValue * accessors = document.get("accessors");
+    const JsonValue * accessor = (accessors != nullptr && isGlbInteger(accessorIdx, GLB_MAX_INTEGER)) ?
+        accessors->at(static_cast<size_t>(accessorIdx)) : nullptr;
+    if (accessor == nullptr)
+    {
+        throw std::runtime_error("glTF accessor not found!");
+    }
+    if (accessor->get("sparse") != nullptr)
+    {
+        throw std::runtime_error("Sparse glTF accessors aren't supported!");
+    }
+
+    const JsonValue * bufferViews = document.get("bufferViews");
+    double bufferViewIdx = accessor->getNumber("bufferView", -1.0);
+    const JsonValue * bufferView = (bufferViews != nullptr && isGlbInteger(bufferViewIdx, GLB_MAX_INTEGER)) ?
+        bufferViews->at(static_cast<size_t>(bufferViewIdx)) : nullptr;
+    if (bufferView == nullptr || bufferView->getNumber("buffer", 0.0) != 0.0)
+    {
+        throw std::runtime_error("glTF accessor without a buffer view in the GLB binary chunk!");
+    }
+
+    double count = accessor->getNumber("count", 0.0);
+    if (!isGlbInteger(count, UINT32_MAX) || count == 0.0)
+    {
+        throw std::runtime_error("Invalid glTF accessor count!");
+    }
+
+    GlbAccessor result;
+    result.count = static_cast<uint32_t>(count);
+    double componentType = accessor->getNumber("componentType", 0.0);
+    result.componentType = isGlbInteger(componentType, UINT32_MAX) ? static_cast<uint32_t>(componentType) : 0;
+
+    const JsonValue * type = accessor->get("type");
+    std::string typeName = (type != nullptr) ? type->string : "";
+    result.componentCount = (typeName == "SCALAR") ? 1 : (typeName == "VEC2") ? 2 : (typeName == "VEC3") ? 3 : (typeName == "VEC4") ? 4 : 0;
+
+    uint32_t componentSize = 0;
+    switch (result.componentType)
+    {
+    case 5120: case 5121:   componentSize = 1; break;    // BYTE, UNSIGNED_BYTE
+    case 5122: case 5123:   componentSize = 2; break;    // SHORT, UNSIGNED_SHORT
+    case 5125: case 5126:   componentSize = 4; break;    // UNSIGNED_INT, FLOAT
+    default:                break;
+    }
+    if (result.componentCount == 0 || componentSize == 0)
+    {
+        throw std::runtime_error("Unsupported glTF accessor type!");
+    }
+
+    // byteStride: 0 (tightly packed) or [4, 252] by the specification, never less than an element
+    uint64_t elementSize = componentSize * result.componentCount;
+    double byteStride = bufferView->getNumber("byteStride", 0.0);
+    double viewOffset = bufferView->getNumber("byteOffset", 0.0);
+    double viewLength = bufferView->getNumber("byteLength", 0.0);
+    double accessorOffset = accessor->getNumber("byteOffset", 0.0);
+    if (!isGlbInteger(byteStride, GLB_MAX_BYTE_STRIDE) || (byteStride != 0.0 && byteStride < static_cast<double>(elementSize)) ||
+        !isGlbInteger(viewOffset, GLB_MAX_INTEGER) || !isGlbInteger(viewLength, GLB_MAX_INTEGER) ||
+        !isGlbInteger(accessorOffset, GLB_MAX_INTEGER))
+    {
+        throw std::runtime_error("Invalid glTF accessor or buffer view layout!");
+    }
+    result.stride = (byteStride != 0.0) ? static_cast<uint32_t>(byteStride) : static_cast<uint32_t>(elementSize);
+
+    // Without overflow: every subtraction is checked first, the last element starts at (count - 1) * stride
+    uint64_t view = static_cast<uint64_t>(viewOffset);
+    uint64_t length = static_cast<uint64_t>(viewLength);
+    uint64_t offset = static_cast<uint64_t>(accessorOffset);
+    bool inBounds = view <= binSize && length <= binSize - view &&
+                    offset <= length && elementSize <= length - offset &&
+                    result.count - 1 <= (length - offset - elementSize) / result.stride;
+    if (!inBounds)
+    {
+        throw std::runtime_error("glTF accessor out of the GLB binary chunk!");
+    }
+
+    result.data = bin + view + offset;
+    return result;
+}
+
+static float readGlbComponent(const uint8_t * data, uint32_t componentType)
+{
+    // Integer colours are normalized (the only integer attribute read)
+    switch (componentType)
+    {
+    case 5121:  return data[0] / 255.0f;
+    case 5123:  { uint16_t value; memcpy(&value, data, sizeof(value)); return value / 65535.0f; }
+    case 5126:  { float value; memcpy(&value, data, sizeof(value)); return value; }
+    default:    return 0.0f;
+    }
+}
+
+static uint32_t readGlbIndex(const uint8_t * data, uint32_t componentType)
+{
+    switch (componentType)
+    {
+    case 5121:  return data[0];
+    case 5123:  { uint16_t value; memcpy(&value, data, sizeof(value)); return value; }
+    default:    { uint32_t value; memcpy(&value, data, sizeof(value)); return value; }
+    }
+}
+
+//------------------------------------------------------------------------------
+std::vector<MeshSource> MeshImporter::import(const std::string &filename, ThreadPool * threadPool, Statistics * statistics)
+{
+    std::vector<char> fileData = readFile(filename);
+
+    std::string extension = filename.substr(std::min(filename.size(), filename.find_last_of('.')));
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+
+    auto parseStart = std::chrono::steady_clock::now();
+    std::vector<MeshSource> meshes;
+    if (extension == ".obj")
+    {
+        meshes = importObj(fileData, threadPool);
+    }
+    else if (extension == ".glb")
+    {
+        meshes = importGlb(fileData, threadPool);
+    }
+    else
+    {
+        throw std::runtime_error("Unsupported model format '" + extension + "' (.obj or .glb)!");
+    }
+
+    if (statistics != nullptr)
+    {
+        *statistics = {};
+        statistics->fileBytes = fileData.size();
+        for (const auto &mesh : meshes)
+        {
+            statistics->vertexCount += mesh.vertices.size();
+            statistics->triangleCount += mesh.indices.size() / 3;
+        }
+        statistics->threadCount = threadPool->getThreadCount() + 1;
+        statistics->parseMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - parseStart).count();
+    }
+
+    return meshes;
+}
+
+//------------------------------------------------------------------------------
+void MeshImporter::printStatistics(const std::string &filename, const Statistics &statistics)
+{
+    double fileSizeMiB = static_cast<double>(statistics.fileBytes) / (1024.0 * 1024.0);
+    std::cout << "Import '" << filename << "': " << statistics.vertexCount << " vertices, " << statistics.triangleCount << " triangles, "
+              << fileSizeMiB << " MiB parsed in " << statistics.parseMilliseconds << " ms by " << statistics.threadCount << " threads ("
+              << fileSizeMiB / std::max(statistics.parseMilliseconds / 1000.0, 1e-9) << " MiB/s)" << std::endl;
+}
+//------------------------------------------------------------------------------
+std::vector<MeshSource> MeshImporter::importObj(const std::vector<char> &fileData, ThreadPool * threadPool)
+{
+    const char * data = fileData.data();
+    const char * dataEnd = data + fileData.size();
+
+    // Chunks of about the same size, cut after a line end
+    size_t maxChunkCount = fileData.size() / OBJ_MIN_CHUNK_SIZE + 1;
+    uint32_t chunkCount = static_cast<uint32_t>(std::min<size_t>((threadPool->getThreadCount() + 1) * OBJ_CHUNKS_PER_THREAD, maxChunkCount));
+    std::vector<ObjChunk> chunks(chunkCount);
+    const char * chunkBegin = data;
+    for (uint32_t i = 0; i < chunkCount; i++)
+    {
+        const char * chunkEnd = dataEnd;
+        if (i + 1 < chunkCount)
+        {
+            chunkEnd = std::max(data + fileData.size() * (i + 1) / chunkCount, chunkBegin);
+            chunkEnd = findLineEnd(chunkEnd, dataEnd);
+            chunkEnd = (chunkEnd < dataEnd) ? chunkEnd + 1 : chunkEnd;
+        }
+        chunks[i].begin = chunkBegin;
+        chunks[i].end = chunkEnd;
+        chunkBegin = chunkEnd;
+    }
+
+    // Pass 1: counts per chunk, then where each chunk writes (prefix sums)
+    threadPool->parallelFor(chunkCount, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            countObjChunk(chunks[i]);
+        }
+    });
+
+    uint64_t positionCount = 0;
+    uint64_t triangleCount = 0;
+    for (auto &chunk : chunks)
+    {
+        chunk.firstPosition = static_cast<uint32_t>(positionCount);
+        chunk.firstTriangle = static_cast<uint32_t>(triangleCount);
+        positionCount += chunk.positionCount;
+        triangleCount += chunk.triangleCount;
+    }
+    if (positionCount > UINT32_MAX || triangleCount * 3 > UINT32_MAX)
+    {
+        throw std::runtime_error("OBJ file too big for 32-bit indices!");
+    }
+
+    // Pass 2: parsing straight into the final arrays
+    std::vector<MeshSource> meshes(1);
+    meshes[0].vertices.resize(static_cast<size_t>(positionCount));
+    meshes[0].indices.resize(static_cast<size_t>(triangleCount * 3));
+    threadPool->parallelFor(chunkCount, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            parseObjChunk(chunks[i], meshes[0]);
+        }
+    });
+
+    return meshes;
+}
+
+//------------------------------------------------------------------------------
+std::vector<MeshSource> MeshImporter::importGlb(const std::vector<char> &fileData, ThreadPool * threadPool)
+{
+    // Header (magic, version, length), then the JSON chunk and the (optional) BIN chunk
+    uint32_t header[3] = {};
+    uint32_t jsonChunkHeader[2] = {};
+    if (fileData.size() < sizeof(header) + sizeof(jsonChunkHeader))
+    {
+        throw std::runtime_error("Truncated GLB file!");
+    }
+    memcpy(header, fileData.data(), sizeof(header));
+    memcpy(jsonChunkHeader, fileData.data() + sizeof(header), sizeof(jsonChunkHeader));
+    if (header[0] != GLB_MAGIC || header[1] != 2 || header[2] > fileData.size() || jsonChunkHeader[1] != GLB_CHUNK_JSON)
+    {
+        throw std::runtime_error("Not a glTF 2.0 binary file!");
+    }
+
+    uint64_t jsonOffset = sizeof(header) + sizeof(jsonChunkHeader);
+    uint64_t jsonEnd = jsonOffset + jsonChunkHeader[0];
+    if (jsonEnd > header[2])
+    {
+        throw std::runtime_error("Truncated GLB file!");
+    }
+    std::string json(fileData.data() + jsonOffset, fileData.data() + jsonEnd);     // Null terminated for the parser
+    const char * cursor = json.c_str();
+    JsonValue document = parseJsonValue(cursor, 0);
+
+    const uint8_t * bin = nullptr;
+    uint64_t binSize = 0;
+    uint64_t binChunkOffset = (jsonEnd + 3) / 4 * 4;
+    if (binChunkOffset + 2 * sizeof(uint32_t) <= header[2])
+    {
+        uint32_t binChunkHeader[2] = {};
+        memcpy(binChunkHeader, fileData.data() + binChunkOffset, sizeof(binChunkHeader));
+        if (binChunkHeader[1] == GLB_CHUNK_BIN && binChunkOffset + sizeof(binChunkHeader) + binChunkHeader[0] <= header[2])
+        {
+            bin = reinterpret_cast<const uint8_t *>(fileData.data() + binChunkOffset + sizeof(binChunkHeader));
+            binSize = binChunkHeader[0];
+        }
+    }
+
+    // Triangle primitives (points and lines are skipped): their accessors, and the size of their mesh
+    struct GlbPrimitive {
+        GlbAccessor positions;
+        GlbAccessor colours;            // count 0 if none
+        GlbAccessor indices;            // count 0 if none (non-indexed)
+        bool        indexed = false;
+    };
+    std::vector<GlbPrimitive> primitives;
+    std::vector<MeshSource> meshes;
+
+    const JsonValue * gltfMeshes = document.get("meshes");
+    for (size_t meshIdx = 0; gltfMeshes != nullptr && meshIdx < gltfMeshes->elements.size(); meshIdx++)
+    {
+        const JsonValue * gltfPrimitives = gltfMeshes->elements[meshIdx].get("primitives");
+        for (size_t primitiveIdx = 0; gltfPrimitives != nullptr && primitiveIdx < gltfPrimitives->elements.size(); primitiveIdx++)
+        {
+            const JsonValue &gltfPrimitive = gltfPrimitives->elements[primitiveIdx];
+            const JsonValue * attributes = gltfPrimitive.get("attributes");
+            if (gltfPrimitive.getNumber("mode", GLTF_MODE_TRIANGLES) != GLTF_MODE_TRIANGLES || attributes == nullptr ||
+                attributes->get("POSITION") == nullptr)
+            {
+                continue;
+            }
+
+            GlbPrimitive primitive;
+            primitive.positions = getGlbAccessor(document, attributes->getNumber("POSITION", -1.0), bin, binSize);
+            if (primitive.positions.componentType != 5126 || primitive.positions.componentCount != 3)
+            {
+                throw std::runtime_error("glTF positions must be float VEC3 (quantized positions aren't supported)!");
+            }
+
+            if (attributes->get("COLOR_0") != nullptr)
+            {
+                primitive.colours = getGlbAccessor(document, attributes->getNumber("COLOR_0", -1.0), bin, binSize);
+                bool supportedType = primitive.colours.componentType == 5121 || primitive.colours.componentType == 5123 ||
+                                     primitive.colours.componentType == 5126;
+                if (!supportedType || primitive.colours.componentCount < 3 || primitive.colours.count != primitive.positions.count)
+                {
+                    throw std::runtime_error("Unsupported glTF COLOR_0 attribute!");
+                }
+            }
+
+            if (gltfPrimitive.get("indices") != nullptr)
+            {
+                primitive.indexed = true;
+                primitive.indices = getGlbAccessor(document, gltfPrimitive.getNumber("indices", -1.0), bin, binSize);
+                bool supportedType = primitive.indices.componentType == 5121 || primitive.indices.componentType == 5123 ||
+                                     primitive.indices.componentType == 5125;
+                if (!supportedType || primitive.indices.componentCount != 1)
+                {
+                    throw std::runtime_error("Unsupported glTF index type!");
+                }
+            }
+
+            MeshSource mesh;
+            mesh.vertices.resize(primitive.positions.count);
+            mesh.indices.resize((primitive.indexed ? primitive.indices.count : primitive.positions.count) / 3 * 3);
+            meshes.push_back(std::move(mesh));
+            primitives.push_back(primitive);
+        }
+    }
+
+    // Work items: ranges of the vertices or of the indices of a primitive, all converted in parallel
+    struct WorkItem {
+        uint32_t    primitive;
+        bool        indices;
+        uint32_t    begin;
+        uint32_t    end;
+    };
+    std::vector<WorkItem> workItems;
+    for (uint32_t i = 0; i < primitives.size(); i++)
+    {
+        uint32_t vertexCount = static_cast<uint32_t>(meshes[i].vertices.size());
+        for (uint32_t begin = 0; begin < vertexCount; begin += GLB_ELEMENTS_PER_RANGE)
+        {
+            workItems.push_back({ i, false, begin, std::min(begin + GLB_ELEMENTS_PER_RANGE, vertexCount) });
+        }
+        uint32_t indexCount = static_cast<uint32_t>(meshes[i].indices.size());
+        for (uint32_t begin = 0; begin < indexCount; begin += GLB_ELEMENTS_PER_RANGE)
+        {
+            workItems.push_back({ i, true, begin, std::min(begin + GLB_ELEMENTS_PER_RANGE, indexCount) });
+        }
+    }
+
+    threadPool->parallelFor(static_cast<uint32_t>(workItems.size()), [&](uint32_t begin, uint32_t end) {
+        for (uint32_t itemIdx = begin; itemIdx < end; itemIdx++)
+        {
+            const WorkItem &item = workItems[itemIdx];
+            const GlbPrimitive &primitive = primitives[item.primitive];
+            MeshSource &mesh = meshes[item.primitive];
+
+            if (item.indices)
+            {
+                uint32_t vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+                for (uint32_t i = item.begin; i < item.end; i++)
+                {
+                    uint32_t index = primitive.indexed ? readGlbIndex(primitive.indices.data + static_cast<size_t>(i) * primitive.indices.stride,
+                                                                      primitive.indices.componentType) : i;
+                    if (index >= vertexCount)
+                    {
+                        throw std::runtime_error("glTF index out of range!");
+                    }
+                    mesh.indices[i] = index;
+                }
+                continue;
+            }
+
+            for (uint32_t i = item.begin; i < item.end; i++)
+            {
+                Vertex &vertex = mesh.vertices[i];
+                memcpy(&vertex.pos, primitive.positions.data + static_cast<size_t>(i) * primitive.positions.stride, sizeof(glm::vec3));
+
+                vertex.col = glm::vec3(1.0f);
+                if (primitive.colours.count > 0)
+                {
+                    const uint8_t * colour = primitive.colours.data + static_cast<size_t>(i) * primitive.colours.stride;
+                    uint32_t componentSize = (primitive.colours.componentType == 5121) ? 1 : (primitive.colours.componentType == 5123) ? 2 : 4;
+                    for (int k = 0; k < 3; k++)
+                    {
+                        vertex.col[k] = readGlbComponent(colour + k * componentSize, primitive.colours.componentType);
+                    }
+                }
+            }
+        }
+    });
+
+    return meshes;
+}
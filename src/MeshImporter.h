@@ -0,0 +1,45 @@
+#pragma once
+
+// C++ STL
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Project includes
+#include "MeshCache.h"
+#include "ThreadPool.h"
+#include "Utilities.h"
+
+// Static class (only static methods, not instantiable) reading model files into Vertex/index arrays:
+// - Wavefront OBJ (*.obj): the whole file is one mesh; positions (with the optional "v x y z r g b" colours) and
+//   faces (fan triangulated), texture coordinates and normals are skipped (Vertex has none)
+// - glTF 2.0 binary (*.glb): one mesh per triangle primitive, POSITION (float) and COLOR_0 attributes, node
+//   transforms are not applied
+// The parsing is split across the ThreadPool: a counting pass sizes the arrays, then every range writes its
+// elements in place (no allocation per element).
+class MeshImporter
+{
+public:
+    struct Statistics {
+        uint64_t    fileBytes = 0;
+        uint64_t    vertexCount = 0;
+        uint64_t    triangleCount = 0;
+        uint32_t    threadCount = 0;            // Including the calling thread
+        double      parseMilliseconds = 0.0;    // Without reading the file
+    };
+
+    // Throws on unsupported or malformed files
+    static std::vector<MeshSource> import(const std::string &filename, ThreadPool * threadPool, Statistics * statistics = nullptr);
+    static void printStatistics(const std::string &filename, const Statistics &statistics);    // Sizes and parse throughput
+
+private:
+    static std::vector<MeshSource> importObj(const std::vector<char> &fileData, ThreadPool * threadPool);
+    static std::vector<MeshSource> importGlb(const std::vector<char> &fileData, ThreadPool * threadPool);
+
+    // Disallow creating an instance of this object
+    MeshImporter() = delete;
+    ~MeshImporter() = delete;
+    // prevent copying
+    MeshImporter(const MeshImporter&) = delete;
+    MeshImporter& operator=(const MeshImporter&) = delete;
+};
@@ -0,0 +1,335 @@
+#include "MeshOptimizer.h"
+
+// C++ STL
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Forsyth scoring parameters (values from the original article)
+const int   FORSYTH_CACHE_SIZE = 32;            // Modelled LRU cache (bigger than the real one: it only drives the scores)
+const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+//------------------------------------------------------------------------------
+MeshOptimizer::Statistics MeshOptimizer::optimize(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+{
+    Statistics statistics;
+    statistics.vertexCountBefore = vertices.size();
+    statistics.acmrBefore = computeACMR(indices, vertices.size());
+
+    optimizeVertexCache(indices, vertices.size());
+    optimizeOverdraw(indices, vertices);
+    optimizeVertexFetch(vertices, indices);
+
+    statistics.vertexCountAfter = vertices.size();
+    statistics.acmrAfter = computeACMR(indices, vertices.size());
+
+    return statistics;
+}
+//------------------------------------------------------------------------------
+void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Triangles using each vertex (compact adjacency lists: the first 'remaining[v]' entries are the triangles not emitted yet)
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (uint32_t index : indices)
+    {
+        remaining[index]++;
+    }
+
+    std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        adjacencyOffset[v + 1] = adjacencyOffset[v] + remaining[v];
+    }
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> adjacencyFill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        adjacency[adjacencyFill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    // Initial scores (nothing in cache yet)
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> score(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        score[v] = vertexScore(-1, remaining[v]);
+    }
+
+    std::vector<float> triangleScore(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> newCache;
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    size_t nextCandidate = 0;       // Fallback when no triangle touches the cache: first one not emitted, in input order
+    int64_t bestTriangle = -1;
+    for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+    {
+        if (bestTriangle < 0)
+        {
+            while (emitted[nextCandidate])
+            {
+                nextCandidate++;
+            }
+            bestTriangle = static_cast<int64_t>(nextCandidate);
+        }
+
+        // Emit the triangle and remove it from the adjacency of its vertices
+        const uint32_t * triangle = &indices[bestTriangle * 3];
+        emitted[bestTriangle] = true;
+        output.insert(output.end(), triangle, triangle + 3);
+
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t * triangles = &adjacency[adjacencyOffset[triangle[k]]];
+            uint32_t &count = remaining[triangle[k]];
+            for (uint32_t i = 0; i < count; i++)
+            {
+                if (triangles[i] == bestTriangle)
+                {
+                    triangles[i] = triangles[count - 1];
+                    count--;
+                    break;
+                }
+            }
+        }
+
+        // LRU cache: the vertices of the triangle go to the front
+        newCache.clear();
+        for (int k = 0; k < 3; k++)
+        {
+            if (std::find(newCache.begin(), newCache.end(), triangle[k]) == newCache.end())
+            {
+                newCache.push_back(triangle[k]);
+            }
+        }
+        size_t triangleVertexCount = newCache.size();    // Less than 3 for degenerate triangles
+        for (uint32_t v : cache)
+        {
+            if (std::find(newCache.begin(), newCache.begin() + triangleVertexCount, v) == newCache.begin() + triangleVertexCount)
+            {
+                newCache.push_back(v);
+            }
+        }
+
+        // Rescore the vertices whose cache position changed (evicted ones included), then their triangles:
+        // the next triangle is the best one among those touching the cache
+        for (size_t i = 0; i < newCache.size(); i++)
+        {
+            uint32_t v = newCache[i];
+            cachePosition[v] = (i < FORSYTH_CACHE_SIZE) ? static_cast<int>(i) : -1;
+            score[v] = vertexScore(cachePosition[v], remaining[v]);
+        }
+
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+        for (uint32_t v : newCache)
+        {
+            const uint32_t * triangles = &adjacency[adjacencyOffset[v]];
+            for (uint32_t i = 0; i < remaining[v]; i++)
+            {
+                uint32_t t = triangles[i];
+                triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+                if (cachePosition[v] >= 0 && triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        if (newCache.size() > FORSYTH_CACHE_SIZE)
+        {
+            newCache.resize(FORSYTH_CACHE_SIZE);
+        }
+        cache.swap(newCache);
+    }
+
+    indices.swap(output);
+}
+//------------------------------------------------------------------------------
+void MeshOptimizer::optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<Vertex> &vertices)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Cluster boundaries: triangles whose 3 vertices all miss the cache (the cache restarts there anyway,
+    // so moving whole clusters around costs little ACMR)
+    std::vector<size_t> clusterStart;
+    std::vector<uint32_t> cacheTimestamp(vertices.size(), 0);
+    uint32_t time = DEFAULT_CACHE_SIZE + 1;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        int misses = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t index = indices[t * 3 + k];
+            if (time - cacheTimestamp[index] > DEFAULT_CACHE_SIZE)
+            {
+                cacheTimestamp[index] = time++;
+                misses++;
+            }
+        }
+
+        if (t == 0 || misses == 3)
+        {
+            clusterStart.push_back(t);
+        }
+    }
+    clusterStart.push_back(triangleCount);
+
+    // Area weighted centroid and normal of every cluster, and of the whole mesh
+    size_t clusterCount = clusterStart.size() - 1;
+    std::vector<glm::vec3> clusterCentroid(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormal(clusterCount, glm::vec3(0.0f));
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        float clusterArea = 0.0f;
+        for (size_t t = clusterStart[c]; t < clusterStart[c + 1]; t++)
+        {
+            const glm::vec3 &p0 = vertices[indices[t * 3]].pos;
+            const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].pos;
+            const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].pos;
+
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);     // Length: twice the triangle area
+            float area = glm::length(normal);
+
+            clusterCentroid[c] += (p0 + p1 + p2) * (area / 3.0f);
+            clusterNormal[c] += normal;
+            clusterArea += area;
+        }
+
+        meshCentroid += clusterCentroid[c];
+        meshArea += clusterArea;
+        clusterCentroid[c] = (clusterArea > 0.0f) ? clusterCentroid[c] / clusterArea : glm::vec3(0.0f);
+    }
+    meshCentroid = (meshArea > 0.0f) ? meshCentroid / meshArea : glm::vec3(0.0f);
+
+    // Occlusion potential: clusters far out from the center and facing outwards are likely to hide the others
+    std::vector<float> occlusionPotential(clusterCount, 0.0f);
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        float normalLength = glm::length(clusterNormal[c]);
+        if (normalLength > 0.0f)
+        {
+            occlusionPotential[c] = glm::dot(clusterCentroid[c] - meshCentroid, clusterNormal[c] / normalLength);
+        }
+    }
+
+    // Stable sort: equal potentials keep their (cache friendly) order, and the result is deterministic
+    std::vector<size_t> clusterOrder(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        clusterOrder[c] = c;
+    }
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](size_t a, size_t b) {
+        return occlusionPotential[a] > occlusionPotential[b];
+    });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for (size_t c : clusterOrder)
+    {
+        output.insert(output.end(), indices.begin() + clusterStart[c] * 3, indices.begin() + clusterStart[c + 1] * 3);
+    }
+
+    indices.swap(output);
+}
+//------------------------------------------------------------------------------
+size_t MeshOptimizer::optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+{
+    // New position of every vertex: order of first use by the (already reordered) triangles
+    const uint32_t unused = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> remap(vertices.size(), unused);
+
+    std::vector<Vertex> fetchOrderedVertices;
+    fetchOrderedVertices.reserve(vertices.size());
+    for (uint32_t &index : indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = static_cast<uint32_t>(fetchOrderedVertices.size());
+            fetchOrderedVertices.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices.swap(fetchOrderedVertices);
+
+    return vertices.size();
+}
+//------------------------------------------------------------------------------
+float MeshOptimizer::computeACMR(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return 0.0f;
+    }
+
+    // FIFO cache: a vertex is in cache if it was loaded by one of the last 'cacheSize' misses (hits don't refresh it)
+    std::vector<uint32_t> cacheTimestamp(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+    size_t misses = 0;
+    for (uint32_t index : indices)
+    {
+        if (time - cacheTimestamp[index] > cacheSize)
+        {
+            cacheTimestamp[index] = time++;
+            misses++;
+        }
+    }
+
+    return static_cast<float>(misses) / static_cast<float>(triangleCount);
+}
+
+//------------------------------------------------------------------------------
+float MeshOptimizer::vertexScore(int cachePosition, uint32_t remainingTriangles)
+{
+    // No triangle left to emit: never worth it
+    if (remainingTriangles == 0)
+    {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+        {
+            // Used by the last triangle: fixed score, so that strips don't beat fans
+            score = FORSYTH_LAST_TRIANGLE_SCORE;
+        }
+        else
+        {
+            float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+        }
+    }
+
+    // Boost vertices with few triangles left, so that they're finished off instead of being left alone
+    score += FORSYTH_VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -FORSYTH_VALENCE_BOOST_POWER);
+
+    return score;
+}
@@ -0,0 +1,322 @@
+#include "MeshSimplifier.h"
+
+// C++ STL
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <utility>
+
+// Weight of the planes keeping the open borders (and seams) of the mesh in place, relative to the surface planes
+const float BORDER_PLANE_WEIGHT = 10.0f;
+
+//------------------------------------------------------------------------------
+std::vector<uint32_t> MeshSimplifier::simplify(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+                                               size_t targetIndexCount, float &resultError)
+{
+    resultError = 0.0f;
+
+    size_t vertexCount = vertices.size();
+    size_t triangleCount = indices.size() / 3;
+
+    // Working copy of the triangles: collapses remap their indices in place
+    std::vector<uint32_t> triangles(indices.begin(), indices.begin() + triangleCount * 3);
+    std::vector<bool> triangleRemoved(triangleCount, false);
+    size_t liveTriangleCount = triangleCount;
+
+    std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        const uint32_t * triangle = &triangles[t * 3];
+        if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[2] == triangle[0])
+        {
+            triangleRemoved[t] = true;
+            liveTriangleCount--;
+            continue;
+        }
+
+        for (int k = 0; k < 3; k++)
+        {
+            vertexTriangles[triangle[k]].push_back(static_cast<uint32_t>(t));
+        }
+    }
+
+    // Quadric of every vertex: planes of its triangles, weighted by their area
+    std::vector<Quadric> quadrics(vertexCount);
+    std::vector<glm::vec3> triangleNormals(triangleCount, glm::vec3(0.0f));
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        if (triangleRemoved[t])
+        {
+            continue;
+        }
+
+        const uint32_t * triangle = &triangles[t * 3];
+        const glm::vec3 &p0 = vertices[triangle[0]].pos;
+        glm::vec3 normal = glm::cross(vertices[triangle[1]].pos - p0, vertices[triangle[2]].pos - p0);
+        float doubleArea = glm::length(normal);
+        if (doubleArea <= 0.0f)
+        {
+            continue;
+        }
+
+        normal /= doubleArea;
+        triangleNormals[t] = normal;
+        for (int k = 0; k < 3; k++)
+        {
+            quadrics[triangle[k]].addPlane(normal, -glm::dot(normal, p0), doubleArea * 0.5f);
+        }
+    }
+
+    // Edges (smallest vertex index first) with the triangle using them, sorted: an edge found once is a border
+    std::vector<std::pair<uint64_t, uint32_t>> edges;
+    edges.reserve(liveTriangleCount * 3);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        if (triangleRemoved[t])
+        {
+            continue;
+        }
+
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t a = triangles[t * 3 + k];
+            uint32_t b = triangles[t * 3 + (k + 1) % 3];
+            uint64_t key = (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+            edges.push_back({ key, static_cast<uint32_t>(t) });
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    for (size_t i = 0; i < edges.size(); i++)
+    {
+        bool shared = (i > 0 && edges[i - 1].first == edges[i].first) || (i + 1 < edges.size() && edges[i + 1].first == edges[i].first);
+        if (shared)
+        {
+            continue;
+        }
+
+        // Plane through the border edge, perpendicular to its triangle: moving the border away from it costs
+        uint32_t a = static_cast<uint32_t>(edges[i].first >> 32);
+        uint32_t b = static_cast<uint32_t>(edges[i].first & 0xFFFFFFFF);
+        glm::vec3 edge = vertices[b].pos - vertices[a].pos;
+        glm::vec3 normal = glm::cross(edge, triangleNormals[edges[i].second]);
+        float normalLength = glm::length(normal);
+        if (normalLength <= 0.0f)
+        {
+            continue;
+        }
+
+        normal /= normalLength;
+        float planeWeight = BORDER_PLANE_WEIGHT * glm::dot(edge, edge);
+        quadrics[a].addPlane(normal, -glm::dot(normal, vertices[a].pos), planeWeight);
+        quadrics[b].addPlane(normal, -glm::dot(normal, vertices[a].pos), planeWeight);
+    }
+
+    // Candidate collapses, cheapest first ('from' moves onto 'to'). Entries are never updated: they are skipped when
+    // one of their vertices changed since (version) or was collapsed. Ties are broken by the vertex indices (deterministic)
+    struct Collapse {
+        double      error;
+        uint32_t    from;
+        uint32_t    to;
+        uint32_t    fromVersion;
+        uint32_t    toVersion;
+
+        bool operator>(const Collapse &other) const
+        {
+            if (error != other.error)
+            {
+                return error > other.error;
+            }
+            return (from != other.from) ? from > other.from : to > other.to;
+        }
+    };
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> collapses;
+    std::vector<uint32_t> vertexVersion(vertexCount, 0);
+    std::vector<bool> vertexCollapsed(vertexCount, false);
+
+    auto pushCollapse = [&](uint32_t a, uint32_t b) {
+        Quadric quadric = quadrics[a];
+        quadric.add(quadrics[b]);
+        double errorToB = quadric.evaluate(vertices[b].pos);
+        double errorToA = quadric.evaluate(vertices[a].pos);
+        if (errorToB <= errorToA)
+        {
+            collapses.push({ errorToB, a, b, vertexVersion[a], vertexVersion[b] });
+        }
+        else
+        {
+            collapses.push({ errorToA, b, a, vertexVersion[b], vertexVersion[a] });
+        }
+    };
+
+    for (size_t i = 0; i < edges.size(); i++)
+    {
+        if (i == 0 || edges[i - 1].first != edges[i].first)
+        {
+            pushCollapse(static_cast<uint32_t>(edges[i].first >> 32), static_cast<uint32_t>(edges[i].first & 0xFFFFFFFF));
+        }
+    }
+
+    std::vector<uint32_t> neighbours;
+    while (liveTriangleCount * 3 > targetIndexCount && !collapses.empty())
+    {
+        Collapse collapse = collapses.top();
+        collapses.pop();
+
+        if (vertexCollapsed[collapse.from] || vertexCollapsed[collapse.to] ||
+            vertexVersion[collapse.from] != collapse.fromVersion || vertexVersion[collapse.to] != collapse.toVersion)
+        {
+            continue;
+        }
+
+        // Moving 'from' must not flip any of its triangles (those using the edge disappear)
+        const glm::vec3 &target = vertices[collapse.to].pos;
+        bool flips = false;
+        for (uint32_t t : vertexTriangles[collapse.from])
+        {
+            const uint32_t * triangle = &triangles[t * 3];
+            if (triangleRemoved[t] || triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+            {
+                continue;
+            }
+
+            glm::vec3 p[3];
+            glm::vec3 moved[3];
+            for (int k = 0; k < 3; k++)
+            {
+                p[k] = vertices[triangle[k]].pos;
+                moved[k] = (triangle[k] == collapse.from) ? target : p[k];
+            }
+
+            glm::vec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+            glm::vec3 movedNormal = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+            if (glm::dot(normal, movedNormal) <= 0.0f)
+            {
+                flips = true;
+                break;
+            }
+        }
+
+        if (flips)
+        {
+            continue;
+        }
+
+        // Collapse: the triangles of 'from' now use 'to' (or disappear, for those sharing the edge)
+        resultError = std::max(resultError, static_cast<float>(std::sqrt(std::max(collapse.error, 0.0))));
+        vertexCollapsed[collapse.from] = true;
+        quadrics[collapse.to].add(quadrics[collapse.from]);
+        vertexVersion[collapse.to]++;
+
+        for (uint32_t t : vertexTriangles[collapse.from])
+        {
+            if (triangleRemoved[t])
+            {
+                continue;
+            }
+
+            uint32_t * triangle = &triangles[t * 3];
+            for (int k = 0; k < 3; k++)
+            {
+                if (triangle[k] == collapse.from)
+                {
+                    triangle[k] = collapse.to;
+                }
+            }
+
+            if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[2] == triangle[0])
+            {
+                triangleRemoved[t] = true;
+                liveTriangleCount--;
+            }
+            else
+            {
+                vertexTriangles[collapse.to].push_back(t);
+            }
+        }
+        vertexTriangles[collapse.from].clear();
+
+        // Drop the removed triangles of 'to', and queue the new costs of its edges
+        std::vector<uint32_t> &toTriangles = vertexTriangles[collapse.to];
+        toTriangles.erase(std::remove_if(toTriangles.begin(), toTriangles.end(), [&](uint32_t t) { return triangleRemoved[t]; }),
+            toTriangles.end());
+
+        neighbours.clear();
+        for (uint32_t t : toTriangles)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                if (triangles[t * 3 + k] != collapse.to)
+                {
+                    neighbours.push_back(triangles[t * 3 + k]);
+                }
+            }
+        }
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+
+        for (uint32_t neighbour : neighbours)
+        {
+            pushCollapse(collapse.to, neighbour);
+        }
+    }
+
+    // Surviving triangles, in their original order
+    std::vector<uint32_t> simplifiedIndices;
+    simplifiedIndices.reserve(liveTriangleCount * 3);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        if (!triangleRemoved[t])
+        {
+            simplifiedIndices.insert(simplifiedIndices.end(), &triangles[t * 3], &triangles[t * 3] + 3);
+        }
+    }
+
+    return simplifiedIndices;
+}
+
+//------------------------------------------------------------------------------
+void MeshSimplifier::Quadric::addPlane(const glm::vec3 &normal, float distance, float planeWeight)
+{
+    double a = normal.x;
+    double b = normal.y;
+    double c = normal.z;
+    double d = distance;
+    double w = planeWeight;
+
+    a2 += w * a * a;    ab += w * a * b;    ac += w * a * c;    ad += w * a * d;
+                        b2 += w * b * b;    bc += w * b * c;    bd += w * b * d;
+                                            c2 += w * c * c;    cd += w * c * d;
+                                                                d2 += w * d * d;
+    weight += w;
+}
+//------------------------------------------------------------------------------
+void MeshSimplifier::Quadric::add(const Quadric &other)
+{
+    a2 += other.a2;     ab += other.ab;     ac += other.ac;     ad += other.ad;
+                        b2 += other.b2;     bc += other.bc;     bd += other.bd;
+                                            c2 += other.c2;     cd += other.cd;
+                                                                d2 += other.d2;
+    weight += other.weight;
+}
+//------------------------------------------------------------------------------
+double MeshSimplifier::Quadric::evaluate(const glm::vec3 &position) const
+{
+    if (weight <= 0.0)
+    {
+        return 0.0;
+    }
+
+    double x = position.x;
+    double y = position.y;
+    double z = position.z;
+
+    // v^T Q v, with v = (x, y, z, 1)
+    double error =  a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x
+                  + b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y
+                  + c2 * z * z + 2.0 * cd * z
+                  + d2;
+
+    return error / weight;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+// C++ STL
+#include <cstdint>
+#include <vector>
+
+// Project includes
+#include "Utilities.h"
+
+// Static class (only static methods, not instantiable) building simplified versions of a mesh for its LODs
+// (Garland & Heckbert, "Surface Simplification Using Quadric Error Metrics"). CPU only and deterministic.
+class MeshSimplifier
+{
+public:
+    // Simplified copy of 'indices', down to about 'targetIndexCount' indices (less when the mesh can't be simplified that far).
+    // Edges are collapsed onto one of their vertices: the result references the same 'vertices' (no new vertex).
+    // 'resultError' receives the error of the result: largest distance (model space) to the planes of the original surface
+    static std::vector<uint32_t>    simplify(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+                                             size_t targetIndexCount, float &resultError);
+
+private:
+    // Sum of squared distances to a set of weighted planes (symmetric 4x4 matrix, upper triangle)
+    struct Quadric {
+        double  a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+        double          b2 = 0.0, bc = 0.0, bd = 0.0;
+        double                  c2 = 0.0, cd = 0.0;
+        double                          d2 = 0.0;
+        double  weight = 0.0;       // Sum of the plane weights: error / weight is a mean squared distance
+
+        void    addPlane(const glm::vec3 &normal, float distance, float planeWeight);
+        void    add(const Quadric &other);
+        double  evaluate(const glm::vec3 &position) const;      // Mean squared distance of 'position' to the planes
+    };
+
+    // Disallow creating an instance of this object
+    MeshSimplifier() = delete;
+    ~MeshSimplifier() = delete;
+    // prevent copying
+    MeshSimplifier(const MeshSimplifier&) = delete;
+    MeshSimplifier& operator=(const MeshSimplifier&) = delete;
+};
@@ -0,0 +1,119 @@
+#include "MeshletBuilder.h"
+
+// C++ STL
+#include <algorithm>
+#include <cmath>
+
+//------------------------------------------------------------------------------
+std::vector<Meshlet> MeshletBuilder::build(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+                                           uint32_t maxVertices, uint32_t maxTriangles)
+{
+    std::vector<Meshlet> meshlets;
+
+    // Meshlet (+1) each vertex was last counted in: its vertices are the ones stamped with the current meshlet
+    std::vector<uint32_t> vertexStamp(vertices.size(), 0);
+    uint32_t stamp = 1;
+
+    uint32_t firstIndex = 0;
+    uint32_t vertexCount = 0;
+    uint32_t triangleCount = 0;
+    uint32_t indexCount = static_cast<uint32_t>(indices.size() / 3 * 3);
+    for (uint32_t i = 0; i < indexCount; i += 3)
+    {
+        uint32_t newVertices = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            newVertices += (vertexStamp[indices[i + k]] != stamp) ? 1 : 0;
+        }
+
+        // Full: close the meshlet, the triangle starts the next one
+        if (vertexCount + newVertices > maxVertices || triangleCount + 1 > maxTriangles)
+        {
+            meshlets.push_back(computeBounds(vertices, indices, firstIndex, i - firstIndex));
+
+            stamp++;
+            firstIndex = i;
+            vertexCount = 0;
+            triangleCount = 0;
+        }
+
+        for (int k = 0; k < 3; k++)
+        {
+            if (vertexStamp[indices[i + k]] != stamp)
+            {
+                vertexStamp[indices[i + k]] = stamp;
+                vertexCount++;
+            }
+        }
+        triangleCount++;
+    }
+
+    if (triangleCount > 0)
+    {
+        meshlets.push_back(computeBounds(vertices, indices, firstIndex, indexCount - firstIndex));
+    }
+
+    return meshlets;
+}
+
+//------------------------------------------------------------------------------
+Meshlet MeshletBuilder::computeBounds(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+                                      uint32_t firstIndex, uint32_t indexCount)
+{
+    Meshlet meshlet;
+    meshlet.firstIndex = firstIndex;
+    meshlet.indexCount = indexCount;
+
+    // Bounding sphere around the center of the bounding box (like Mesh)
+    glm::vec3 minPos = vertices[indices[firstIndex]].pos;
+    glm::vec3 maxPos = minPos;
+    for (uint32_t i = firstIndex; i < firstIndex + indexCount; i++)
+    {
+        minPos = glm::min(minPos, vertices[indices[i]].pos);
+        maxPos = glm::max(maxPos, vertices[indices[i]].pos);
+    }
+
+    glm::vec3 center = (minPos + maxPos) * 0.5f;
+    float radius = 0.0f;
+    for (uint32_t i = firstIndex; i < firstIndex + indexCount; i++)
+    {
+        radius = std::max(radius, glm::length(vertices[indices[i]].pos - center));
+    }
+    meshlet.boundingSphere = glm::vec4(center, radius);
+
+    // Normal cone: average of the triangle normals, opened to the normal furthest from it
+    std::vector<glm::vec3> normals;
+    normals.reserve(indexCount / 3);
+    glm::vec3 normalSum(0.0f);
+    for (uint32_t i = firstIndex; i < firstIndex + indexCount; i += 3)
+    {
+        const glm::vec3 &p0 = vertices[indices[i]].pos;
+        glm::vec3 normal = glm::cross(vertices[indices[i + 1]].pos - p0, vertices[indices[i + 2]].pos - p0);
+        float normalLength = glm::length(normal);
+        if (normalLength > 0.0f)
+        {
+            normals.push_back(normal / normalLength);
+            normalSum += normals.back();
+        }
+    }
+
+    float axisLength = glm::length(normalSum);
+    if (axisLength <= 0.0f)
+    {
+        meshlet.normalCone = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+        return meshlet;
+    }
+
+    glm::vec3 axis = normalSum / axisLength;
+    float minDot = 1.0f;
+    for (const glm::vec3 &normal : normals)
+    {
+        minDot = std::min(minDot, glm::dot(axis, normal));
+    }
+
+    // Half angle of 90 degrees or more: some triangle faces the camera from any side
+    float sinHalfAngle = (minDot <= 0.0f) ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+    meshlet.normalCone = glm::vec4(axis, sinHalfAngle);
+
+    return meshlet;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+// C++ STL
+#include <cstdint>
+#include <vector>
+
+// Project includes
+#include "Utilities.h"
+
+// Cluster of triangles of a mesh, culled on its own: a contiguous range of the mesh indices (no index rewrite)
+struct Meshlet {
+    glm::vec4   boundingSphere;     // Model space: xyz center, w radius
+    glm::vec4   normalCone;         // xyz: axis (average normal), w: sine of the cone half angle (1: never backfacing as a whole)
+    uint32_t    firstIndex = 0;     // Relative to the first index of the mesh
+    uint32_t    indexCount = 0;
+};
+
+// Static class (only static methods, not instantiable) splitting meshes into meshlets. CPU only and deterministic.
+class MeshletBuilder
+{
+public:
+    static const uint32_t MAX_VERTICES = 64;
+    static const uint32_t MAX_TRIANGLES = 124;
+
+    // Greedy split in index order: a meshlet is closed when the next triangle would exceed one of the limits
+    // (N.B.: meshlets are as compact as the triangle order is: best after MeshOptimizer::optimizeVertexCache)
+    static std::vector<Meshlet> build(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+                                      uint32_t maxVertices = MAX_VERTICES, uint32_t maxTriangles = MAX_TRIANGLES);
+
+private:
+    static Meshlet  computeBounds(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+                                  uint32_t firstIndex, uint32_t indexCount);
+
+    // Disallow creating an instance of this object
+    MeshletBuilder() = delete;
+    ~MeshletBuilder() = delete;
+    // prevent copying
+    MeshletBuilder(const MeshletBuilder&) = delete;
+    MeshletBuilder& operator=(const MeshletBuilder&) = delete;
+};
@@ -0,0 +1,172 @@
+#include "PipelineCache.h"
+
+// C++ STL
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+using std::cout;
+using std::endl;
+
+// Disable warning about Vulkan unscoped enums for this entire file
+#pragma warning( push )
+#pragma warning(disable : 26812) // The enum type * is unscoped. Prefer 'enum class' over 'enum'.
+
+//------------------------------------------------------------------------------
+PipelineCache::PipelineCache()
+{
+}
+//------------------------------------------------------------------------------
+void PipelineCache::init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string &filename)
+{
+    m_device = device;
+    m_filename = filename;
+    m_initialDataSize = 0;
+
+    // Cache data of a previous launch, if it was written by this device and driver
+    std::vector<char> initialData;
+    if (!m_filename.empty())
+    {
+        std::ifstream file(m_filename, std::ios::binary | std::ios::ate);
+        if (file.is_open())
+        {
+            initialData.resize(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(initialData.data(), static_cast<std::streamsize>(initialData.size()));
+            if (!file)
+            {
+                initialData.clear();
+            }
+        }
+
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+        std::string reason;
+        if (!initialData.empty() && !isCompatible(initialData, deviceProperties, reason))
+        {
+            cout << "Pipeline cache '" << m_filename << "' ignored: " << reason << endl;
+            initialData.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
+    pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pipelineCacheCreateInfo.initialDataSize = initialData.size();
+    pipelineCacheCreateInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+    VkResult result = vkCreatePipelineCache(m_device, &pipelineCacheCreateInfo, nullptr, &m_pipelineCache);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create the Pipeline Cache!");
+    }
+    m_initialDataSize = initialData.size();
+}
+//------------------------------------------------------------------------------
+void PipelineCache::save()
+{
+    if (m_pipelineCache == VK_NULL_HANDLE || m_filename.empty())
+    {
+        return;
+    }
+
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(m_device, m_pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+    {
+        cout << "ERROR: Failed to get the Pipeline Cache data!" << endl;
+        return;
+    }
+    std::vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(m_device, m_pipelineCache, &dataSize, data.data()) != VK_SUCCESS)
+    {
+        cout << "ERROR: Failed to get the Pipeline Cache data!" << endl;
+        return;
+    }
+
+    // Through a temporary file: an interrupted write never leaves a truncated cache behind
+    std::string temporaryFilename = m_filename + ".tmp";
+    {
+        std::ofstream file(temporaryFilename, std::ios::binary | std::ios::trunc);
+        file.write(data.data(), static_cast<std::streamsize>(dataSize));
+        if (!file)
+        {
+            cout << "ERROR: Failed to write the pipeline cache '" << temporaryFilename << "'!" << endl;
+            return;
+        }
+    }
+
+    std::remove(m_filename.c_str());    // std::rename doesn't replace an existing file everywhere (Windows)
+    if (std::rename(temporaryFilename.c_str(), m_filename.c_str()) != 0)
+    {
+        cout << "ERROR: Failed to write the pipeline cache '" << m_filename << "'!" << endl;
+    }
+}
+//------------------------------------------------------------------------------
+void PipelineCache::destroy()
+{
+    if (m_pipelineCache != VK_NULL_HANDLE)
+    {
+        vkDestroyPipelineCache(m_device, m_pipelineCache, nullptr);
+        m_pipelineCache = VK_NULL_HANDLE;
+    }
+}
+//------------------------------------------------------------------------------
+VkPipelineCache PipelineCache::getPipelineCache() const
+{
+    return m_pipelineCache;
+}
+//------------------------------------------------------------------------------
+bool PipelineCache::isWarm() const
+{
+    return m_initialDataSize > 0;
+}
+//------------------------------------------------------------------------------
+size_t PipelineCache::getInitialDataSize() const
+{
+    return m_initialDataSize;
+}
+//------------------------------------------------------------------------------
+PipelineCache::~PipelineCache()
+{
+}
+//------------------------------------------------------------------------------
+bool PipelineCache::isCompatible(const std::vector<char> &data, const VkPhysicalDeviceProperties &deviceProperties, std::string &reason)
+{
+    // VkPipelineCacheHeaderVersionOne: headerSize, headerVersion, vendorID, deviceID (uint32_t each), pipelineCacheUUID
+    const size_t headerSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+    if (data.size() < headerSize)
+    {
+        reason = "truncated header";
+        return false;
+    }
+
+    uint32_t header[4];
+    memcpy(header, data.data(), sizeof(header));
+    if (header[0] < headerSize || header[0] > data.size())
+    {
+        reason = "invalid header size";
+        return false;
+    }
+    if (header[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+    {
+        reason = "unknown header version " + std::to_string(header[1]);
+        return false;
+    }
+    if (header[2] != deviceProperties.vendorID || header[3] != deviceProperties.deviceID)
+    {
+        reason = "written by another device";
+        return false;
+    }
+    if (memcmp(data.data() + sizeof(header), deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+        reason = "written by another driver version (pipelineCacheUUID)";
+        return false;
+    }
+
+    return true;
+}
+
+#pragma warning( pop )
@@ -0,0 +1,47 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+// C++ STL
+#include <string>
+#include <vector>
+
+// Disable warning about Vulkan unscoped enums for this entire file
+#pragma warning( push )
+#pragma warning(disable : 26812) // The enum type * is unscoped. Prefer 'enum class' over 'enum'.
+
+// VkPipelineCache persisted to a file: seeded from it when its header (VkPipelineCacheHeaderVersionOne) matches the
+// device (vendorID, deviceID, pipelineCacheUUID), so that the pipelines of the next launches skip the shader
+// compilation. A missing, truncated or foreign file only means a cold (empty) cache.
+class PipelineCache
+{
+public:
+    PipelineCache();
+
+    // Empty filename: in-memory cache only (never read nor written)
+    void            init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string &filename);
+    void            save();         // Writes the cache data back to the file (errors are printed, not thrown)
+    void            destroy();
+
+    VkPipelineCache getPipelineCache() const;
+    bool            isWarm() const;             // Seeded from the file
+    size_t          getInitialDataSize() const; // Bytes read from the file (0 when cold)
+
+    ~PipelineCache();
+
+private:
+    VkDevice        m_device = VK_NULL_HANDLE;
+    VkPipelineCache m_pipelineCache = VK_NULL_HANDLE;
+    std::string     m_filename;
+    size_t          m_initialDataSize = 0;
+
+    // Methods
+    static bool     isCompatible(const std::vector<char> &data, const VkPhysicalDeviceProperties &deviceProperties, std::string &reason);
+
+    // prevent copying (the cache is owned)
+    PipelineCache(const PipelineCache&) = delete;
+    PipelineCache& operator=(const PipelineCache&) = delete;
+};
+
+#pragma warning( pop )
@@ -0,0 +1,144 @@
+#include "RangeAllocator.h"
+
+RangeAllocator::RangeAllocator()
+{
+}
+
+RangeAllocator::RangeAllocator(uint64_t size)
+{
+    m_size = size;
+    reset();
+}
+
+uint64_t RangeAllocator::allocate(uint64_t size, uint64_t alignment)
+{
+    if (size == 0 || alignment == 0)
+    {
+        return INVALID_OFFSET;
+    }
+
+    // First-fit: walk free ranges by offset until one can hold the aligned request
+    for (auto it = m_freeRanges.begin(); it != m_freeRanges.end(); ++it)
+    {
+        uint64_t rangeOffset = it->first;
+        uint64_t rangeSize = it->second;
+
+        uint64_t alignedOffset = ((rangeOffset + alignment - 1) / alignment) * alignment;
+        uint64_t padding = alignedOffset - rangeOffset;
+        if (padding + size > rangeSize)
+        {
+            continue;
+        }
+
+        m_freeRanges.erase(it);
+
+        // Leading padding (due to alignment) and trailing left-over go back to the free list
+        if (padding > 0)
+        {
+            m_freeRanges[rangeOffset] = padding;
+        }
+        uint64_t remaining = rangeSize - padding - size;
+        if (remaining > 0)
+        {
+            m_freeRanges[alignedOffset + size] = remaining;
+        }
+
+        m_usedSize += size;
+        return alignedOffset;
+    }
+
+    return INVALID_OFFSET;
+}
+
+void RangeAllocator::free(uint64_t offset, uint64_t size)
+{
+    if (size == 0 || offset == INVALID_OFFSET)
+    {
+        return;
+    }
+
+    m_usedSize -= size;
+    insertFreeRange(offset, size);
+}
+
+void RangeAllocator::grow(uint64_t newSize)
+{
+    if (newSize <= m_size)
+    {
+        return;
+    }
+
+    uint64_t oldSize = m_size;
+    m_size = newSize;
+    insertFreeRange(oldSize, newSize - oldSize);
+}
+
+void RangeAllocator::reset()
+{
+    m_usedSize = 0U;
+    m_freeRanges.clear();
+    if (m_size > 0)
+    {
+        m_freeRanges[0] = m_size;
+    }
+}
+
+uint64_t RangeAllocator::getSize() const
+{
+    return m_size;
+}
+
+uint64_t RangeAllocator::getUsedSize() const
+{
+    return m_usedSize;
+}
+
+uint64_t RangeAllocator::getFreeSize() const
+{
+    return m_size - m_usedSize;
+}
+
+uint64_t RangeAllocator::getLargestFreeRange() const
+{
+    uint64_t largest = 0U;
+    for (const auto &range : m_freeRanges)
+    {
+        largest = (range.second > largest) ? range.second : largest;
+    }
+    return largest;
+}
+
+bool RangeAllocator::isEmpty() const
+{
+    return m_usedSize == 0U;
+}
+
+RangeAllocator::~RangeAllocator()
+{
+}
+
+
+// Private methods
+void RangeAllocator::insertFreeRange(uint64_t offset, uint64_t size)
+{
+    // Merge with the following range if it starts exactly where this one ends
+    auto next = m_freeRanges.lower_bound(offset);
+    if (next != m_freeRanges.end() && next->first == offset + size)
+    {
+        size += next->second;
+        next = m_freeRanges.erase(next);
+    }
+
+    // Merge with the preceding range if it ends exactly where this one starts
+    if (next != m_freeRanges.begin())
+    {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset)
+        {
+            prev->second += size;
+            return;
+        }
+    }
+
+    m_freeRanges[offset] = size;
+}
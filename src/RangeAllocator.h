@@ -0,0 +1,43 @@
+#pragma once
+
+// C++ STL
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <map>
+
+// Free-list allocator of [offset, offset + size) ranges inside a linear address space.
+// It doesn't own any memory: callers use the returned offsets to address their own
+// resource (a VkDeviceMemory block, a big VkBuffer, etc.).
+class RangeAllocator
+{
+public:
+    static const uint64_t INVALID_OFFSET = std::numeric_limits<uint64_t>::max();
+
+    RangeAllocator();
+    RangeAllocator(uint64_t size);
+
+    // Returns the (aligned) offset of a free range of 'size' bytes, or INVALID_OFFSET if none fits
+    uint64_t    allocate(uint64_t size, uint64_t alignment = 1);
+    // Gives back a range previously returned by allocate() (same size), merging it with its free neighbours
+    void        free(uint64_t offset, uint64_t size);
+    // Extends the address space (the new space is appended as a free range at the end)
+    void        grow(uint64_t newSize);
+    void        reset();
+
+    uint64_t    getSize() const;
+    uint64_t    getUsedSize() const;
+    uint64_t    getFreeSize() const;
+    uint64_t    getLargestFreeRange() const;
+    bool        isEmpty() const;
+
+    ~RangeAllocator();
+
+private:
+    uint64_t                        m_size = 0U;
+    uint64_t                        m_usedSize = 0U;
+    std::map<uint64_t, uint64_t>    m_freeRanges;       // Offset -> Size, ordered by offset to make merging neighbours easy
+
+    // Methods
+    void insertFreeRange(uint64_t offset, uint64_t size);
+};
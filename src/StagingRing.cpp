@@ -0,0 +1,232 @@
+#include "StagingRing.h"
+
+// C++ STL
+#include <limits>
+#include <stdexcept>
+
+// Project includes
+#include "Utilities.h"
+
+// Disable warning about Vulkan unscoped enums for this entire file
+#pragma warning( push )
+#pragma warning(disable : 26812) // The enum type * is unscoped. Prefer 'enum class' over 'enum'.
+
+StagingRing::StagingRing()
+{
+}
+
+void StagingRing::init(VkDevice device, DeviceMemoryAllocator * allocator, VkDeviceSize size)
+{
+    m_device = device;
+    m_allocator = allocator;
+    m_size = size;
+
+    // One host visible buffer for the whole life of the ring: it's never mapped/unmapped again after this
+    createBuffer(m_device, m_allocator, m_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &m_buffer, &m_bufferMemory);
+}
+
+void StagingRing::destroy()
+{
+    // N.B.: the device must be idle (no submission can still be reading from the ring)
+    for (auto &release : m_inFlight)
+    {
+        vkDestroyFence(m_device, release.fence, nullptr);
+    }
+    m_inFlight.clear();
+
+    for (auto fence : m_freeFences)
+    {
+        vkDestroyFence(m_device, fence, nullptr);
+    }
+    m_freeFences.clear();
+
+    destroyBuffer(m_device, m_allocator, m_buffer, &m_bufferMemory);
+    m_buffer = 0;
+}
+
+StagingRegion StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+    VkDeviceSize offset = 0;
+    while (!tryAllocate(size, alignment, &offset))
+    {
+        // No room: the only way to get some is to wait for the GPU to finish reading the oldest regions
+        if (m_inFlight.empty())
+        {
+            throw std::runtime_error("Staging Ring is full! Release pending regions or stage smaller chunks.");
+        }
+        retireOldest();
+    }
+
+    StagingRegion region = {};
+    region.buffer = m_buffer;
+    region.offset = offset;
+    region.size = size;
+    region.data = static_cast<char *>(m_bufferMemory.mappedData) + offset;
+
+    return region;
+}
+
+VkFence StagingRing::release(uint64_t * serial)
+{
+    // Pick up any fence already signalled, so the pool of fences stays small
+    reclaim();
+
+    VkFence fence;
+    if (!m_freeFences.empty())
+    {
+        fence = m_freeFences.back();
+        m_freeFences.pop_back();
+        vkResetFences(m_device, 1, &fence);
+    }
+    else
+    {
+        VkFenceCreateInfo fenceCreateInfo = {};
+        fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        if (vkCreateFence(m_device, &fenceCreateInfo, nullptr, &fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create a Staging Ring Fence!");
+        }
+    }
+
+    InFlightRelease release = {};
+    release.fence = fence;
+    release.serial = m_nextSerial++;
+    release.end = m_head;
+    release.bytes = m_pendingBytes;
+    m_inFlight.push_back(release);
+
+    m_pendingBytes = 0;
+
+    if (serial != nullptr)
+    {
+        *serial = release.serial;
+    }
+
+    return fence;
+}
+
+void StagingRing::reclaim()
+{
+    while (!m_inFlight.empty() && vkGetFenceStatus(m_device, m_inFlight.front().fence) == VK_SUCCESS)
+    {
+        retireOldest();
+    }
+}
+
+bool StagingRing::isComplete(uint64_t serial)
+{
+    reclaim();
+    return m_completedSerial >= serial;
+}
+
+void StagingRing::wait(uint64_t serial)
+{
+    while (m_completedSerial < serial && !m_inFlight.empty())
+    {
+        retireOldest();
+    }
+}
+
+VkBuffer StagingRing::getBuffer() const
+{
+    return m_buffer;
+}
+
+VkDeviceSize StagingRing::getSize() const
+{
+    return m_size;
+}
+
+uint64_t StagingRing::getNextSerial() const
+{
+    return m_nextSerial;
+}
+
+VkDeviceSize StagingRing::getPendingBytes() const
+{
+    return m_pendingBytes;
+}
+
+VkDeviceSize StagingRing::getMaxAllocationSize() const
+{
+    // Half of the ring, so the CPU can fill a chunk while the previous one is still being copied
+    return m_size / 2;
+}
+
+StagingRing::~StagingRing()
+{
+}
+
+
+// Private methods
+bool StagingRing::tryAllocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize * offset)
+{
+    // Empty ring: restart from the beginning to get the biggest contiguous space
+    if (m_usedBytes == 0)
+    {
+        m_head = 0;
+        m_tail = 0;
+    }
+
+    VkDeviceSize alignedHead = ((m_head + alignment - 1) / alignment) * alignment;
+    VkDeviceSize consumed = 0;
+
+    if (m_usedBytes == m_size)
+    {
+        return false;                                               // Full
+    }
+    else if (m_head >= m_tail)
+    {
+        // Free space is [head, size) + [0, tail)
+        if (alignedHead + size <= m_size)
+        {
+            *offset = alignedHead;
+            consumed = (alignedHead - m_head) + size;
+        }
+        else if (size <= m_tail)
+        {
+            *offset = 0;                                            // Wrap around, the end of the ring is wasted until retired
+            consumed = (m_size - m_head) + size;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    else
+    {
+        // Free space is [head, tail)
+        if (alignedHead + size <= m_tail)
+        {
+            *offset = alignedHead;
+            consumed = (alignedHead - m_head) + size;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    m_head = *offset + size;
+    m_usedBytes += consumed;
+    m_pendingBytes += consumed;
+
+    return true;
+}
+
+void StagingRing::retireOldest()
+{
+    InFlightRelease &release = m_inFlight.front();
+    vkWaitForFences(m_device, 1, &release.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+
+    m_tail = release.end;
+    m_usedBytes -= release.bytes;
+    m_completedSerial = release.serial;
+    m_freeFences.push_back(release.fence);
+
+    m_inFlight.pop_front();
+}
+
+#pragma warning( pop )
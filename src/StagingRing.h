@@ -0,0 +1,86 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+// C++ STL
+#include <deque>
+#include <vector>
+
+// Project includes
+#include "DeviceMemoryAllocator.h"
+
+// Disable warning about Vulkan unscoped enums for this entire file
+#pragma warning( push )
+#pragma warning(disable : 26812) // The enum type * is unscoped. Prefer 'enum class' over 'enum'.
+
+// A piece of the staging ring the CPU can write into
+struct StagingRegion {
+    VkBuffer        buffer = 0;         // The ring buffer itself (source of the transfer)
+    VkDeviceSize    offset = 0;         // Offset of the region inside the ring buffer
+    VkDeviceSize    size = 0;
+    void *          data = nullptr;     // Persistently mapped pointer to the region
+};
+
+// Persistently mapped, host visible buffer used as a ring to stage uploads to device local memory.
+// Regions are handed out in order; release() gives back a fence which must be signalled by the submission
+// reading those regions, and the ring reuses them as soon as that fence is signalled.
+class StagingRing
+{
+public:
+    static const VkDeviceSize DEFAULT_SIZE = 32ULL * 1024 * 1024;  // 32 MiB
+
+    StagingRing();
+
+    void            init(VkDevice device, DeviceMemoryAllocator * allocator, VkDeviceSize size = DEFAULT_SIZE);
+    void            destroy();
+
+    // Waits for in-flight regions to be retired if the ring is full. 'size' must not exceed getMaxAllocationSize()
+    StagingRegion   allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+    // Closes the regions allocated so far: returns the fence to submit with and (optionally) a serial to wait/poll on
+    VkFence         release(uint64_t * serial = nullptr);
+
+    // Retire released regions whose fences are signalled (never blocks)
+    void            reclaim();
+    bool            isComplete(uint64_t serial);
+    void            wait(uint64_t serial);
+
+    VkBuffer        getBuffer() const;
+    VkDeviceSize    getSize() const;
+    uint64_t        getNextSerial() const;          // Serial the next release() will get
+    VkDeviceSize    getPendingBytes() const;        // Bytes allocated since the last release()
+    VkDeviceSize    getMaxAllocationSize() const;
+
+    ~StagingRing();
+
+private:
+    struct InFlightRelease {
+        VkFence         fence = 0;
+        uint64_t        serial = 0;
+        VkDeviceSize    end = 0;        // Ring position right after the last region of the release
+        VkDeviceSize    bytes = 0;      // Bytes consumed by the release (regions + alignment padding + wrap-around waste)
+    };
+
+    VkDevice                    m_device = nullptr;
+    DeviceMemoryAllocator *     m_allocator = nullptr;
+
+    VkBuffer                    m_buffer = 0;
+    MemoryAllocation            m_bufferMemory;
+    VkDeviceSize                m_size = 0;
+
+    VkDeviceSize                m_head = 0;             // Next write position
+    VkDeviceSize                m_tail = 0;             // Start of the oldest region still in use
+    VkDeviceSize                m_usedBytes = 0;        // Bytes between tail and head (both released and pending)
+    VkDeviceSize                m_pendingBytes = 0;     // Bytes allocated since the last release()
+
+    uint64_t                    m_nextSerial = 1;
+    uint64_t                    m_completedSerial = 0;
+    std::deque<InFlightRelease> m_inFlight;             // Ordered by serial
+    std::vector<VkFence>        m_freeFences;           // Signalled fences ready to be reset and reused
+
+    // Methods
+    bool            tryAllocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize * offset);
+    void            retireOldest();
+};
+
+#pragma warning( pop )
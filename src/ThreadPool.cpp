@@ -0,0 +1,156 @@
+#include "ThreadPool.h"
+
+// C++ STL
+#include <algorithm>
+
+//------------------------------------------------------------------------------
+ThreadPool::ThreadPool()
+{
+}
+//------------------------------------------------------------------------------
+void ThreadPool::init(uint32_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        // hardware_concurrency() may be 0 when unknown
+        threadCount = std::max(1U, std::thread::hardware_concurrency()) - 1;
+        threadCount = std::max(1U, threadCount);
+    }
+
+    m_stopping = false;
+    m_threads.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        m_threads.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+//------------------------------------------------------------------------------
+void ThreadPool::destroy()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_taskAvailable.notify_all();
+
+    for (auto &thread : m_threads)
+    {
+        thread.join();
+    }
+    m_threads.clear();
+}
+//------------------------------------------------------------------------------
+void ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_taskAvailable.notify_one();
+}
+//------------------------------------------------------------------------------
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_tasksDone.wait(lock, [this]() { return m_tasks.empty() && m_runningTasks == 0; });
+}
+//------------------------------------------------------------------------------
+void ThreadPool::parallelFor(uint32_t count, const std::function<void(uint32_t begin, uint32_t end)> &function)
+{
+    uint32_t rangeCount = std::min(count, getThreadCount() + 1);
+    if (rangeCount <= 1)
+    {
+        if (count > 0)
+        {
+            function(0, count);
+        }
+        return;
+    }
+
+    // Completion of this call only (other tasks of the pool may be running, e.g. streaming)
+    std::mutex rangeMutex;
+    std::condition_variable rangesDone;
+    uint32_t remainingRanges = rangeCount - 1;
+    std::exception_ptr firstException;
+
+    auto runRange = [&](uint32_t begin, uint32_t end) {
+        try
+        {
+            function(begin, end);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(rangeMutex);
+            if (!firstException)
+            {
+                firstException = std::current_exception();
+            }
+        }
+    };
+
+    for (uint32_t range = 1; range < rangeCount; range++)
+    {
+        uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(count) * range / rangeCount);
+        uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(count) * (range + 1) / rangeCount);
+        submit([&, begin, end]() {
+            runRange(begin, end);
+
+            // Notified under the lock: the waiting caller can't return (and destroy these) before it's released
+            std::lock_guard<std::mutex> lock(rangeMutex);
+            remainingRanges--;
+            rangesDone.notify_one();
+        });
+    }
+
+    runRange(0, static_cast<uint32_t>(count / rangeCount));
+
+    std::unique_lock<std::mutex> lock(rangeMutex);
+    rangesDone.wait(lock, [&]() { return remainingRanges == 0; });
+
+    if (firstException)
+    {
+        std::rethrow_exception(firstException);
+    }
+}
+//------------------------------------------------------------------------------
+uint32_t ThreadPool::getThreadCount() const
+{
+    return static_cast<uint32_t>(m_threads.size());
+}
+//------------------------------------------------------------------------------
+ThreadPool::~ThreadPool()
+{
+    if (!m_threads.empty())
+    {
+        destroy();
+    }
+}
+//------------------------------------------------------------------------------
+void ThreadPool::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_taskAvailable.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+        // Stopping: the queued tasks still run (their submitters may be waiting for them)
+        if (m_tasks.empty())
+        {
+            return;
+        }
+
+        std::function<void()> task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+        m_runningTasks++;
+
+        lock.unlock();
+        task();
+        lock.lock();
+
+        m_runningTasks--;
+        if (m_tasks.empty() && m_runningTasks == 0)
+        {
+            m_tasksDone.notify_all();
+        }
+    }
+}
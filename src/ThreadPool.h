@@ -0,0 +1,53 @@
+#pragma once
+
+// C++ STL
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running the tasks submitted to it, in submission order (tasks must not share
+// Vulkan queues or command pools with other threads: they are externally synchronized).
+class ThreadPool
+{
+public:
+    ThreadPool();
+
+    // 0: one thread per hardware thread but the calling one (at least 1)
+    void        init(uint32_t threadCount = 0);
+    // Runs the tasks already submitted, then joins the threads
+    void        destroy();
+
+    void        submit(std::function<void()> task);
+    // Blocks until every task submitted so far has run
+    void        wait();
+
+    // Calls function(begin, end) on contiguous ranges covering [0, count), one per thread plus one run by the calling
+    // thread, and returns when all of them are done. The first exception thrown by a range is rethrown here.
+    // (N.B.: not from a task of this pool: the calling thread would hold a worker while waiting for the others)
+    void        parallelFor(uint32_t count, const std::function<void(uint32_t begin, uint32_t end)> &function);
+
+    uint32_t    getThreadCount() const;
+
+    ~ThreadPool();
+
+private:
+    std::vector<std::thread>            m_threads;
+    std::deque<std::function<void()>>   m_tasks;
+    std::mutex                          m_mutex;
+    std::condition_variable             m_taskAvailable;    // Signalled on submit() and on destroy()
+    std::condition_variable             m_tasksDone;        // Signalled when the last running task ends with none queued
+    uint32_t                            m_runningTasks = 0;
+    bool                                m_stopping = false;
+
+    // Methods
+    void        workerLoop();
+
+    // prevent copying (the threads point to this object)
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+};
@@ -0,0 +1,169 @@
+#include "TransformHierarchy.h"
+
+// C++ STL
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+//------------------------------------------------------------------------------
+TransformHierarchy::TransformHierarchy()
+{
+}
+//------------------------------------------------------------------------------
+uint32_t TransformHierarchy::addNode(uint32_t parentNode, const glm::mat4 &local, int32_t objectIndex)
+{
+    if (parentNode != NO_PARENT && parentNode >= m_nodeIndex.size())
+    {
+        throw std::runtime_error("Invalid parent transform node!");
+    }
+    if (objectIndex >= 0 && static_cast<size_t>(objectIndex) < m_objectBound.size() && m_objectBound[objectIndex] != 0)
+    {
+        throw std::runtime_error("Object already bound to a transform node!");
+    }
+
+    uint32_t depth = (parentNode == NO_PARENT) ? 0 : m_nodeDepth[parentNode] + 1;
+    if (m_levelStart.empty())
+    {
+        m_levelStart.push_back(0);
+    }
+    while (m_levelStart.size() < depth + 2)
+    {
+        m_levelStart.push_back(m_levelStart.back());
+    }
+
+    // At the end of its level: the nodes of the deeper levels move one slot up
+    uint32_t index = m_levelStart[depth + 1];
+    for (auto &parent : m_parent)
+    {
+        if (parent != NO_PARENT && parent >= index)
+        {
+            parent++;
+        }
+    }
+    for (auto &nodeIndex : m_nodeIndex)
+    {
+        if (nodeIndex >= index)
+        {
+            nodeIndex++;
+        }
+    }
+    for (size_t level = depth + 1; level < m_levelStart.size(); level++)
+    {
+        m_levelStart[level]++;
+    }
+
+    // The parent is on the level above: before 'index', it hasn't moved
+    uint32_t parentIndex = NO_PARENT;
+    if (parentNode != NO_PARENT)
+    {
+        parentIndex = m_nodeIndex[parentNode];
+    }
+    m_local.insert(m_local.begin() + index, local);
+    m_world.insert(m_world.begin() + index, local);
+    m_parent.insert(m_parent.begin() + index, parentIndex);
+    m_objectIndex.insert(m_objectIndex.begin() + index, objectIndex);
+    m_dirty.insert(m_dirty.begin() + index, 1);
+    m_anyDirty = true;
+
+    m_nodeIndex.push_back(index);
+    m_nodeDepth.push_back(depth);
+    if (objectIndex >= 0)
+    {
+        m_objectBound.resize(std::max(m_objectBound.size(), static_cast<size_t>(objectIndex) + 1), 0);
+        m_objectBound[objectIndex] = 1;
+    }
+    return static_cast<uint32_t>(m_nodeIndex.size()) - 1;
+}
+//------------------------------------------------------------------------------
+void TransformHierarchy::setLocal(uint32_t node, const glm::mat4 &local)
+{
+    uint32_t index = m_nodeIndex[node];
+    if (m_local[index] == local)
+    {
+        return;
+    }
+
+    m_local[index] = local;
+    m_dirty[index] = 1;
+    m_anyDirty = true;
+}
+//------------------------------------------------------------------------------
+const glm::mat4 & TransformHierarchy::getWorld(uint32_t node) const
+{
+    return m_world[m_nodeIndex[node]];
+}
+//------------------------------------------------------------------------------
+uint32_t TransformHierarchy::getNodeCount() const
+{
+    return static_cast<uint32_t>(m_nodeIndex.size());
+}
+//------------------------------------------------------------------------------
+void TransformHierarchy::clear()
+{
+    m_local.clear();
+    m_world.clear();
+    m_parent.clear();
+    m_objectIndex.clear();
+    m_dirty.clear();
+    m_levelStart.clear();
+    m_nodeIndex.clear();
+    m_nodeDepth.clear();
+    m_objectBound.clear();
+    m_anyDirty = false;
+}
+//------------------------------------------------------------------------------
+uint32_t TransformHierarchy::update(ThreadPool * threadPool, const std::function<void(int32_t objectIndex, const glm::mat4 &world)> &writeObject)
+{
+    if (!m_anyDirty)
+    {
+        return 0;
+    }
+
+    std::atomic<uint32_t> writtenObjects(0);
+    for (size_t level = 0; level + 1 < m_levelStart.size(); level++)
+    {
+        uint32_t levelStart = m_levelStart[level];
+        uint32_t levelCount = m_levelStart[level + 1] - levelStart;
+
+        // The parents are on the level above, already final: a node only reads them and writes itself
+        auto updateRange = [&](uint32_t begin, uint32_t end) {
+            uint32_t rangeObjects = 0;
+            for (uint32_t i = levelStart + begin; i < levelStart + end; i++)
+            {
+                uint32_t parent = m_parent[i];
+                bool parentDirty = (parent != NO_PARENT && m_dirty[parent] != 0);
+                if (m_dirty[i] == 0 && !parentDirty)
+                {
+                    continue;
+                }
+
+                m_dirty[i] = 1;     // Its children are recomputed too
+                m_world[i] = (parent == NO_PARENT) ? m_local[i] : m_world[parent] * m_local[i];
+                if (m_objectIndex[i] >= 0)
+                {
+                    writeObject(m_objectIndex[i], m_world[i]);
+                    rangeObjects++;
+                }
+            }
+            writtenObjects += rangeObjects;
+        };
+
+        if (threadPool != nullptr && levelCount >= PARALLEL_MIN_NODES)
+        {
+            threadPool->parallelFor(levelCount, updateRange);
+        }
+        else
+        {
+            updateRange(0, levelCount);
+        }
+    }
+
+    std::fill(m_dirty.begin(), m_dirty.end(), static_cast<uint8_t>(0));
+    m_anyDirty = false;
+
+    return writtenObjects;
+}
+//------------------------------------------------------------------------------
+TransformHierarchy::~TransformHierarchy()
+{
+}
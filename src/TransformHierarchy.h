@@ -0,0 +1,57 @@
+#pragma once
+
+// C++ STL
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Project includes
+#include "ThreadPool.h"
+#include "Utilities.h"
+
+// Parent/child hierarchy of transforms: world = parent world * local. The nodes are stored as a structure of arrays
+// sorted by depth (every parent before its children), so that update() walks contiguous memory one depth level after
+// the other and the nodes of a level, which only read the level above, are computed in parallel.
+// Only the dirty nodes (setLocal()) and their descendants are recomputed.
+class TransformHierarchy
+{
+public:
+    static const uint32_t NO_PARENT = UINT32_MAX;
+    static const uint32_t PARALLEL_MIN_NODES = 1024;    // Smaller levels are computed by the calling thread only
+
+    TransformHierarchy();
+
+    // Returns the id of the new node (its storage index changes as nodes are added, its id doesn't).
+    // 'objectIndex' >= 0: the world matrix of the node is written to that object by update(); an object is bound to
+    // one node at most (two nodes writing it from different threads would race): throws if it is already bound
+    // (N.B.: nodes are inserted in the middle of the arrays: meant for loading, not for every frame)
+    uint32_t    addNode(uint32_t parentNode, const glm::mat4 &local, int32_t objectIndex = -1);
+    void        setLocal(uint32_t node, const glm::mat4 &local);    // Same matrix: the node stays clean
+    const glm::mat4 & getWorld(uint32_t node) const;                // As of the last update()
+    uint32_t    getNodeCount() const;
+    void        clear();
+
+    // Recomputes the dirty nodes and their descendants, level by level (across the ThreadPool for the large ones; null:
+    // calling thread only). writeObject(objectIndex, world) is called for each of them with an object, from any thread
+    // (never twice for the same node). Returns the count of these calls
+    uint32_t    update(ThreadPool * threadPool, const std::function<void(int32_t objectIndex, const glm::mat4 &world)> &writeObject);
+
+    ~TransformHierarchy();
+
+private:
+    // Indexed by storage index (sorted by depth)
+    std::vector<glm::mat4>  m_local;
+    std::vector<glm::mat4>  m_world;
+    std::vector<uint32_t>   m_parent;           // Storage index of the parent, NO_PARENT for a root
+    std::vector<int32_t>    m_objectIndex;      // -1: no object
+    std::vector<uint8_t>    m_dirty;            // Bytes, not std::vector<bool>: the ranges of a level write them concurrently
+    std::vector<uint32_t>   m_levelStart;       // Nodes of depth d: [m_levelStart[d], m_levelStart[d + 1])
+
+    // Indexed by node id
+    std::vector<uint32_t>   m_nodeIndex;        // Storage index of every node
+    std::vector<uint32_t>   m_nodeDepth;
+
+    std::vector<uint8_t>    m_objectBound;      // Indexed by object index: 1 if a node writes it
+
+    bool                    m_anyDirty = false;
+};
@@ -0,0 +1,359 @@
+#include "UploadBatcher.h"
+
+// C++ STL
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+// Disable warning about Vulkan unscoped enums for this entire file
+#pragma warning( push )
+#pragma warning(disable : 26812) // The enum type * is unscoped. Prefer 'enum class' over 'enum'.
+
+UploadBatcher::UploadBatcher()
+{
+}
+
+void UploadBatcher::init(  VkDevice device, StagingRing * stagingRing,
+                            VkQueue transferQueue, uint32_t transferFamily, VkCommandPool transferCommandPool,
+                            VkQueue graphicsQueue, uint32_t graphicsFamily, VkCommandPool graphicsCommandPool)
+{
+    m_device = device;
+    m_stagingRing = stagingRing;
+
+    // N.B.: transferCommandPool must allow resetting single command buffers (they're recycled once their batch completes)
+    m_transferQueue = transferQueue;
+    m_transferFamily = transferFamily;
+    m_transferCommandPool = transferCommandPool;
+
+    m_graphicsQueue = graphicsQueue;
+    m_graphicsFamily = graphicsFamily;
+    m_graphicsCommandPool = graphicsCommandPool;
+}
+
+void UploadBatcher::destroy()
+{
+    // N.B.: the device must be idle. Command buffers are freed along with their pools (owned by the caller)
+    for (auto &batch : m_inFlight)
+    {
+        if (batch.semaphore != 0)
+        {
+            vkDestroySemaphore(m_device, batch.semaphore, nullptr);
+        }
+    }
+    for (auto semaphore : m_freeSemaphores)
+    {
+        vkDestroySemaphore(m_device, semaphore, nullptr);
+    }
+
+    m_commandBuffer = nullptr;
+    m_batchBarriers.clear();
+    m_inFlight.clear();
+    m_freeCommandBuffers.clear();
+    m_freeSemaphores.clear();
+}
+
+uint64_t UploadBatcher::upload(const void * data, VkDeviceSize dataSize, VkBuffer dstBuffer, VkDeviceSize dstOffset)
+{
+    // Big uploads are staged in chunks, since the ring is much smaller than a big buffer may be
+    VkDeviceSize chunkSize = m_stagingRing->getMaxAllocationSize();
+
+    for (VkDeviceSize copied = 0; copied < dataSize; copied += chunkSize)
+    {
+        VkDeviceSize size = std::min(chunkSize, dataSize - copied);
+
+        // Keep a batch within half of the ring, so the next chunk can always find room once older batches retire
+        if (m_commandBuffer != nullptr && m_stagingRing->getPendingBytes() + size > m_stagingRing->getMaxAllocationSize())
+        {
+            flush();
+        }
+        if (m_commandBuffer == nullptr)
+        {
+            beginBatch();
+        }
+
+        // Region of the persistently mapped ring (no buffer creation, no map/unmap)
+        StagingRegion region = m_stagingRing->allocate(size);
+        memcpy(region.data, static_cast<const char *>(data) + copied, (size_t)size);
+
+        // Region of data to copy from and to
+        VkBufferCopy bufferCopyRegion = {};
+        bufferCopyRegion.srcOffset = region.offset;
+        bufferCopyRegion.dstOffset = dstOffset + copied;
+        bufferCopyRegion.size = size;
+
+        vkCmdCopyBuffer(m_commandBuffer, region.buffer, dstBuffer, 1, &bufferCopyRegion);
+
+        if (usesOwnershipTransfer())
+        {
+            addBatchRange(dstBuffer, bufferCopyRegion.dstOffset, size);
+        }
+    }
+
+    return getCurrentTicket();
+}
+
+uint64_t UploadBatcher::flush()
+{
+    // Nothing recorded: the last submitted batch is the one to wait for
+    if (m_commandBuffer == nullptr)
+    {
+        return m_lastSubmittedTicket;
+    }
+
+    // The ring fence tells both the ring (staging regions can be reused) and us (batch completed)
+    uint64_t ticket = 0;
+    VkFence fence = m_stagingRing->release(&ticket);
+
+    InFlightBatch batch = {};
+    batch.ticket = ticket;
+    batch.commandBuffer = m_commandBuffer;
+
+    if (usesOwnershipTransfer())
+    {
+        submitWithOwnershipTransfer(batch, fence);
+    }
+    else
+    {
+        // Make the copies visible to vertex input of any later submission on this queue
+        // (execution dependencies of a barrier extend to commands submitted afterwards)
+        VkMemoryBarrier memoryBarrier = {};
+        memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        memoryBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+
+        vkCmdPipelineBarrier(m_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0,
+            1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+        vkEndCommandBuffer(m_commandBuffer);
+
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &m_commandBuffer;
+
+        // Submit and DON'T wait: callers poll/wait on the ticket when (and if) they need to
+        VkResult result = vkQueueSubmit(m_transferQueue, 1, &submitInfo, fence);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to submit an Upload Batch!");
+        }
+    }
+
+    m_inFlight.push_back(batch);
+
+    m_commandBuffer = nullptr;
+    m_lastSubmittedTicket = ticket;
+
+    return ticket;
+}
+
+bool UploadBatcher::isComplete(uint64_t ticket)
+{
+    // A batch still being recorded can't be complete
+    if (ticket > m_lastSubmittedTicket)
+    {
+        return false;
+    }
+    return m_stagingRing->isComplete(ticket);
+}
+
+void UploadBatcher::wait(uint64_t ticket)
+{
+    if (ticket > m_lastSubmittedTicket)
+    {
+        flush();
+    }
+    m_stagingRing->wait(ticket);
+}
+
+uint64_t UploadBatcher::getCurrentTicket() const
+{
+    // The batch being recorded will get the serial of the next ring release
+    return m_stagingRing->getNextSerial();
+}
+
+bool UploadBatcher::usesOwnershipTransfer() const
+{
+    return m_transferFamily != m_graphicsFamily;
+}
+
+UploadBatcher::~UploadBatcher()
+{
+}
+
+
+// Private methods
+void UploadBatcher::beginBatch()
+{
+    recycleCommandBuffers();
+
+    if (!m_freeCommandBuffers.empty())
+    {
+        m_commandBuffer = m_freeCommandBuffers.back();
+        m_freeCommandBuffers.pop_back();
+    }
+    else
+    {
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = m_transferCommandPool;
+        allocInfo.commandBufferCount = 1;
+
+        VkResult result = vkAllocateCommandBuffers(m_device, &allocInfo, &m_commandBuffer);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to allocate an Upload Command Buffer!");
+        }
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;    // Every batch is recorded from scratch
+
+    vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
+}
+
+void UploadBatcher::addBatchRange(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size)
+{
+    // Chunks of the same upload are contiguous: extend the previous range instead of adding a barrier per chunk
+    if (!m_batchBarriers.empty())
+    {
+        VkBufferMemoryBarrier &last = m_batchBarriers.back();
+        if (last.buffer == buffer && last.offset + last.size == offset)
+        {
+            last.size += size;
+            return;
+        }
+    }
+
+    VkBufferMemoryBarrier bufferBarrier = {};
+    bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferBarrier.srcQueueFamilyIndex = m_transferFamily;   // Ownership goes from the transfer family...
+    bufferBarrier.dstQueueFamilyIndex = m_graphicsFamily;   // ...to the graphics family
+    bufferBarrier.buffer = buffer;
+    bufferBarrier.offset = offset;
+    bufferBarrier.size = size;
+
+    m_batchBarriers.push_back(bufferBarrier);
+}
+
+void UploadBatcher::submitWithOwnershipTransfer(InFlightBatch &batch, VkFence fence)
+{
+    // -- RELEASE (transfer queue) --
+    // Access masks on the destination side of a release are ignored: only the transfer writes need to be made available
+    for (auto &bufferBarrier : m_batchBarriers)
+    {
+        bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        bufferBarrier.dstAccessMask = 0;
+    }
+    vkCmdPipelineBarrier(m_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+        0, nullptr, static_cast<uint32_t>(m_batchBarriers.size()), m_batchBarriers.data(), 0, nullptr);
+
+    vkEndCommandBuffer(m_commandBuffer);
+
+    // Semaphore from the previous batches, or a new one
+    if (!m_freeSemaphores.empty())
+    {
+        batch.semaphore = m_freeSemaphores.back();
+        m_freeSemaphores.pop_back();
+    }
+    else
+    {
+        VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+        semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        if (vkCreateSemaphore(m_device, &semaphoreCreateInfo, nullptr, &batch.semaphore) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create an Upload Semaphore!");
+        }
+    }
+
+    VkSubmitInfo transferSubmitInfo = {};
+    transferSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    transferSubmitInfo.commandBufferCount = 1;
+    transferSubmitInfo.pCommandBuffers = &batch.commandBuffer;
+    transferSubmitInfo.signalSemaphoreCount = 1;
+    transferSubmitInfo.pSignalSemaphores = &batch.semaphore;
+
+    VkResult result = vkQueueSubmit(m_transferQueue, 1, &transferSubmitInfo, VK_NULL_HANDLE);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit an Upload Batch!");
+    }
+
+    // -- ACQUIRE (graphics queue) --
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = m_graphicsCommandPool;
+    allocInfo.commandBufferCount = 1;
+
+    result = vkAllocateCommandBuffers(m_device, &allocInfo, &batch.acquireCommandBuffer);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate an Upload Acquire Command Buffer!");
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(batch.acquireCommandBuffer, &beginInfo);
+
+    // Same ranges and families as the release, access masks on the source side are ignored this time
+    for (auto &bufferBarrier : m_batchBarriers)
+    {
+        bufferBarrier.srcAccessMask = 0;
+        bufferBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+    }
+    vkCmdPipelineBarrier(batch.acquireCommandBuffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0,
+        0, nullptr, static_cast<uint32_t>(m_batchBarriers.size()), m_batchBarriers.data(), 0, nullptr);
+
+    vkEndCommandBuffer(batch.acquireCommandBuffer);
+
+    // Only the vertex input of this (tiny) submission waits for the copies: frames already submitted,
+    // or drawing other meshes, keep running alongside the transfer queue
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+
+    VkSubmitInfo acquireSubmitInfo = {};
+    acquireSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    acquireSubmitInfo.waitSemaphoreCount = 1;
+    acquireSubmitInfo.pWaitSemaphores = &batch.semaphore;
+    acquireSubmitInfo.pWaitDstStageMask = &waitStage;
+    acquireSubmitInfo.commandBufferCount = 1;
+    acquireSubmitInfo.pCommandBuffers = &batch.acquireCommandBuffer;
+
+    // The ring fence is signalled by the acquire: once it is, both command buffers and the semaphore can be reused
+    result = vkQueueSubmit(m_graphicsQueue, 1, &acquireSubmitInfo, fence);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit an Upload Acquire!");
+    }
+
+    m_batchBarriers.clear();
+}
+
+void UploadBatcher::recycleCommandBuffers()
+{
+    while (!m_inFlight.empty() && m_stagingRing->isComplete(m_inFlight.front().ticket))
+    {
+        InFlightBatch &batch = m_inFlight.front();
+
+        vkResetCommandBuffer(batch.commandBuffer, 0);
+        m_freeCommandBuffers.push_back(batch.commandBuffer);
+
+        if (batch.acquireCommandBuffer != nullptr)
+        {
+            vkFreeCommandBuffers(m_device, m_graphicsCommandPool, 1, &batch.acquireCommandBuffer);
+        }
+        if (batch.semaphore != 0)
+        {
+            m_freeSemaphores.push_back(batch.semaphore);
+        }
+
+        m_inFlight.pop_front();
+    }
+}
+
+#pragma warning( pop )
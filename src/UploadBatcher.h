@@ -0,0 +1,78 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+// C++ STL
+#include <deque>
+#include <vector>
+
+// Project includes
+#include "StagingRing.h"
+
+// Disable warning about Vulkan unscoped enums for this entire file
+#pragma warning( push )
+#pragma warning(disable : 26812) // The enum type * is unscoped. Prefer 'enum class' over 'enum'.
+
+// Records many buffer uploads (staged in the StagingRing) into a single command buffer and submits them
+// together, without waiting: every batch is identified by a ticket (the serial of the ring release it signals)
+// that callers can poll with isComplete() or block on with wait().
+// When the transfer queue belongs to a family other than the graphics one, the written buffer ranges are
+// released by the transfer queue and acquired by the graphics queue (queue family ownership transfer).
+class UploadBatcher
+{
+public:
+    UploadBatcher();
+
+    void        init(   VkDevice device, StagingRing * stagingRing,
+                        VkQueue transferQueue, uint32_t transferFamily, VkCommandPool transferCommandPool,
+                        VkQueue graphicsQueue, uint32_t graphicsFamily, VkCommandPool graphicsCommandPool);
+    void        destroy();
+
+    // Stages 'data' and records its copy to dstBuffer. Returns the ticket of the batch the copy belongs to
+    uint64_t    upload(const void * data, VkDeviceSize dataSize, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+    // Submits the copies recorded so far (never blocks). Returns the ticket of the submitted batch
+    uint64_t    flush();
+
+    bool        isComplete(uint64_t ticket);
+    void        wait(uint64_t ticket);
+
+    uint64_t    getCurrentTicket() const;       // Ticket of the batch being recorded
+    bool        usesOwnershipTransfer() const;  // True if uploads run on a dedicated transfer queue family
+
+    ~UploadBatcher();
+
+private:
+    struct InFlightBatch {
+        uint64_t        ticket = 0;
+        VkCommandBuffer commandBuffer = nullptr;            // Copies (+ release barriers), transfer queue
+        VkCommandBuffer acquireCommandBuffer = nullptr;     // Acquire barriers, graphics queue (ownership transfer only)
+        VkSemaphore     semaphore = 0;                      // Signalled by the copies, waited by the acquire (ownership transfer only)
+    };
+
+    VkDevice                    m_device = nullptr;
+    StagingRing *               m_stagingRing = nullptr;
+
+    VkQueue                     m_transferQueue = nullptr;
+    uint32_t                    m_transferFamily = 0;
+    VkCommandPool               m_transferCommandPool = 0;
+    VkQueue                     m_graphicsQueue = nullptr;
+    uint32_t                    m_graphicsFamily = 0;
+    VkCommandPool               m_graphicsCommandPool = 0;
+
+    VkCommandBuffer             m_commandBuffer = nullptr;  // Batch being recorded (nullptr if none)
+    std::vector<VkBufferMemoryBarrier> m_batchBarriers;     // Buffer ranges written by the batch (ownership transfer only)
+    uint64_t                    m_lastSubmittedTicket = 0;
+
+    std::deque<InFlightBatch>   m_inFlight;
+    std::vector<VkCommandBuffer> m_freeCommandBuffers;
+    std::vector<VkSemaphore>    m_freeSemaphores;
+
+    // Methods
+    void        beginBatch();
+    void        addBatchRange(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size);
+    void        submitWithOwnershipTransfer(InFlightBatch &batch, VkFence fence);
+    void        recycleCommandBuffers();
+};
+
+#pragma warning( pop )
@@ -31,9 +31,19 @@
 // GLM
 #include <glm/glm.hpp>
 
+// Project includes
+#include "DeviceMemoryAllocator.h"
+
 // App constants
 const int MAX_FRAME_DRAWS = 3;
 // MAX_FRAME_DRAWS should be less (or equal at max) to swapchain images
+const int MAX_OBJECTS = 16384;  // Max number of objects with their own Model matrix (size of the dynamic uniform buffers)
+const int MAX_CLUSTERS = 65536; // Max number of meshlets culled on the GPU (cluster culling: one draw command each)
+// The indirect buffers hold MAX_CLUSTERS VkDrawIndexedIndirectCommand (one per object, or one per cluster with cluster culling)
+// followed by the draw count (vkCmdDrawIndexedIndirectCount)
+const VkDeviceSize DRAW_COUNT_OFFSET = MAX_CLUSTERS * sizeof(VkDrawIndexedIndirectCommand);
+const int MAX_MESH_LODS = 4;    // Max levels of detail of a mesh (N.B.: the vec4/uvec4 of CullObject in cull.comp hold exactly 4)
+const uint32_t STREAMING_THREAD_COUNT = 2;  // Workers reading and decoding the streamed files (mostly waiting for I/O)
 
 ////////////////////////
 // Vulkan main Utilities
@@ -51,11 +61,18 @@ struct Vertex
     glm::vec3 col; // Vertex Colour (r, g, b)
 };
 
+// Per-instance vertex data of an instanced mesh (binding 1, VK_VERTEX_INPUT_RATE_INSTANCE)
+struct InstanceData
+{
+    glm::mat4 transform;    // Applied before the Model matrix of the mesh
+    glm::vec4 colour;       // Multiplies the vertex colour (r, g, b, a)
+};
+
 // Indices (locations) of Queue Families (if they exist at all)
 struct QueueFamilyIndices {
     int graphicsFamily = -1;        // Location of Graphics Queue Family
     int presentationFamily = -1;    // Location of Presentation Queue Family
-    int transferFamily = -1;        // N.B.: Vulkan guarantees that graphicsFamily also supports Transfer Queues
+    int transferFamily = -1;        // Dedicated (DMA) Transfer Queue Family if any, graphicsFamily otherwise (Vulkan guarantees it supports Transfer too)
 
     // Check if queue families are valid
     bool isValid()
@@ -110,27 +127,8 @@ static std::vector<char> readFile(const std::string &filename)
     return fileBuffer;
 }
 
-static uint32_t findMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t allowedTypes, VkMemoryPropertyFlags properties)
-{
-    // Get properties of physical device memory
-    VkPhysicalDeviceMemoryProperties memoryProperties;
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
-
-    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
-    {
-        if (    (allowedTypes & (1 << i))                                                   // Index of memory type must match corresponding bit in allowedTypes
-            &&  (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) // Desired property bit flags are part of memory type's property flags
-        {
-            // This memory type is valid, so return its index
-            return i;
-        }
-    }
-
-    return std::numeric_limits<uint32_t>::max();
-}
-
-static void createBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsage,
-    VkMemoryPropertyFlags bufferProperties, VkBuffer * buffer, VkDeviceMemory * bufferMemory)
+static void createBuffer(VkDevice device, DeviceMemoryAllocator * allocator, VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsage,
+    VkMemoryPropertyFlags bufferProperties, VkBuffer * buffer, MemoryAllocation * bufferMemory)
 {
     // CREATE BUFFER (VERTEX/INDEX)
     // Information to create a buffer (doesn't include assigning memory)
@@ -150,26 +148,26 @@ static void createBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDev
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(device, *buffer, &memRequirements);
 
-    // ALLOCATE MEMORY TO BUFFER
-    VkMemoryAllocateInfo memoryAllocInfo = {};
-    memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    memoryAllocInfo.allocationSize = memRequirements.size;
-    memoryAllocInfo.memoryTypeIndex = findMemoryTypeIndex(physicalDevice, memRequirements.memoryTypeBits,   // Index of memory type on Physical Device that has required bit flags
-        bufferProperties);                                                                                  // VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT  : CPU can interact with memory
-                                                                                                            // VK_MEMORY_PROPERTY_HOST_COHERENT_BIT : Allows placement of data straight into buffer after mapping (otherwise would have to specify manually)
-                                                                                                            // Allocate memory to VkDeviceMemory
-    result = vkAllocateMemory(device, &memoryAllocInfo, nullptr, bufferMemory);
-    if (result != VK_SUCCESS)
-    {
-        throw std::runtime_error("Failed to allocate Buffer Memory!");
-    }
+    // SUB-ALLOCATE MEMORY TO BUFFER
+    // The allocator picks the memory type on Physical Device that has required bit flags:
+    // VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT  : CPU can interact with memory
+    // VK_MEMORY_PROPERTY_HOST_COHERENT_BIT : Allows placement of data straight into buffer after mapping (otherwise would have to specify manually)
+    // and hands out a range of one of its big VkDeviceMemory blocks (aligned as memRequirements.alignment requires)
+    *bufferMemory = allocator->allocate(memRequirements, bufferProperties);
+
+    // Bind the range of memory to given buffer
+    vkBindBufferMemory(device, *buffer, bufferMemory->memory, bufferMemory->offset);
+}
 
-    // Allocate memory to given vertex buffer
-    vkBindBufferMemory(device, *buffer, *bufferMemory, 0);
+static void destroyBuffer(VkDevice device, DeviceMemoryAllocator * allocator, VkBuffer buffer, MemoryAllocation * bufferMemory)
+{
+    vkDestroyBuffer(device, buffer, nullptr);
+    allocator->free(*bufferMemory);
 }
 
 static void copyBuffer(VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool,
-    VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize bufferSize)
+    VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize bufferSize,
+    VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0, VkFence fence = VK_NULL_HANDLE)
 {
     // Command buffer to hold transfer commands
     VkCommandBuffer transferCommandBuffer;
@@ -194,8 +192,8 @@ static void copyBuffer(VkDevice device, VkQueue transferQueue, VkCommandPool tra
 
     // Region of data to copy from and to
     VkBufferCopy bufferCopyRegion = {};
-    bufferCopyRegion.srcOffset = 0;
-    bufferCopyRegion.dstOffset = 0;
+    bufferCopyRegion.srcOffset = srcOffset;
+    bufferCopyRegion.dstOffset = dstOffset;
     bufferCopyRegion.size = bufferSize;
 
     // Command to copy src buffer to dst buffer
@@ -210,8 +208,8 @@ static void copyBuffer(VkDevice device, VkQueue transferQueue, VkCommandPool tra
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &transferCommandBuffer;
 
-    // Submit transfer command to transfer queue and wait until it finishes
-    vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE);
+    // Submit transfer command to transfer queue (signalling the optional fence) and wait until it finishes
+    vkQueueSubmit(transferQueue, 1, &submitInfo, fence);
     vkQueueWaitIdle(transferQueue);
 
     // Free temporary command buffer back to pool
@@ -0,0 +1,147 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+// C++ STL
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// GLM
+#include <glm/glm.hpp>
+
+// Project includes
+#include "Utilities.h"
+
+// Disable warning about Vulkan unscoped enums for this entire file
+#pragma warning( push )
+#pragma warning(disable : 26812) // The enum type * is unscoped. Prefer 'enum class' over 'enum'.
+
+// Layout of the vertices stored in the GeometryPool (one for the whole renderer: it's baked in the graphics pipeline)
+enum class VertexFormat {
+    Float,              // Vertex: float position and colour (24 bytes)
+    Quantized           // QuantizedVertex: snorm16 position inside the mesh bounding box, RGBA8 unorm colour (12 bytes)
+};
+
+// Compact vertex: the position is relative to the bounding box of its mesh, mapped to [-1, 1]
+// (dequantized in shader.vert through UboModel::positionOffset/positionScale)
+struct QuantizedVertex
+{
+    int16_t pos[4];     // snorm16 (x, y, z, unused: R16G16B16A16_SNORM is a mandatory vertex format, the 3 components one is not)
+    uint8_t col[4];     // unorm8 (r, g, b, a)
+};
+
+// A vertex attribute of a layout (binding 0)
+struct VertexAttribute
+{
+    uint32_t    location;   // Location in shader.vert
+    VkFormat    format;
+    uint32_t    offset;     // Inside the vertex
+};
+
+// Compile-time description of a vertex type: the vertex input state of the pipeline is generated from it
+template <typename VertexType>
+struct VertexLayout;
+
+template <>
+struct VertexLayout<Vertex>
+{
+    static const VertexFormat format = VertexFormat::Float;
+
+    static std::array<VertexAttribute, 2> attributes()
+    {
+        return { {
+            { 0, VK_FORMAT_R32G32B32_SFLOAT, static_cast<uint32_t>(offsetof(Vertex, pos)) },
+            { 1, VK_FORMAT_R32G32B32_SFLOAT, static_cast<uint32_t>(offsetof(Vertex, col)) }
+        } };
+    }
+};
+
+template <>
+struct VertexLayout<QuantizedVertex>
+{
+    static const VertexFormat format = VertexFormat::Quantized;
+
+    static std::array<VertexAttribute, 2> attributes()
+    {
+        return { {
+            { 0, VK_FORMAT_R16G16B16A16_SNORM, static_cast<uint32_t>(offsetof(QuantizedVertex, pos)) },
+            { 1, VK_FORMAT_R8G8B8A8_UNORM, static_cast<uint32_t>(offsetof(QuantizedVertex, col)) }
+        } };
+    }
+};
+
+// Vertex input binding 0 and its attributes, for the pipeline creation
+struct VertexInputDescription
+{
+    VkVertexInputBindingDescription                 binding = {};
+    std::vector<VkVertexInputAttributeDescription>  attributes;
+};
+
+template <typename VertexType>
+static VertexInputDescription getVertexInputDescription()
+{
+    VertexInputDescription description;
+    description.binding.binding = 0;                                // Can bind multiple streams of data, this defines which one
+    description.binding.stride = sizeof(VertexType);                // Size of a single vertex object
+    description.binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;    // How to move between data after each vertex
+
+    for (const auto &attribute : VertexLayout<VertexType>::attributes())
+    {
+        VkVertexInputAttributeDescription attributeDescription = {};
+        attributeDescription.binding = 0;
+        attributeDescription.location = attribute.location;
+        attributeDescription.format = attribute.format;
+        attributeDescription.offset = attribute.offset;
+        description.attributes.push_back(attributeDescription);
+    }
+
+    return description;
+}
+
+static VertexInputDescription getVertexInputDescription(VertexFormat vertexFormat)
+{
+    return (vertexFormat == VertexFormat::Quantized) ? getVertexInputDescription<QuantizedVertex>() : getVertexInputDescription<Vertex>();
+}
+
+static VkDeviceSize getVertexStride(VertexFormat vertexFormat)
+{
+    return (vertexFormat == VertexFormat::Quantized) ? sizeof(QuantizedVertex) : sizeof(Vertex);
+}
+
+// Quantizes 'vertices' inside their bounding box: position = positionOffset + quantized position * positionScale
+static std::vector<QuantizedVertex> quantizeVertices(const std::vector<Vertex> &vertices, glm::vec3 &positionOffset, glm::vec3 &positionScale)
+{
+    glm::vec3 minPos = vertices.empty() ? glm::vec3(0.0f) : vertices.front().pos;
+    glm::vec3 maxPos = minPos;
+    for (const auto &vertex : vertices)
+    {
+        minPos = glm::min(minPos, vertex.pos);
+        maxPos = glm::max(maxPos, vertex.pos);
+    }
+
+    // Center and half extent of the box (a flat axis keeps a non-zero scale, so the division below is safe)
+    positionOffset = (minPos + maxPos) * 0.5f;
+    positionScale = glm::max((maxPos - minPos) * 0.5f, glm::vec3(1e-6f));
+
+    std::vector<QuantizedVertex> quantizedVertices(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        glm::vec3 normalized = glm::clamp((vertices[i].pos - positionOffset) / positionScale, -1.0f, 1.0f);
+        glm::vec3 colour = glm::clamp(vertices[i].col, 0.0f, 1.0f);
+        for (int c = 0; c < 3; c++)
+        {
+            quantizedVertices[i].pos[c] = static_cast<int16_t>(std::lround(normalized[c] * 32767.0f));
+            quantizedVertices[i].col[c] = static_cast<uint8_t>(std::lround(colour[c] * 255.0f));
+        }
+        quantizedVertices[i].pos[3] = 0;
+        quantizedVertices[i].col[3] = 255;
+    }
+
+    return quantizedVertices;
+}
+
+#pragma warning( pop )
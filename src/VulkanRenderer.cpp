@@ -21,66 +21,119 @@ VulkanRenderer::~VulkanRenderer()
 //------------------------------------------------------------------------------
 // API //
 //------------------------------------------------------------------------------
+void VulkanRenderer::setSettings(const RendererSettings &settings)
+{
+    m_requestedSettings = settings;
+    m_settings = resolveSettings(settings);
+}
+//------------------------------------------------------------------------------
 int VulkanRenderer::init(GLFWwindow* newWindow)
 {
     m_pWindow = newWindow;
 
     try
     {
+        // Meshes from a mesh cache: mapped first, its vertex format is the one of the graphics pipeline
+        MeshCache meshCache;
+        if (!m_settings.meshCachePath.empty())
+        {
+            meshCache.open(m_settings.meshCachePath);
+            m_settings.vertexFormat = meshCache.getVertexFormat();
+            checkCachedMeshSupport();
+        }
+
         createInstance();
         createDebugMessenger();
         createSurface();
         getPhysicalDevice();
         createLogicalDevice();
+        m_allocator.init(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice);
+        m_pipelineCache.init(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice, m_settings.pipelineCachePath);
         createSwapchain();
         createRenderPass();
         createDescriptorSetLayout();
+
+        // Full shader compilation with a cold pipeline cache, mostly lookups with a warm one
+        auto pipelineStart = std::chrono::steady_clock::now();
         createGraphicsPipeline();
+        if (m_settings.gpuCulling)
+        {
+            createCullPipeline();
+        }
+        double pipelineTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pipelineStart).count();
+        cout << "Pipelines created in " << pipelineTime << " ms (";
+        if (m_pipelineCache.isWarm())
+        {
+            cout << "warm cache: " << m_pipelineCache.getInitialDataSize() << " bytes read";
+        }
+        else
+        {
+            cout << "cold cache";
+        }
+        cout << ")" << endl;
         createFramebuffers();
         createCommandPool();
+        m_stagingRing.init(m_mainDevice.logicalDevice, &m_allocator);
+        QueueFamilyIndices queueFamilyIndices = getQueueFamilies(m_mainDevice.physicalDevice);
+        m_uploadBatcher.init(m_mainDevice.logicalDevice, &m_stagingRing,
+            m_transferQueue, static_cast<uint32_t>(queueFamilyIndices.transferFamily), m_transferCommandPool,
+            m_graphicsQueue, static_cast<uint32_t>(queueFamilyIndices.graphicsFamily), m_graphicsCommandPool);
+        m_geometryPool.init(m_mainDevice.logicalDevice, &m_allocator, &m_uploadBatcher, m_graphicsQueue, m_graphicsCommandPool);
+        m_threadPool.init();
+        m_streamingThreadPool.init(STREAMING_THREAD_COUNT);
+        m_assetStreamer.init(&m_streamingThreadPool, m_settings.vertexFormat);
 
         // Model-View-Projection setup
-        m_mvp.projection = glm::perspective(glm::radians(45.0f), (float)m_swapChainExtent.width / (float)m_swapChainExtent.height, 0.1f, 100.0f);
+        m_uboViewProjection.projection = glm::perspective(glm::radians(45.0f), (float)m_swapChainExtent.width / (float)m_swapChainExtent.height, 0.1f, 100.0f);
         //                                               FOV-Y ,                          Aspect Ratio                           ,zNear, zFar
-        m_mvp.view = glm::lookAt(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        m_uboViewProjection.view = glm::lookAt(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
         //                                 Eye              ,           Center           ,           Up
-        m_mvp.model = glm::mat4(1.0f);
-
-        m_mvp.projection[1][1] *= -1;   // Vulkan inverts Y coordinates compared to OpenGL (and GLM is based upon OpenGL coordinate system)
+        m_uboViewProjection.projection[1][1] *= -1;   // Vulkan inverts Y coordinates compared to OpenGL (and GLM is based upon OpenGL coordinate system)
 
         //------------------------------
-        // Create a mesh
+        // Create the meshes
         //------------------------------
-        // Vertex Data
-        std::vector<Vertex> meshVertices = {
-            { { -0.1, -0.4, 0.0 },  { 1.0f, 0.0f, 0.0f } }, // 0
-            { { -0.1, 0.4, 0.0 },   { 0.0f, 1.0f, 0.0f } }, // 1
-            { { -0.9, 0.4, 0.0 },   { 0.0f, 0.0f, 1.0f } }, // 2
-            { { -0.9, -0.4, 0.0 },  { 1.0f, 1.0f, 0.0f } }, // 3
-        };
+        // An indirect draw call binds a single index type for all its draws: keep every mesh in uint32_t then
+        bool allowShortIndices = (m_settings.drawSubmission == DrawSubmission::Direct);
+        if (meshCache.getMeshCount() > 0)
+        {
+            // Straight from the mapping to the staging ring: no parsing nor conversion (uint16_t indices are widened
+            // only if they can't be drawn as they are). The meshes are stored with a single LOD
+            auto loadStart = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < meshCache.getMeshCount(); i++)
+            {
+                m_meshList.push_back(Mesh(&m_geometryPool, meshCache.getMesh(i), allowShortIndices));
+            }
+            double loadTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+            double fileSizeMiB = static_cast<double>(meshCache.getFileSize()) / (1024.0 * 1024.0);
+            cout << "Mesh cache: " << meshCache.getMeshCount() << " meshes, " << fileSizeMiB << " MiB staged in "
+                 << loadTime * 1000.0 << " ms (" << fileSizeMiB / std::max(loadTime, 1e-9) << " MiB/s)" << endl;
+        }
+        else
+        {
+            std::vector<MeshSource> meshSources;
+            if (!m_settings.importPath.empty())
+            {
+                MeshImporter::Statistics statistics;
+                meshSources = MeshImporter::import(m_settings.importPath, &m_threadPool, &statistics);
+                MeshImporter::printStatistics(m_settings.importPath, statistics);
+            }
+            else
+            {
+                meshSources = getBuiltInMeshes();
+            }
 
-        std::vector<Vertex> meshVertices2 = {
-            { { 0.9, -0.3, 0.0 },   { 1.0f, 0.0f, 0.0f } }, // 0
-            { { 0.9, 0.1, 0.0 },    { 0.0f, 1.0f, 0.0f } }, // 1
-            { { 0.1, 0.3, 0.0 },    { 0.0f, 0.0f, 1.0f } }, // 2
-            { { 0.1, -0.3, 0.0 },   { 1.0f, 1.0f, 0.0f } }, // 3
-        };
+            for (const MeshSource &meshSource : meshSources)
+            {
+                m_meshList.push_back(createMesh(meshSource.vertices, meshSource.indices, allowShortIndices, m_settings.meshLodCount));
+            }
+        }
+        m_drawListVersion++;
 
-        // Index Data
-        std::vector<uint32_t> meshIndices = {
-            0, 1, 2, 
-            2, 3, 0
-        };    
-
-        Mesh firstMesh = Mesh(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice,
-            m_graphicsQueue, m_graphicsCommandPool,
-            &meshVertices, &meshIndices);
-        Mesh secondMesh = Mesh(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice,
-            m_graphicsQueue, m_graphicsCommandPool,
-            &meshVertices2, &meshIndices);
-
-        m_meshList.push_back(firstMesh);
-        m_meshList.push_back(secondMesh);
+        // Submit all the mesh uploads at once, without waiting: the draws are submitted later on the graphics queue,
+        // after the barrier (or ownership acquire, with a dedicated transfer queue) making the copies visible to vertex input
+        m_uploadBatcher.flush();
+        meshCache.close();
         //------------------------------
 
         createCommandBuffers();
@@ -89,6 +142,9 @@ int VulkanRenderer::init(GLFWwindow* newWindow)
         createDescriptorSets();
         recordCommands();
         createSynchronisation();
+
+        // Device memory usage after loading
+        m_allocator.printStatistics();
     }
     catch (const std::runtime_error &e)
     {
@@ -99,9 +155,99 @@ int VulkanRenderer::init(GLFWwindow* newWindow)
     return EXIT_SUCCESS;
 }
 //------------------------------------------------------------------------------
-void VulkanRenderer::updateModel(glm::mat4 newModel)
+void VulkanRenderer::updateModel(int modelId, glm::mat4 newModel)
+{
+    if (modelId < 0 || modelId >= static_cast<int>(m_meshList.size()))
+    {
+        return;
+    }
+
+    // Same matrix: nothing to upload in the next frames
+    if (newModel == m_meshList[modelId].getModel().model)
+    {
+        return;
+    }
+
+    m_meshList[modelId].setModel(newModel);
+    m_modelVersion++;
+    setMeshDynamic(modelId);
+}
+//------------------------------------------------------------------------------
+int VulkanRenderer::addTransformNode(int parentNode, glm::mat4 local, int modelId)
+{
+    // Meshes are never removed from the list: the index stays valid
+    int32_t objectIndex = (modelId >= 0 && modelId < static_cast<int>(m_meshList.size())) ? modelId : -1;
+    uint32_t parent = (parentNode < 0) ? TransformHierarchy::NO_PARENT : static_cast<uint32_t>(parentNode);
+    return static_cast<int>(m_transformHierarchy.addNode(parent, local, objectIndex));
+}
+//------------------------------------------------------------------------------
+void VulkanRenderer::updateTransformNode(int nodeId, glm::mat4 local)
+{
+    if (nodeId < 0 || nodeId >= static_cast<int>(m_transformHierarchy.getNodeCount()))
+    {
+        return;
+    }
+
+    m_transformHierarchy.setLocal(static_cast<uint32_t>(nodeId), local);
+}
+//------------------------------------------------------------------------------
+void VulkanRenderer::streamMeshes(const std::string &filename, glm::mat4 model, int priority)
+{
+    checkCachedMeshSupport();
+    m_assetStreamer.request(filename, model, priority);
+}
+//------------------------------------------------------------------------------
+int VulkanRenderer::addInstancedMesh(std::vector<Vertex> * vertices, std::vector<uint32_t> * indices, std::vector<InstanceData> * instances)
+{
+    // The command buffers in flight reference the current instanced meshes
+    vkDeviceWaitIdle(m_mainDevice.logicalDevice);
+
+    // No LOD: the instances are spread over the scene, at any distance
+    Mesh instancedMesh = createMesh(*vertices, *indices, true, 1);
+    instancedMesh.createInstanceBuffer(m_mainDevice.logicalDevice, &m_allocator, &m_uploadBatcher, instances);
+    m_uploadBatcher.flush();
+
+    m_instancedMeshList.push_back(instancedMesh);
+
+    // The draws are baked in the command buffers
+    recordCommands();
+
+    return static_cast<int>(m_instancedMeshList.size()) - 1;
+}
+//------------------------------------------------------------------------------
+const FrameStatistics & VulkanRenderer::getFrameStatistics() const
+{
+    return m_frameStatistics;
+}
+//------------------------------------------------------------------------------
+std::vector<MeshSource> VulkanRenderer::getBuiltInMeshes()
 {
-    m_mvp.model = newModel;
+    std::vector<MeshSource> meshes(2);
+
+    // Vertex Data
+    meshes[0].vertices = {
+        { { -0.1, -0.4, 0.0 },  { 1.0f, 0.0f, 0.0f } }, // 0
+        { { -0.1, 0.4, 0.0 },   { 0.0f, 1.0f, 0.0f } }, // 1
+        { { -0.9, 0.4, 0.0 },   { 0.0f, 0.0f, 1.0f } }, // 2
+        { { -0.9, -0.4, 0.0 },  { 1.0f, 1.0f, 0.0f } }, // 3
+    };
+
+    meshes[1].vertices = {
+        { { 0.9, -0.3, 0.0 },   { 1.0f, 0.0f, 0.0f } }, // 0
+        { { 0.9, 0.1, 0.0 },    { 0.0f, 1.0f, 0.0f } }, // 1
+        { { 0.1, 0.3, 0.0 },    { 0.0f, 0.0f, 1.0f } }, // 2
+        { { 0.1, -0.3, 0.0 },   { 1.0f, 1.0f, 0.0f } }, // 3
+    };
+
+    // Index Data
+    std::vector<uint32_t> meshIndices = {
+        0, 1, 2,
+        2, 3, 0
+    };
+    meshes[0].indices = meshIndices;
+    meshes[1].indices = meshIndices;
+
+    return meshes;
 }
 //------------------------------------------------------------------------------
 void VulkanRenderer::draw()
@@ -111,13 +257,80 @@ void VulkanRenderer::draw()
     // Manually reset (close) fences
     vkResetFences(m_mainDevice.logicalDevice, 1, &m_drawFences[m_currentFrame]);
 
+    // The culling of the last frame using these buffers has finished: its visible count can be read back
+    if (m_settings.gpuCulling && m_frameStatistics.frameCount >= MAX_FRAME_DRAWS)
+    {
+        uint32_t visibleObjects = 0;
+        memcpy(&visibleObjects, static_cast<char *>(m_drawIndirectBufferMemory[m_currentFrame].mappedData) + DRAW_COUNT_OFFSET, sizeof(uint32_t));
+        m_frameStatistics.visibleObjects = visibleObjects;
+        m_frameStatistics.submittedObjects = getIndirectDrawCount();
+    }
+
     // -- GET NEXT IMAGE --
     // Get index of next image to be drawn to, and signal semaphore when ready to be drawn to
     uint32_t imageIndex;
     vkAcquireNextImageKHR(m_mainDevice.logicalDevice, m_swapChain, std::numeric_limits<uint64_t>::max(), m_imageAvailable[m_currentFrame], VK_NULL_HANDLE, &imageIndex);
 
-    // Update Uniform Buffer (this should be after the acquiring of next image)
-    updateUniformBuffer(imageIndex);
+    // Update Uniform Buffers of this frame in flight (their previous reader has finished, since we waited for the fence)
+    m_frameStatistics.uniformBytesWritten = 0;
+    m_frameStatistics.commandBuffersRecorded = 0;
+    m_frameStatistics.staticCacheHits = 0;
+    m_frameStatistics.staticCacheInvalidations = 0;
+    updateStreaming();                          // Before anything reading the mesh list
+    updateTransforms();                         // Before anything reading the Model matrices
+    if (m_settings.cpuCulling)
+    {
+        updateCpuCulling();                     // Before the draws are recorded or written
+    }
+    if (m_settings.meshLodCount > 1 && !m_settings.gpuCulling)
+    {
+        updateLodSelection();                   // GPU culling picks the LODs in the compute shader
+    }
+    updateUniformBuffers(m_currentFrame);
+    if (m_settings.clusterCulling)
+    {
+        updateCullClusters(m_currentFrame);     // The draw commands are written by the GPU
+    }
+    else if (m_settings.gpuCulling)
+    {
+        updateCullObjects(m_currentFrame);      // The draw commands are written by the GPU
+    }
+    else if (m_settings.drawSubmission == DrawSubmission::Indirect)
+    {
+        updateDrawIndirectCommands(m_currentFrame);
+    }
+
+    // The geometry buffers have been replaced (the pool has grown): every command buffer binds the old ones
+    // (N.B.: growing already waited for the device to be idle)
+    auto recordStart = std::chrono::steady_clock::now();
+    if (!m_settings.recordEveryFrame && m_recordedGeometryGeneration != m_geometryPool.getGeneration())
+    {
+        recordCommands();
+        m_frameStatistics.commandBuffersRecorded += m_commandBuffers.size();
+    }
+
+    // Push constants (and direct draws) are baked in the command buffer: re-record it if a Model matrix (or the draw list,
+    // e.g. the LODs) changed since it was recorded (safe: its last submission was made by this frame in flight, whose fence we waited for)
+    size_t commandBufferIdx = imageIndex * MAX_FRAME_DRAWS + m_currentFrame;
+    bool modelChanged = (m_settings.modelTransfer == ModelTransfer::PushConstant && m_commandBufferModelVersion[commandBufferIdx] != m_modelVersion);
+    // (without vkCmdDrawIndexedIndirectCount, the draw count of the indirect draws is baked too)
+    bool drawListBaked = (m_settings.drawSubmission == DrawSubmission::Direct) ||
+                         !(m_enabledFeatures.drawIndirectCount && m_enabledFeatures.multiDrawIndirect);
+    bool drawListChanged = (drawListBaked && m_commandBufferDrawListVersion[commandBufferIdx] != m_drawListVersion);
+    if (m_settings.recordEveryFrame)
+    {
+        // Always from the current scene: the pool of this frame in flight only holds command buffers last submitted
+        // by this frame in flight (the same fence), reset all at once
+        vkResetCommandPool(m_mainDevice.logicalDevice, m_frameCommandPools[m_currentFrame], 0);
+        recordCommandBuffer(commandBufferIdx);
+        m_frameStatistics.commandBuffersRecorded++;
+    }
+    else if (modelChanged || drawListChanged)
+    {
+        recordCommandBuffer(commandBufferIdx);
+        m_frameStatistics.commandBuffersRecorded++;
+    }
+    m_frameStatistics.recordMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recordStart).count();
     
     // -- SUBMIT COMMAND BUFFER TO RENDER --
     // Queue submission information
@@ -130,7 +343,7 @@ void VulkanRenderer::draw()
     };
     submitInfo.pWaitDstStageMask = waitStages;                          // Stages to check semaphores at
     submitInfo.commandBufferCount = 1;                                  // Number of command buffers to submit
-    submitInfo.pCommandBuffers = &m_commandBuffers[imageIndex];         // Command buffer to submit
+    submitInfo.pCommandBuffers = &m_commandBuffers[commandBufferIdx];  // Command buffer to submit (image + frame in flight)
     submitInfo.signalSemaphoreCount = 1;                                // Number of semaphores to signal
     submitInfo.pSignalSemaphores = &m_renderFinished[m_currentFrame];   // Semaphores to signal when command buffer finishes
 
@@ -158,23 +371,76 @@ void VulkanRenderer::draw()
         throw std::runtime_error("Failed to present Image!");
     }
 
+    m_frameStatistics.frameCount++;
+    m_frameStatistics.totalUniformBytesWritten += m_frameStatistics.uniformBytesWritten;
+
     // Get next frame (use % MAX_FRAME_DRAWS to keep value below MAX_FRAME_DRAWS)
     m_currentFrame = (m_currentFrame + 1) % MAX_FRAME_DRAWS;
 }
 //------------------------------------------------------------------------------
+void VulkanRenderer::runBenchmarks()
+{
+    // The benchmarks write to the resources of the frames in flight
+    vkDeviceWaitIdle(m_mainDevice.logicalDevice);
+
+    // Mesh uploads: a staging buffer and a blocking submit per upload (old path) vs. batched uploads through the staging ring
+    Benchmarks::meshUploads(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice, &m_allocator, m_graphicsQueue, m_graphicsCommandPool,
+        &m_uploadBatcher);
+
+    // Draw recording: Model matrices through the dynamic uniform buffer vs. push constants vs. indirect draws
+    // (the buffers of frame in flight 0 are scratch: they are rewritten by the next frame using them)
+    Benchmarks::DrawRecordingTarget target = {};
+    target.renderPass = m_renderPass;
+    target.framebuffer = m_swapChainFramebuffers[0];
+    target.extent = m_swapChainExtent;
+    target.pipeline = m_graphicsPipeline;
+    target.pipelineLayout = m_pipelineLayout;
+    target.descriptorSet = m_descriptorSets[0];
+    target.modelUniformData = m_modelDynUniformBufferMemory[0].mappedData;
+    target.modelUniformAlignment = m_modelUniformAlignment;
+    target.modelStorageData = m_modelStorageBufferMemory[0].mappedData;
+    target.drawIndirectBuffer = m_drawIndirectBuffer[0];
+    target.drawIndirectData = m_drawIndirectBufferMemory[0].mappedData;
+    target.multiDrawIndirect = m_enabledFeatures.multiDrawIndirect;
+    Benchmarks::drawRecording(m_mainDevice.logicalDevice, static_cast<uint32_t>(getQueueFamilies(m_mainDevice.physicalDevice).graphicsFamily),
+        target, &m_meshList[0]);
+    m_modelDynUniformBufferVersion[0] = 0;
+    m_modelStorageBufferVersion[0] = 0;
+    m_drawIndirectBufferVersion[0] = 0;
+
+    // Recording of 100K draws split across the threads of the pool (secondary command buffers)
+    Benchmarks::parallelRecording(m_mainDevice.logicalDevice, static_cast<uint32_t>(getQueueFamilies(m_mainDevice.physicalDevice).graphicsFamily),
+        target, &m_meshList[0], &m_threadPool);
+
+    // CPU visibility: 1M bounding spheres, scalar vs. SIMD
+    Benchmarks::frustumCulling();
+
+    // Mesh optimizer on a shuffled grid: time and correctness (CPU only, deterministic)
+    Benchmarks::meshOptimizer();
+}
+//------------------------------------------------------------------------------
 void VulkanRenderer::cleanup()
 {
+    // No more streaming worker (the meshes they decoded are dropped)
+    m_assetStreamer.destroy();
+    m_streamingThreadPool.destroy();
+    m_threadPool.destroy();
+
     // Wait until no actions being run on device before destroying
     vkDeviceWaitIdle(m_mainDevice.logicalDevice);
 
     // Destroy Descriptor Pool and Descriptor SetLayout
     vkDestroyDescriptorPool(m_mainDevice.logicalDevice, m_descriptorPool, nullptr);
     vkDestroyDescriptorSetLayout(m_mainDevice.logicalDevice, m_descriptorSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(m_mainDevice.logicalDevice, m_cullDescriptorSetLayout, nullptr);
     // Destroy Uniform Buffers and free related memory
-    for (size_t i = 0; i < m_uniformBuffer.size(); i++)
+    for (size_t i = 0; i < m_vpUniformBuffer.size(); i++)
     {
-        vkDestroyBuffer(m_mainDevice.logicalDevice, m_uniformBuffer[i], nullptr);
-        vkFreeMemory(m_mainDevice.logicalDevice, m_uniformBufferMemory[i], nullptr);
+        destroyBuffer(m_mainDevice.logicalDevice, &m_allocator, m_vpUniformBuffer[i], &m_vpUniformBufferMemory[i]);
+        destroyBuffer(m_mainDevice.logicalDevice, &m_allocator, m_modelDynUniformBuffer[i], &m_modelDynUniformBufferMemory[i]);
+        destroyBuffer(m_mainDevice.logicalDevice, &m_allocator, m_modelStorageBuffer[i], &m_modelStorageBufferMemory[i]);
+        destroyBuffer(m_mainDevice.logicalDevice, &m_allocator, m_drawIndirectBuffer[i], &m_drawIndirectBufferMemory[i]);
+        destroyBuffer(m_mainDevice.logicalDevice, &m_allocator, m_cullObjectBuffer[i], &m_cullObjectBufferMemory[i]);
     }
 
     // Destroy Meshes
@@ -182,6 +448,18 @@ void VulkanRenderer::cleanup()
     {
         m_meshList[i].destroyBuffers();
     }
+    for (size_t i = 0; i < m_instancedMeshList.size(); i++)
+    {
+        m_instancedMeshList[i].destroyBuffers();
+    }
+    for (auto &streamedUpload : m_streamedUploads)
+    {
+        streamedUpload.mesh.destroyBuffers();
+    }
+
+    m_geometryPool.destroy();
+    m_uploadBatcher.destroy();
+    m_stagingRing.destroy();
 
     for (size_t i = 0; i < MAX_FRAME_DRAWS; i++)
     {
@@ -190,6 +468,15 @@ void VulkanRenderer::cleanup()
         vkDestroyFence(m_mainDevice.logicalDevice, m_drawFences[i], nullptr);
     }
 
+    for (auto commandPool : m_recordingCommandPools)
+    {
+        vkDestroyCommandPool(m_mainDevice.logicalDevice, commandPool, nullptr);
+    }
+    for (auto commandPool : m_frameCommandPools)
+    {
+        vkDestroyCommandPool(m_mainDevice.logicalDevice, commandPool, nullptr);
+    }
+    vkDestroyCommandPool(m_mainDevice.logicalDevice, m_transferCommandPool, nullptr);
     vkDestroyCommandPool(m_mainDevice.logicalDevice, m_graphicsCommandPool, nullptr);
 
     for (auto framebuffer : m_swapChainFramebuffers)
@@ -197,10 +484,17 @@ void VulkanRenderer::cleanup()
         vkDestroyFramebuffer(m_mainDevice.logicalDevice, framebuffer, nullptr);
     }
 
+    vkDestroyPipeline(m_mainDevice.logicalDevice, m_cullPipeline, nullptr);
+    vkDestroyPipelineLayout(m_mainDevice.logicalDevice, m_cullPipelineLayout, nullptr);
+    vkDestroyPipeline(m_mainDevice.logicalDevice, m_instancedPipeline, nullptr);
     vkDestroyPipeline(m_mainDevice.logicalDevice, m_graphicsPipeline, nullptr);
     vkDestroyPipelineLayout(m_mainDevice.logicalDevice, m_pipelineLayout, nullptr);
     vkDestroyRenderPass(m_mainDevice.logicalDevice, m_renderPass, nullptr);
 
+    // The next launches start with the pipelines compiled so far
+    m_pipelineCache.save();
+    m_pipelineCache.destroy();
+
     for (auto image : m_swapchainImages)
     {
         vkDestroyImageView(m_mainDevice.logicalDevice, image.imageView, nullptr);
@@ -208,6 +502,9 @@ void VulkanRenderer::cleanup()
     vkDestroySwapchainKHR(m_mainDevice.logicalDevice, m_swapChain, nullptr);
     vkDestroySurfaceKHR(m_pInstance, m_surface, nullptr);
 
+    // Release all the memory blocks still alive (they should be empty by now)
+    m_allocator.destroy();
+
     vkDestroyDevice(m_mainDevice.logicalDevice, nullptr);
 
     if (g_validationEnabled) {
@@ -296,7 +593,58 @@ void VulkanRenderer::createLogicalDevice()
 
     // Vector for queue creation information and set for family indices
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<int> queueFamilyIndices = { indices.graphicsFamily, indices.presentationFamily };
+    std::set<int> queueFamilyIndices = { indices.graphicsFamily, indices.presentationFamily, indices.transferFamily };
+
+    // Optional features and extensions used by indirect draws (enabled only when the device has them)
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(m_mainDevice.physicalDevice, &supportedFeatures);
+    m_enabledFeatures.multiDrawIndirect = (supportedFeatures.multiDrawIndirect == VK_TRUE);
+    m_enabledFeatures.drawIndirectFirstInstance = (supportedFeatures.drawIndirectFirstInstance == VK_TRUE);
+
+    std::vector<const char*> enabledExtensions = deviceExtensions;
+    m_enabledFeatures.drawIndirectCount = checkDeviceExtensionSupport(m_mainDevice.physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    if (m_enabledFeatures.drawIndirectCount)
+    {
+        enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    }
+
+    // Each indirect draw selects its Model matrix through firstInstance
+    bool dropIndirect = (m_settings.drawSubmission == DrawSubmission::Indirect && !m_enabledFeatures.drawIndirectFirstInstance);
+    if (dropIndirect)
+    {
+        cout << "drawIndirectFirstInstance is not supported: falling back to direct draws." << endl;
+    }
+
+    // The culling dispatch is recorded in the graphics command buffers
+    bool dropGpuCulling = dropIndirect;
+    if (m_settings.gpuCulling && !dropIndirect)
+    {
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(m_mainDevice.physicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilyList(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(m_mainDevice.physicalDevice, &queueFamilyCount, queueFamilyList.data());
+
+        if (!(queueFamilyList[indices.graphicsFamily].queueFlags & VK_QUEUE_COMPUTE_BIT))
+        {
+            cout << "The graphics queue doesn't support compute: GPU culling disabled." << endl;
+            dropGpuCulling = true;
+        }
+    }
+
+    // Settings resolved again from the requested ones without the unsupported modes: what the user gets without asking
+    // for them (e.g. the requested Model matrix path, CPU culling, parallel recording with direct draws)
+    if (dropIndirect || dropGpuCulling)
+    {
+        RendererSettings settings = m_requestedSettings;
+        settings.vertexFormat = m_settings.vertexFormat;    // Possibly the one of the mesh cache (see init())
+        if (dropIndirect)
+        {
+            settings.drawSubmission = DrawSubmission::Direct;
+        }
+        settings.gpuCulling = false;
+        settings.clusterCulling = false;
+        m_settings = resolveSettings(settings);
+    }
 
     // Queues that the logical device needs to create and infos to do so
     for (int queueFamilyIndex : queueFamilyIndices)
@@ -316,11 +664,13 @@ void VulkanRenderer::createLogicalDevice()
     deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());     // Number of Queue Create Infos
     deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();                               // List of Queue create infos so device can create required queues
-    deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());    // Number of enabled Logical Device Extensions
-    deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();                         // List of enabled Logical Device Extensions
+    deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());   // Number of enabled Logical Device Extensions
+    deviceCreateInfo.ppEnabledExtensionNames = enabledExtensions.data();                        // List of enabled Logical Device Extensions
 
     // Physical Device Features the Logical Device will be using
     VkPhysicalDeviceFeatures deviceFeatures = {};
+    deviceFeatures.multiDrawIndirect = m_enabledFeatures.multiDrawIndirect ? VK_TRUE : VK_FALSE;
+    deviceFeatures.drawIndirectFirstInstance = m_enabledFeatures.drawIndirectFirstInstance ? VK_TRUE : VK_FALSE;
 
     deviceCreateInfo.pEnabledFeatures = &deviceFeatures;        // Physical Device Features that Logical Device will use
 
@@ -336,6 +686,14 @@ void VulkanRenderer::createLogicalDevice()
     // From given logical device, of given Queue Family, of given Queue Index (0 since only one queue), place reference in given VkQueue
     vkGetDeviceQueue(m_mainDevice.logicalDevice, indices.graphicsFamily, 0, &m_graphicsQueue);
     vkGetDeviceQueue(m_mainDevice.logicalDevice, indices.presentationFamily, 0, &m_presentationQueue);
+    vkGetDeviceQueue(m_mainDevice.logicalDevice, indices.transferFamily, 0, &m_transferQueue);     // Same as m_graphicsQueue if there's no dedicated family
+
+    // Extension commands are not exported by the loader: get them from the device
+    if (m_enabledFeatures.drawIndirectCount)
+    {
+        m_vkCmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(m_mainDevice.logicalDevice, "vkCmdDrawIndexedIndirectCountKHR");
+        m_enabledFeatures.drawIndirectCount = (m_vkCmdDrawIndexedIndirectCount != nullptr);
+    }
 }
 //------------------------------------------------------------------------------
 void VulkanRenderer::createSurface()
@@ -509,19 +867,37 @@ void VulkanRenderer::createRenderPass()
 //------------------------------------------------------------------------------
 void VulkanRenderer::createDescriptorSetLayout()
 {
-    // MVP (Model-View-Projection) Binding Info
-    VkDescriptorSetLayoutBinding mvpLayoutBinding = {};
-    mvpLayoutBinding.binding = 0;                                           // Binding point in shader (designated by binding number in shader)
-    mvpLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;    // Type of descriptor (uniform, dynamic uniform, image sampler, etc)
-    mvpLayoutBinding.descriptorCount = 1;                                   // Number of descriptors for binding
-    mvpLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;               // Shader stage to bind to
-    mvpLayoutBinding.pImmutableSamplers = nullptr;                          // For Texture: Can make sampler data unchangeable (immutable) by specifying in layout
+    // UboViewProjection Binding Info
+    VkDescriptorSetLayoutBinding vpLayoutBinding = {};
+    vpLayoutBinding.binding = 0;                                            // Binding point in shader (designated by binding number in shader)
+    vpLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;     // Type of descriptor (uniform, dynamic uniform, image sampler, etc)
+    vpLayoutBinding.descriptorCount = 1;                                    // Number of descriptors for binding
+    vpLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;                // Shader stage to bind to
+    vpLayoutBinding.pImmutableSamplers = nullptr;                           // For Texture: Can make sampler data unchangeable (immutable) by specifying in layout
+
+    // UboModel Binding Info (the offset of the object to draw is given at bind time)
+    VkDescriptorSetLayoutBinding modelLayoutBinding = {};
+    modelLayoutBinding.binding = 1;
+    modelLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    modelLayoutBinding.descriptorCount = 1;
+    modelLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    modelLayoutBinding.pImmutableSamplers = nullptr;
+
+    // Model matrices Binding Info (whole array, indexed by the instance index of the draw)
+    VkDescriptorSetLayoutBinding modelStorageLayoutBinding = {};
+    modelStorageLayoutBinding.binding = 2;
+    modelStorageLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    modelStorageLayoutBinding.descriptorCount = 1;
+    modelStorageLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    modelStorageLayoutBinding.pImmutableSamplers = nullptr;
+
+    std::vector<VkDescriptorSetLayoutBinding> layoutBindings = { vpLayoutBinding, modelLayoutBinding, modelStorageLayoutBinding };
 
     // Create Descriptor Set Layout with given bindings
     VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
     layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutCreateInfo.bindingCount = 1;                  // Number of binding infos
-    layoutCreateInfo.pBindings = &mvpLayoutBinding;     // Array of binding infos
+    layoutCreateInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());  // Number of binding infos
+    layoutCreateInfo.pBindings = layoutBindings.data();                             // Array of binding infos
 
     // Create Descriptor Set Layout
     VkResult result = vkCreateDescriptorSetLayout(m_mainDevice.logicalDevice, &layoutCreateInfo, nullptr, &m_descriptorSetLayout);
@@ -529,6 +905,26 @@ void VulkanRenderer::createDescriptorSetLayout()
     {
         throw std::runtime_error("Failed to create a Descriptor Set Layout!");
     }
+
+    // Culling compute shader: ViewProjection, objects, Model matrices, draw commands, draw count
+    std::vector<VkDescriptorSetLayoutBinding> cullLayoutBindings(5);
+    for (uint32_t i = 0; i < cullLayoutBindings.size(); i++)
+    {
+        cullLayoutBindings[i].binding = i;
+        cullLayoutBindings[i].descriptorType = (i == 0) ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        cullLayoutBindings[i].descriptorCount = 1;
+        cullLayoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        cullLayoutBindings[i].pImmutableSamplers = nullptr;
+    }
+
+    layoutCreateInfo.bindingCount = static_cast<uint32_t>(cullLayoutBindings.size());
+    layoutCreateInfo.pBindings = cullLayoutBindings.data();
+
+    result = vkCreateDescriptorSetLayout(m_mainDevice.logicalDevice, &layoutCreateInfo, nullptr, &m_cullDescriptorSetLayout);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create the Culling Descriptor Set Layout!");
+    }
 }
 //------------------------------------------------------------------------------
 void VulkanRenderer::createGraphicsPipeline()
@@ -550,6 +946,22 @@ void VulkanRenderer::createGraphicsPipeline()
     vertexShaderCreateInfo.module = vertexShaderModule;                 // Shader module to be used by stage
     vertexShaderCreateInfo.pName = "main";                              // Entry point function name (in the shader)
 
+    // Specialization constant 0 (MODEL_SOURCE) picks where the vertex shader reads the Model matrix from
+    int32_t modelSource = static_cast<int32_t>(m_settings.modelTransfer);
+
+    VkSpecializationMapEntry specializationEntry = {};
+    specializationEntry.constantID = 0;
+    specializationEntry.offset = 0;
+    specializationEntry.size = sizeof(int32_t);
+
+    VkSpecializationInfo specializationInfo = {};
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &specializationEntry;
+    specializationInfo.dataSize = sizeof(int32_t);
+    specializationInfo.pData = &modelSource;
+
+    vertexShaderCreateInfo.pSpecializationInfo = &specializationInfo;
+
     // Fragment Stage creation information
     VkPipelineShaderStageCreateInfo fragmentShaderCreateInfo = {};
     fragmentShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -562,28 +974,12 @@ void VulkanRenderer::createGraphicsPipeline()
     VkPipelineShaderStageCreateInfo shaderStages[] = { vertexShaderCreateInfo, fragmentShaderCreateInfo };
 
     // CREATE GRAPHICS PIPELINE
-    // Vertex binding description (including info such as position, colour, texture coords, normals, etc) as a whole
-    VkVertexInputBindingDescription bindingDescription = {};
-    bindingDescription.binding = 0;                                 // Can bind multiple streams of data, this defines which one
-    bindingDescription.stride = sizeof(Vertex);                     // Size of a single vertex object
-    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;     // How to move between data after each vertex.
-                                                                    // VK_VERTEX_INPUT_RATE_INDEX        : Move on to the next vertex
-                                                                    // VK_VERTEX_INPUT_RATE_INSTANCE    : Move to a vertex for the next instance
-
-    // How the data for an attribute is defined within a vertex
-    std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions;
-
-    // Vertex Position Attribute
-    attributeDescriptions[0].binding = 0;                           // Which binding the data is at (should be same as above)
-    attributeDescriptions[0].location = 0;                          // Location in shader where data will be read from
-    attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;   // Format the data will take (also helps define size of data)
-    attributeDescriptions[0].offset = offsetof(Vertex, pos);        // Where this attribute is defined in the data for a single vertex
-
-    // Vertex Colour Attribute
-    attributeDescriptions[1].binding = 0;                            
-    attributeDescriptions[1].location = 1;                            
-    attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;    
-    attributeDescriptions[1].offset = offsetof(Vertex, col);
+    // Vertex binding description (including info such as position, colour, texture coords, normals, etc) as a whole,
+    // and how the data for each attribute is defined within a vertex: generated from the VertexLayout of the vertex format
+    // (quantized formats are dequantized by shader.vert, so the same shaders serve every format)
+    VertexInputDescription vertexInputDescription = getVertexInputDescription(m_settings.vertexFormat);
+    VkVertexInputBindingDescription bindingDescription = vertexInputDescription.binding;
+    std::vector<VkVertexInputAttributeDescription> &attributeDescriptions = vertexInputDescription.attributes;
 
     // -- VERTEX INPUT --
     VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
@@ -684,13 +1080,20 @@ void VulkanRenderer::createGraphicsPipeline()
     colourBlendingCreateInfo.pAttachments = &colourState;
 
 
+    // -- PUSH CONSTANTS --
+    // Model matrix and position dequantization (96 bytes, within the 128 bytes guaranteed by every device)
+    VkPushConstantRange pushConstantRange = {};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;  // Shader stage push constant will go to
+    pushConstantRange.offset = 0;                               // Offset into given data to pass to push constant
+    pushConstantRange.size = sizeof(UboModel);                  // Size of data being passed
+
     // -- PIPELINE LAYOUT --
     VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
     pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutCreateInfo.setLayoutCount = 1;
     pipelineLayoutCreateInfo.pSetLayouts = &m_descriptorSetLayout;
-    pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-    pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
 
     // Create Pipeline Layout
     VkResult result = vkCreatePipelineLayout(m_mainDevice.logicalDevice, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout);
@@ -726,17 +1129,123 @@ void VulkanRenderer::createGraphicsPipeline()
     pipelineCreateInfo.basePipelineIndex = -1;                          // or index of pipeline being created to derive from (in case creating multiple at once)
 
     // Create Graphics Pipeline
-    result = vkCreateGraphicsPipelines(m_mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_graphicsPipeline);
+    result = vkCreateGraphicsPipelines(m_mainDevice.logicalDevice, m_pipelineCache.getPipelineCache(), 1, &pipelineCreateInfo, nullptr, &m_graphicsPipeline);
     if (result != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to create a Graphics Pipeline!");
     }
 
+    // -- INSTANCED GRAPHICS PIPELINE --
+    // Same states, plus a second vertex binding advancing once per instance (InstanceData)
+    auto instancedVertexShaderCode = readFile("Shaders/vert_instanced.spv");
+    VkShaderModule instancedVertexShaderModule = createShaderModule(instancedVertexShaderCode);
+
+    std::array<VkVertexInputBindingDescription, 2> instancedBindingDescriptions = { bindingDescription, {} };
+    instancedBindingDescriptions[1].binding = 1;
+    instancedBindingDescriptions[1].stride = sizeof(InstanceData);
+    instancedBindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+    // A mat4 attribute takes 4 locations (one vec4 column each), then the colour
+    std::vector<VkVertexInputAttributeDescription> instancedAttributeDescriptions = attributeDescriptions;
+    for (uint32_t column = 0; column < 4; column++)
+    {
+        VkVertexInputAttributeDescription transformColumn = {};
+        transformColumn.binding = 1;
+        transformColumn.location = 2 + column;
+        transformColumn.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+        transformColumn.offset = static_cast<uint32_t>(offsetof(InstanceData, transform) + column * sizeof(glm::vec4));
+        instancedAttributeDescriptions.push_back(transformColumn);
+    }
+    VkVertexInputAttributeDescription instanceColour = {};
+    instanceColour.binding = 1;
+    instanceColour.location = 6;
+    instanceColour.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    instanceColour.offset = offsetof(InstanceData, colour);
+    instancedAttributeDescriptions.push_back(instanceColour);
+
+    vertexInputCreateInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(instancedBindingDescriptions.size());
+    vertexInputCreateInfo.pVertexBindingDescriptions = instancedBindingDescriptions.data();
+    vertexInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(instancedAttributeDescriptions.size());
+    vertexInputCreateInfo.pVertexAttributeDescriptions = instancedAttributeDescriptions.data();
+
+    // The Model matrix of an instanced mesh is always pushed (one draw per mesh: instances can't index per-object buffers)
+    int32_t instancedModelSource = static_cast<int32_t>(ModelTransfer::PushConstant);
+    specializationInfo.pData = &instancedModelSource;
+    shaderStages[0].module = instancedVertexShaderModule;
+
+    result = vkCreateGraphicsPipelines(m_mainDevice.logicalDevice, m_pipelineCache.getPipelineCache(), 1, &pipelineCreateInfo, nullptr, &m_instancedPipeline);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create the Instanced Graphics Pipeline!");
+    }
+
     // |B| Destroy Shader Modules, no longer needed after the Pipeline is created
+    vkDestroyShaderModule(m_mainDevice.logicalDevice, instancedVertexShaderModule, nullptr);
     vkDestroyShaderModule(m_mainDevice.logicalDevice, fragmentShaderModule, nullptr);
     vkDestroyShaderModule(m_mainDevice.logicalDevice, vertexShaderModule, nullptr);
 }
 //------------------------------------------------------------------------------
+void VulkanRenderer::createCullPipeline()
+{
+    auto computeShaderCode = readFile(m_settings.clusterCulling ? "Shaders/cull_clusters.spv" : "Shaders/cull.spv");
+    VkShaderModule computeShaderModule = createShaderModule(computeShaderCode);
+
+    // Specialization constant 0 (COMPACT_DRAWS): append the visible draws only if the GPU also provides the draw count
+    VkBool32 compactDraws = (m_enabledFeatures.drawIndirectCount && m_enabledFeatures.multiDrawIndirect) ? VK_TRUE : VK_FALSE;
+
+    VkSpecializationMapEntry specializationEntry = {};
+    specializationEntry.constantID = 0;
+    specializationEntry.offset = 0;
+    specializationEntry.size = sizeof(VkBool32);
+
+    VkSpecializationInfo specializationInfo = {};
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &specializationEntry;
+    specializationInfo.dataSize = sizeof(VkBool32);
+    specializationInfo.pData = &compactDraws;
+
+    VkPipelineShaderStageCreateInfo computeShaderCreateInfo = {};
+    computeShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    computeShaderCreateInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    computeShaderCreateInfo.module = computeShaderModule;
+    computeShaderCreateInfo.pName = "main";
+    computeShaderCreateInfo.pSpecializationInfo = &specializationInfo;
+
+    // Object count (the dispatch covers whole workgroups)
+    VkPushConstantRange pushConstantRange = {};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(CullPushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCreateInfo.setLayoutCount = 1;
+    pipelineLayoutCreateInfo.pSetLayouts = &m_cullDescriptorSetLayout;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+    VkResult result = vkCreatePipelineLayout(m_mainDevice.logicalDevice, &pipelineLayoutCreateInfo, nullptr, &m_cullPipelineLayout);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create the Culling Pipeline Layout!");
+    }
+
+    VkComputePipelineCreateInfo pipelineCreateInfo = {};
+    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineCreateInfo.stage = computeShaderCreateInfo;
+    pipelineCreateInfo.layout = m_cullPipelineLayout;
+    pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineCreateInfo.basePipelineIndex = -1;
+
+    result = vkCreateComputePipelines(m_mainDevice.logicalDevice, m_pipelineCache.getPipelineCache(), 1, &pipelineCreateInfo, nullptr, &m_cullPipeline);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create the Culling Compute Pipeline!");
+    }
+
+    vkDestroyShaderModule(m_mainDevice.logicalDevice, computeShaderModule, nullptr);
+}
+//------------------------------------------------------------------------------
 void VulkanRenderer::createFramebuffers()
 {
     // Resize framebuffer count to equal swap chain image count
@@ -773,6 +1282,7 @@ void VulkanRenderer::createCommandPool()
 
     VkCommandPoolCreateInfo poolInfo = {};
     poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;  // Command buffers are re-recorded one by one (e.g. when push constants change)
     poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;  // Queue Family type that buffers from this command pool will use
 
     // Create a Graphics Queue Family Command Pool
@@ -781,12 +1291,40 @@ void VulkanRenderer::createCommandPool()
     {
         throw std::runtime_error("Failed to create a Command Pool!");
     }
+
+    // Create a Transfer Queue Family Command Pool for uploads (short lived command buffers, recycled one by one)
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = queueFamilyIndices.transferFamily;
+
+    result = vkCreateCommandPool(m_mainDevice.logicalDevice, &poolInfo, nullptr, &m_transferCommandPool);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create the Transfer Command Pool!");
+    }
+
+    // Recording every frame: the command buffers of a frame in flight come from its own pool, reset as a whole before
+    // recording (short lived: transient, no reset of single buffers)
+    if (m_settings.recordEveryFrame)
+    {
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
+
+        m_frameCommandPools.resize(MAX_FRAME_DRAWS, VK_NULL_HANDLE);
+        for (size_t i = 0; i < MAX_FRAME_DRAWS; i++)
+        {
+            result = vkCreateCommandPool(m_mainDevice.logicalDevice, &poolInfo, nullptr, &m_frameCommandPools[i]);
+            if (result != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to create a Frame Command Pool!");
+            }
+        }
+    }
 }
 //------------------------------------------------------------------------------
 void VulkanRenderer::createCommandBuffers()
 {
-    // Resize command buffer count to have one for each framebuffer
-    m_commandBuffers.resize(m_swapChainFramebuffers.size());
+    // One command buffer for each framebuffer and frame in flight (each frame in flight binds its own uniform buffer)
+    m_commandBuffers.resize(m_swapChainFramebuffers.size() * MAX_FRAME_DRAWS);
 
     // N.B.: Not a Create but Allocate, because CommandBuffers are already there, we are just allocating them
     VkCommandBufferAllocateInfo cbAllocateInfo = {};
@@ -798,10 +1336,98 @@ void VulkanRenderer::createCommandBuffers()
     cbAllocateInfo.commandBufferCount = static_cast<uint32_t>(m_commandBuffers.size());
 
     // Allocate command buffers and place handles in array of buffers
-    VkResult result = vkAllocateCommandBuffers(m_mainDevice.logicalDevice, &cbAllocateInfo, m_commandBuffers.data());
-    if (result != VK_SUCCESS)
+    VkResult result = VK_SUCCESS;
+    if (m_settings.recordEveryFrame)
+    {
+        // Those of frame in flight 'frame' ([image][frame]) from the pool of that frame
+        std::vector<VkCommandBuffer> frameCommandBuffers(m_swapChainFramebuffers.size());
+        cbAllocateInfo.commandBufferCount = static_cast<uint32_t>(frameCommandBuffers.size());
+        for (size_t frame = 0; frame < MAX_FRAME_DRAWS; frame++)
+        {
+            cbAllocateInfo.commandPool = m_frameCommandPools[frame];
+            result = vkAllocateCommandBuffers(m_mainDevice.logicalDevice, &cbAllocateInfo, frameCommandBuffers.data());
+            if (result != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to allocate Command Buffers!");
+            }
+
+            for (size_t image = 0; image < frameCommandBuffers.size(); image++)
+            {
+                m_commandBuffers[image * MAX_FRAME_DRAWS + frame] = frameCommandBuffers[image];
+            }
+        }
+        cbAllocateInfo.commandBufferCount = static_cast<uint32_t>(m_commandBuffers.size());
+    }
+    else
+    {
+        result = vkAllocateCommandBuffers(m_mainDevice.logicalDevice, &cbAllocateInfo, m_commandBuffers.data());
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to allocate Command Buffers!");
+        }
+    }
+
+    // Cached static draws: a static and a dynamic secondary command buffer for every primary one
+    // (from the graphics pool: re-recorded one by one, on the render thread only)
+    if (m_settings.cacheStaticDraws)
+    {
+        std::vector<VkCommandBuffer> secondaryCommandBuffers(m_commandBuffers.size() * 2);
+        cbAllocateInfo.commandPool = m_graphicsCommandPool;
+        cbAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        cbAllocateInfo.commandBufferCount = static_cast<uint32_t>(secondaryCommandBuffers.size());
+        result = vkAllocateCommandBuffers(m_mainDevice.logicalDevice, &cbAllocateInfo, secondaryCommandBuffers.data());
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to allocate Secondary Command Buffers!");
+        }
+
+        m_staticDrawCaches.resize(m_commandBuffers.size());
+        m_dynamicCommandBuffers.resize(m_commandBuffers.size());
+        for (size_t i = 0; i < m_commandBuffers.size(); i++)
+        {
+            m_staticDrawCaches[i].commandBuffer = secondaryCommandBuffers[i * 2];
+            m_dynamicCommandBuffers[i] = secondaryCommandBuffers[i * 2 + 1];
+        }
+        cbAllocateInfo.commandBufferCount = static_cast<uint32_t>(m_commandBuffers.size());
+    }
+
+    if (!m_settings.parallelRecording)
+    {
+        return;
+    }
+
+    // Parallel recording: one slice of the draws per thread of the pool, plus the calling thread. Each slice has its own
+    // pool (command pools are externally synchronized), with a secondary command buffer for every primary one
+    QueueFamilyIndices queueFamilyIndices = getQueueFamilies(m_mainDevice.physicalDevice);
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;  // Re-recorded with their primary command buffer
+    poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
+
+    uint32_t sliceCount = m_threadPool.getThreadCount() + 1;
+    m_recordingCommandPools.resize(sliceCount, VK_NULL_HANDLE);
+    m_secondaryCommandBuffers.resize(m_commandBuffers.size() * sliceCount);
+    std::vector<VkCommandBuffer> sliceCommandBuffers(m_commandBuffers.size());
+    for (uint32_t slice = 0; slice < sliceCount; slice++)
     {
-        throw std::runtime_error("Failed to allocate Command Buffers!");
+        result = vkCreateCommandPool(m_mainDevice.logicalDevice, &poolInfo, nullptr, &m_recordingCommandPools[slice]);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create a Recording Command Pool!");
+        }
+
+        cbAllocateInfo.commandPool = m_recordingCommandPools[slice];
+        cbAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        result = vkAllocateCommandBuffers(m_mainDevice.logicalDevice, &cbAllocateInfo, sliceCommandBuffers.data());
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to allocate Secondary Command Buffers!");
+        }
+
+        for (size_t i = 0; i < sliceCommandBuffers.size(); i++)
+        {
+            m_secondaryCommandBuffers[i * sliceCount + slice] = sliceCommandBuffers[i];
+        }
     }
 }
 //------------------------------------------------------------------------------
@@ -834,34 +1460,96 @@ void VulkanRenderer::createSynchronisation()
 //------------------------------------------------------------------------------
 void VulkanRenderer::createUniformBuffers()
 {
-    // Buffer size will be size of all three variables (will offset to access)
-    VkDeviceSize bufferSize = sizeof(MVP);
+    // ViewProjection buffer size will be size of both matrices (will offset to access)
+    VkDeviceSize vpBufferSize = sizeof(UboViewProjection);
+
+    // Model matrices are placed at dynamic offsets, which must be multiples of minUniformBufferOffsetAlignment (a power of two)
+    m_modelUniformAlignment = (sizeof(UboModel) + m_minUniformBufferOffset - 1) & ~(m_minUniformBufferOffset - 1);
+    VkDeviceSize modelBufferSize = m_modelUniformAlignment * MAX_OBJECTS;
+
+    // Storage buffer Model matrices are tightly packed (std430 mat4 array), the indirect buffer ends with the draw count
+    VkDeviceSize modelStorageBufferSize = sizeof(UboModel) * MAX_OBJECTS;
+    VkDeviceSize drawIndirectBufferSize = DRAW_COUNT_OFFSET + sizeof(uint32_t);
+    VkDeviceSize cullObjectBufferSize = m_settings.clusterCulling ?
+        sizeof(CullCluster) * MAX_CLUSTERS + sizeof(CullNormalMatrix) * MAX_OBJECTS : sizeof(CullObject) * MAX_OBJECTS;
+
+    // One set of uniform buffers for each frame in flight: a frame can't start before the previous user of its slot has finished
+    // (draw fence), while there may be more swapchain images than frames in flight
+    m_vpUniformBuffer.resize(MAX_FRAME_DRAWS);
+    m_vpUniformBufferMemory.resize(MAX_FRAME_DRAWS);
+    m_vpUniformBufferVersion.assign(MAX_FRAME_DRAWS, 0);        // 0: never written (versions start from 1)
+    m_modelDynUniformBuffer.resize(MAX_FRAME_DRAWS);
+    m_modelDynUniformBufferMemory.resize(MAX_FRAME_DRAWS);
+    m_modelDynUniformBufferVersion.assign(MAX_FRAME_DRAWS, 0);
+    m_modelStorageBuffer.resize(MAX_FRAME_DRAWS);
+    m_modelStorageBufferMemory.resize(MAX_FRAME_DRAWS);
+    m_modelStorageBufferVersion.assign(MAX_FRAME_DRAWS, 0);
+    m_modelDirtyObjects.assign(MAX_FRAME_DRAWS, std::vector<uint32_t>());
+    m_drawIndirectBuffer.resize(MAX_FRAME_DRAWS);
+    m_drawIndirectBufferMemory.resize(MAX_FRAME_DRAWS);
+    m_drawIndirectBufferVersion.assign(MAX_FRAME_DRAWS, 0);
+    m_cullObjectBuffer.resize(MAX_FRAME_DRAWS);
+    m_cullObjectBufferMemory.resize(MAX_FRAME_DRAWS);
+    m_cullObjectBufferVersion.assign(MAX_FRAME_DRAWS, 0);
+    m_cullNormalMatrixVersion.assign(MAX_FRAME_DRAWS, 0);
+
+    // Create Uniform buffers (host visible memory stays mapped for the whole life of the renderer, see DeviceMemoryAllocator)
+    for (size_t i = 0; i < MAX_FRAME_DRAWS; i++)
+    {
+        createBuffer(m_mainDevice.logicalDevice, &m_allocator, vpBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &m_vpUniformBuffer[i], &m_vpUniformBufferMemory[i]);
 
-    // One uniform buffer for each image (and by extension, command buffer)
-    m_uniformBuffer.resize(m_swapchainImages.size());
-    m_uniformBufferMemory.resize(m_swapchainImages.size());
+        createBuffer(m_mainDevice.logicalDevice, &m_allocator, modelBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &m_modelDynUniformBuffer[i], &m_modelDynUniformBufferMemory[i]);
 
-    // Create Uniform buffers
-    for (size_t i = 0; i < m_swapchainImages.size(); i++)
-    {
-        createBuffer(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice, bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &m_uniformBuffer[i], &m_uniformBufferMemory[i]);
+        createBuffer(m_mainDevice.logicalDevice, &m_allocator, modelStorageBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &m_modelStorageBuffer[i], &m_modelStorageBufferMemory[i]);
+
+        // Written by the CPU, or by the culling compute shader (storage) after clearing the draw count (transfer)
+        createBuffer(m_mainDevice.logicalDevice, &m_allocator, drawIndirectBufferSize,
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &m_drawIndirectBuffer[i], &m_drawIndirectBufferMemory[i]);
+
+        createBuffer(m_mainDevice.logicalDevice, &m_allocator, cullObjectBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &m_cullObjectBuffer[i], &m_cullObjectBufferMemory[i]);
     }
 }
 //------------------------------------------------------------------------------
 void VulkanRenderer::createDescriptorPool()
 {
     // Type of descriptors + how many DESCRIPTORS, not Descriptor Sets (combined makes the pool size)
-    VkDescriptorPoolSize poolSize = {};
-    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSize.descriptorCount = static_cast<uint32_t>(m_uniformBuffer.size());
+    // ViewProjection Pool
+    VkDescriptorPoolSize vpPoolSize = {};
+    vpPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    vpPoolSize.descriptorCount = static_cast<uint32_t>(m_vpUniformBuffer.size());
+
+    // Model Pool (DYNAMIC)
+    VkDescriptorPoolSize modelPoolSize = {};
+    modelPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    modelPoolSize.descriptorCount = static_cast<uint32_t>(m_modelDynUniformBuffer.size());
+
+    // Model Pool (STORAGE)
+    VkDescriptorPoolSize modelStoragePoolSize = {};
+    modelStoragePoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    modelStoragePoolSize.descriptorCount = static_cast<uint32_t>(m_modelStorageBuffer.size());
+
+    // Culling sets (one per frame in flight): ViewProjection + 4 storage buffers
+    VkDescriptorPoolSize cullUniformPoolSize = {};
+    cullUniformPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    cullUniformPoolSize.descriptorCount = static_cast<uint32_t>(m_cullObjectBuffer.size());
+
+    VkDescriptorPoolSize cullStoragePoolSize = {};
+    cullStoragePoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    cullStoragePoolSize.descriptorCount = static_cast<uint32_t>(m_cullObjectBuffer.size() * 4);
+
+    std::vector<VkDescriptorPoolSize> descriptorPoolSizes = { vpPoolSize, modelPoolSize, modelStoragePoolSize, cullUniformPoolSize, cullStoragePoolSize };
 
     // Data to create Descriptor Pool
     VkDescriptorPoolCreateInfo poolCreateInfo = {};
     poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolCreateInfo.maxSets = static_cast<uint32_t>(m_uniformBuffer.size()); // Maximum number of Descriptor Sets that can be created from pool
-    poolCreateInfo.poolSizeCount = 1;                                       // Amount of Pool Sizes being passed
-    poolCreateInfo.pPoolSizes = &poolSize;                                  // Pool Sizes to create pool with
+    poolCreateInfo.maxSets = static_cast<uint32_t>(m_vpUniformBuffer.size() + m_cullObjectBuffer.size());  // Maximum number of Descriptor Sets that can be created from pool
+    poolCreateInfo.poolSizeCount = static_cast<uint32_t>(descriptorPoolSizes.size());       // Amount of Pool Sizes being passed
+    poolCreateInfo.pPoolSizes = descriptorPoolSizes.data();                                 // Pool Sizes to create pool with
 
     // Create Descriptor Pool
     VkResult result = vkCreateDescriptorPool(m_mainDevice.logicalDevice, &poolCreateInfo, nullptr, &m_descriptorPool);
@@ -873,16 +1561,16 @@ void VulkanRenderer::createDescriptorPool()
 //------------------------------------------------------------------------------
 void VulkanRenderer::createDescriptorSets()
 {
-    // Resize Descriptor Set list so one for every uniform buffer
-    m_descriptorSets.resize(m_uniformBuffer.size());
+    // Resize Descriptor Set list so one for every frame in flight (i.e. every set of uniform buffers)
+    m_descriptorSets.resize(m_vpUniformBuffer.size());
 
-    std::vector<VkDescriptorSetLayout> setLayouts(m_uniformBuffer.size(), m_descriptorSetLayout);
+    std::vector<VkDescriptorSetLayout> setLayouts(m_vpUniformBuffer.size(), m_descriptorSetLayout);
 
     // Descriptor Set Allocation Info
     VkDescriptorSetAllocateInfo setAllocInfo = {};
     setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     setAllocInfo.descriptorPool = m_descriptorPool;                                     // Pool to allocate Descriptor Set from
-    setAllocInfo.descriptorSetCount = static_cast<uint32_t>(m_uniformBuffer.size());    // Number of sets to allocate
+    setAllocInfo.descriptorSetCount = static_cast<uint32_t>(m_vpUniformBuffer.size());  // Number of sets to allocate
     setAllocInfo.pSetLayouts = setLayouts.data();                                       // Layouts to use to allocate sets (1:1 relationship)
 
     // Allocate descriptor sets (multiple)
@@ -893,49 +1581,561 @@ void VulkanRenderer::createDescriptorSets()
     }
 
     // Update all of descriptor sets uniform buffer bindings
-    for (size_t i = 0; i < m_uniformBuffer.size(); i++)
+    for (size_t i = 0; i < m_vpUniformBuffer.size(); i++)
     {
+        // VIEW PROJECTION DESCRIPTOR
         // Buffer info and data offset info
-        VkDescriptorBufferInfo mvpBufferInfo = {};
-        mvpBufferInfo.buffer = m_uniformBuffer[i];  // Buffer to get data from
-        mvpBufferInfo.offset = 0;                   // Position of start of data
-        mvpBufferInfo.range = sizeof(MVP);          // Size of data
+        VkDescriptorBufferInfo vpBufferInfo = {};
+        vpBufferInfo.buffer = m_vpUniformBuffer[i];         // Buffer to get data from
+        vpBufferInfo.offset = 0;                            // Position of start of data
+        vpBufferInfo.range = sizeof(UboViewProjection);     // Size of data
 
         // Data about connection between binding and buffer
-        VkWriteDescriptorSet mvpSetWrite = {};
-        mvpSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        mvpSetWrite.dstSet = m_descriptorSets[i];                           // Descriptor Set to update
-        mvpSetWrite.dstBinding = 0;                                         // Binding to update (matches with binding on layout/shader)
-        mvpSetWrite.dstArrayElement = 0;                                    // Index in array to update
-        mvpSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;     // Type of descriptor
-        mvpSetWrite.descriptorCount = 1;                                    // Amount of descriptor set to update
-        mvpSetWrite.pBufferInfo = &mvpBufferInfo;                           // Information about buffer data to bind
+        VkWriteDescriptorSet vpSetWrite = {};
+        vpSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        vpSetWrite.dstSet = m_descriptorSets[i];                            // Descriptor Set to update
+        vpSetWrite.dstBinding = 0;                                          // Binding to update (matches with binding on layout/shader)
+        vpSetWrite.dstArrayElement = 0;                                     // Index in array to update
+        vpSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;      // Type of descriptor
+        vpSetWrite.descriptorCount = 1;                                     // Amount of descriptor set to update
+        vpSetWrite.pBufferInfo = &vpBufferInfo;                             // Information about buffer data to bind
+
+        // MODEL DESCRIPTOR
+        // Model Buffer Binding Info: range is a single object, the dynamic offset selects which one
+        VkDescriptorBufferInfo modelBufferInfo = {};
+        modelBufferInfo.buffer = m_modelDynUniformBuffer[i];
+        modelBufferInfo.offset = 0;
+        modelBufferInfo.range = m_modelUniformAlignment;
+
+        VkWriteDescriptorSet modelSetWrite = {};
+        modelSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        modelSetWrite.dstSet = m_descriptorSets[i];
+        modelSetWrite.dstBinding = 1;
+        modelSetWrite.dstArrayElement = 0;
+        modelSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        modelSetWrite.descriptorCount = 1;
+        modelSetWrite.pBufferInfo = &modelBufferInfo;
+
+        // MODEL STORAGE DESCRIPTOR
+        // Whole array of Model matrices
+        VkDescriptorBufferInfo modelStorageBufferInfo = {};
+        modelStorageBufferInfo.buffer = m_modelStorageBuffer[i];
+        modelStorageBufferInfo.offset = 0;
+        modelStorageBufferInfo.range = VK_WHOLE_SIZE;
+
+        VkWriteDescriptorSet modelStorageSetWrite = {};
+        modelStorageSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        modelStorageSetWrite.dstSet = m_descriptorSets[i];
+        modelStorageSetWrite.dstBinding = 2;
+        modelStorageSetWrite.dstArrayElement = 0;
+        modelStorageSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        modelStorageSetWrite.descriptorCount = 1;
+        modelStorageSetWrite.pBufferInfo = &modelStorageBufferInfo;
+
+        // List of Descriptor Set Writes
+        std::vector<VkWriteDescriptorSet> setWrites = { vpSetWrite, modelSetWrite, modelStorageSetWrite };
 
         // Update the descriptor sets with new buffer/binding info
-        vkUpdateDescriptorSets(m_mainDevice.logicalDevice, 1, &mvpSetWrite, 0, nullptr);
+        vkUpdateDescriptorSets(m_mainDevice.logicalDevice, static_cast<uint32_t>(setWrites.size()), setWrites.data(), 0, nullptr);
     }
-}
 
-//------------------------------------------------------------------------------
-void VulkanRenderer::updateUniformBuffer(uint32_t imageIndex)
-{
-    void* data;
-    vkMapMemory(m_mainDevice.logicalDevice, m_uniformBufferMemory[imageIndex], 0, sizeof(MVP), 0, &data);
-    memcpy(data, &m_mvp, sizeof(MVP));
-    vkUnmapMemory(m_mainDevice.logicalDevice, m_uniformBufferMemory[imageIndex]);
+    // Culling Descriptor Sets (one for every frame in flight, same buffers as the graphics ones)
+    m_cullDescriptorSets.resize(m_cullObjectBuffer.size());
+
+    std::vector<VkDescriptorSetLayout> cullSetLayouts(m_cullObjectBuffer.size(), m_cullDescriptorSetLayout);
+    setAllocInfo.descriptorSetCount = static_cast<uint32_t>(m_cullObjectBuffer.size());
+    setAllocInfo.pSetLayouts = cullSetLayouts.data();
+
+    result = vkAllocateDescriptorSets(m_mainDevice.logicalDevice, &setAllocInfo, m_cullDescriptorSets.data());
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate the Culling Descriptor Sets!");
+    }
+
+    for (size_t i = 0; i < m_cullObjectBuffer.size(); i++)
+    {
+        // Draw commands and draw count are two views of the same indirect buffer (DRAW_COUNT_OFFSET is 256 bytes aligned)
+        VkDescriptorBufferInfo bufferInfos[5] = {
+            { m_vpUniformBuffer[i],     0,                  sizeof(UboViewProjection) },
+            { m_cullObjectBuffer[i],    0,                  VK_WHOLE_SIZE },
+            { m_modelStorageBuffer[i],  0,                  VK_WHOLE_SIZE },
+            { m_drawIndirectBuffer[i],  0,                  DRAW_COUNT_OFFSET },
+            { m_drawIndirectBuffer[i],  DRAW_COUNT_OFFSET,  sizeof(uint32_t) }
+        };
+
+        std::vector<VkWriteDescriptorSet> setWrites(ARRAY_SIZE(bufferInfos));
+        for (uint32_t binding = 0; binding < setWrites.size(); binding++)
+        {
+            setWrites[binding] = {};
+            setWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            setWrites[binding].dstSet = m_cullDescriptorSets[i];
+            setWrites[binding].dstBinding = binding;
+            setWrites[binding].dstArrayElement = 0;
+            setWrites[binding].descriptorType = (binding == 0) ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            setWrites[binding].descriptorCount = 1;
+            setWrites[binding].pBufferInfo = &bufferInfos[binding];
+        }
+
+        vkUpdateDescriptorSets(m_mainDevice.logicalDevice, static_cast<uint32_t>(setWrites.size()), setWrites.data(), 0, nullptr);
+    }
 }
 
 //------------------------------------------------------------------------------
-void VulkanRenderer::recordCommands()
+void VulkanRenderer::updateUniformBuffers(uint32_t frameIndex)
 {
-    // Information about how to begin each command buffer
-    VkCommandBufferBeginInfo bufferBeginInfo = {};
-    bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;   // Buffer can be resubmitted when it has already been submitted and is awaiting execution
+    // Uniform buffer memory is host visible, so the allocator already keeps it mapped.
+    // Slots already holding the current data are skipped
+    if (m_vpUniformBufferVersion[frameIndex] != m_viewProjectionVersion)
+    {
+        memcpy(m_vpUniformBufferMemory[frameIndex].mappedData, &m_uboViewProjection, sizeof(UboViewProjection));
+        m_vpUniformBufferVersion[frameIndex] = m_viewProjectionVersion;
 
-    // Information about how to begin a render pass (only needed for graphical applications)
-    VkRenderPassBeginInfo renderPassBeginInfo = {};
-    renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        m_frameStatistics.uniformBytesWritten += sizeof(UboViewProjection);
+    }
+
+    // With push constants the Model matrices are recorded in the command buffers instead.
+    // A current buffer may still miss the objects moved by the transform hierarchy while it was in flight: only these
+    // are written then
+    std::vector<uint32_t> &dirtyObjects = m_modelDirtyObjects[frameIndex];
+    if (m_settings.modelTransfer == ModelTransfer::DynamicUniform)
+    {
+        // Model matrices are m_modelUniformAlignment apart (the dynamic offset of each object)
+        char * modelData = static_cast<char *>(m_modelDynUniformBufferMemory[frameIndex].mappedData);
+        if (m_modelDynUniformBufferVersion[frameIndex] != m_modelVersion)
+        {
+            size_t objectCount = std::min(m_meshList.size(), static_cast<size_t>(MAX_OBJECTS));
+            for (size_t i = 0; i < objectCount; i++)
+            {
+                UboModel uboModel = m_meshList[i].getModel();
+                memcpy(modelData + i * m_modelUniformAlignment, &uboModel, sizeof(UboModel));
+            }
+            m_modelDynUniformBufferVersion[frameIndex] = m_modelVersion;
+
+            m_frameStatistics.uniformBytesWritten += objectCount * sizeof(UboModel);
+        }
+        else
+        {
+            for (uint32_t objectIdx : dirtyObjects)
+            {
+                glm::mat4 model = m_meshList[objectIdx].getModel().model;
+                memcpy(modelData + objectIdx * m_modelUniformAlignment + offsetof(UboModel, model), &model, sizeof(glm::mat4));
+            }
+            m_frameStatistics.uniformBytesWritten += dirtyObjects.size() * sizeof(glm::mat4);
+        }
+    }
+
+    if (m_settings.modelTransfer == ModelTransfer::StorageBuffer)
+    {
+        // Model matrices are tightly packed, at the index of their object (the firstInstance of its draw)
+        UboModel * modelData = static_cast<UboModel *>(m_modelStorageBufferMemory[frameIndex].mappedData);
+        if (m_modelStorageBufferVersion[frameIndex] != m_modelVersion)
+        {
+            size_t objectCount = std::min(m_meshList.size(), static_cast<size_t>(MAX_OBJECTS));
+            for (size_t i = 0; i < objectCount; i++)
+            {
+                modelData[i] = m_meshList[i].getModel();
+            }
+            m_modelStorageBufferVersion[frameIndex] = m_modelVersion;
+
+            m_frameStatistics.uniformBytesWritten += objectCount * sizeof(UboModel);
+        }
+        else
+        {
+            for (uint32_t objectIdx : dirtyObjects)
+            {
+                modelData[objectIdx].model = m_meshList[objectIdx].getModel().model;
+            }
+            m_frameStatistics.uniformBytesWritten += dirtyObjects.size() * sizeof(glm::mat4);
+        }
+    }
+    dirtyObjects.clear();
+}
+//------------------------------------------------------------------------------
+void VulkanRenderer::updateDrawIndirectCommands(uint32_t frameIndex)
+{
+    // The draw list changes only when meshes are added or removed (a Model matrix change doesn't touch it)
+    if (m_drawIndirectBufferVersion[frameIndex] == m_drawListVersion)
+    {
+        return;
+    }
+
+    // One command per mesh, then the draw count read by vkCmdDrawIndexedIndirectCount
+    char * indirectData = static_cast<char *>(m_drawIndirectBufferMemory[frameIndex].mappedData);
+    VkDrawIndexedIndirectCommand * drawCommands = reinterpret_cast<VkDrawIndexedIndirectCommand *>(indirectData);
+    uint32_t drawCount = getIndirectDrawCount();
+    for (uint32_t i = 0; i < drawCount; i++)
+    {
+        uint32_t meshIdx = m_settings.cpuCulling ? m_visibleMeshes[i] : i;     // Only the visible meshes with CPU culling
+        MeshLod meshLod = getSelectedLod(meshIdx);
+        drawCommands[i].indexCount = meshLod.indexCount;
+        drawCommands[i].instanceCount = 1;
+        drawCommands[i].firstIndex = meshLod.firstIndex;
+        drawCommands[i].vertexOffset = m_meshList[meshIdx].getVertexOffset();
+        drawCommands[i].firstInstance = meshIdx;    // Index of the Model matrix in the storage buffer
+    }
+    memcpy(indirectData + DRAW_COUNT_OFFSET, &drawCount, sizeof(uint32_t));
+    m_drawIndirectBufferVersion[frameIndex] = m_drawListVersion;
+
+    m_frameStatistics.uniformBytesWritten += drawCount * sizeof(VkDrawIndexedIndirectCommand) + sizeof(uint32_t);
+}
+//------------------------------------------------------------------------------
+void VulkanRenderer::updateCullObjects(uint32_t frameIndex)
+{
+    // Like the draw commands, the culling input only changes with the draw list (Model matrices come from their own buffer)
+    if (m_cullObjectBufferVersion[frameIndex] == m_drawListVersion)
+    {
+        return;
+    }
+
+    CullObject * cullObjects = static_cast<CullObject *>(m_cullObjectBufferMemory[frameIndex].mappedData);
+    size_t objectCount = std::min(m_meshList.size(), static_cast<size_t>(MAX_OBJECTS));
+    for (size_t i = 0; i < objectCount; i++)
+    {
+        cullObjects[i].boundingSphere = m_meshList[i].getBoundingSphere();
+        for (uint32_t lod = 0; lod < MAX_MESH_LODS; lod++)
+        {
+            MeshLod meshLod = m_meshList[i].getLod(lod);    // Past the last LOD: the last one again
+            cullObjects[i].lodIndexCount[lod] = meshLod.indexCount;
+            cullObjects[i].lodFirstIndex[lod] = meshLod.firstIndex;
+            cullObjects[i].lodError[lod] = meshLod.error;
+        }
+        cullObjects[i].vertexOffset = m_meshList[i].getVertexOffset();
+        cullObjects[i].lodCount = m_meshList[i].getLodCount();
+        cullObjects[i].padding[0] = 0;
+        cullObjects[i].padding[1] = 0;
+    }
+    m_cullObjectBufferVersion[frameIndex] = m_drawListVersion;
+
+    m_frameStatistics.uniformBytesWritten += objectCount * sizeof(CullObject);
+}
+//------------------------------------------------------------------------------
+void VulkanRenderer::updateCullClusters(uint32_t frameIndex)
+{
+    CullCluster * cullClusters = static_cast<CullCluster *>(m_cullObjectBufferMemory[frameIndex].mappedData);
+    size_t objectCount = std::min(m_meshList.size(), static_cast<size_t>(MAX_OBJECTS));
+
+    // Normal matrices of the cone axes, one per object (its clusters share it), after the clusters
+    if (m_cullNormalMatrixVersion[frameIndex] != m_modelVersion)
+    {
+        CullNormalMatrix * normalMatrices = reinterpret_cast<CullNormalMatrix *>(cullClusters + MAX_CLUSTERS);
+        for (size_t i = 0; i < objectCount; i++)
+        {
+            glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(m_meshList[i].getModel().model)));
+            for (int column = 0; column < 3; column++)
+            {
+                normalMatrices[i].columns[column] = glm::vec4(normalMatrix[column], 0.0f);
+            }
+        }
+        m_cullNormalMatrixVersion[frameIndex] = m_modelVersion;
+
+        m_frameStatistics.uniformBytesWritten += objectCount * sizeof(CullNormalMatrix);
+    }
+
+    // Like the culling objects, the clusters only change with the draw list
+    if (m_cullObjectBufferVersion[frameIndex] == m_drawListVersion)
+    {
+        return;
+    }
+
+    // Meshlets of all the meshes, one after the other (same order as getIndirectDrawCount() counts them)
+    size_t clusterCount = 0;
+    for (size_t meshIdx = 0; meshIdx < objectCount; meshIdx++)
+    {
+        Mesh &mesh = m_meshList[meshIdx];
+        for (uint32_t i = 0; i < mesh.getMeshletCount() && clusterCount < MAX_CLUSTERS; i++)
+        {
+            Meshlet meshlet = mesh.getMeshlet(i);
+            CullCluster &cullCluster = cullClusters[clusterCount++];
+            cullCluster.boundingSphere = meshlet.boundingSphere;
+            cullCluster.normalCone = meshlet.normalCone;
+            cullCluster.indexCount = meshlet.indexCount;
+            cullCluster.firstIndex = meshlet.firstIndex;
+            cullCluster.vertexOffset = mesh.getVertexOffset();
+            cullCluster.objectIndex = static_cast<uint32_t>(meshIdx);
+        }
+    }
+    m_cullObjectBufferVersion[frameIndex] = m_drawListVersion;
+
+    m_frameStatistics.uniformBytesWritten += clusterCount * sizeof(CullCluster);
+}
+//------------------------------------------------------------------------------
+void VulkanRenderer::updateLodSelection()
+{
+    // The LODs only depend on the Model matrices and the camera
+    if (m_lodSelectionModelVersion == m_modelVersion && m_lodSelectionViewProjectionVersion == m_viewProjectionVersion &&
+        m_meshLodSelection.size() == m_meshList.size())
+    {
+        return;
+    }
+
+    m_meshLodSelection.resize(m_meshList.size(), 0);
+
+    bool selectionChanged = false;
+    uint64_t selectedTriangles = 0;
+    for (size_t i = 0; i < m_meshList.size(); i++)
+    {
+        uint32_t lod = chooseMeshLod(m_meshList[i]);
+        selectionChanged = selectionChanged || (lod != m_meshLodSelection[i]);
+        m_meshLodSelection[i] = lod;
+        selectedTriangles += m_meshList[i].getLod(lod).indexCount / 3;
+    }
+    m_frameStatistics.selectedTriangles = selectedTriangles;
+
+    // Other index ranges to draw: rewrite the indirect commands / re-record the direct draws
+    if (selectionChanged)
+    {
+        m_drawListVersion++;
+    }
+
+    m_lodSelectionModelVersion = m_modelVersion;
+    m_lodSelectionViewProjectionVersion = m_viewProjectionVersion;
+}
+
+//------------------------------------------------------------------------------
+void VulkanRenderer::updateTransforms()
+{
+    // Moving meshes leave the cached static draws (see setMeshDynamic(), sized up front: written by the pool)
+    bool trackDynamicMeshes = (m_settings.cacheStaticDraws && m_settings.modelTransfer == ModelTransfer::PushConstant);
+    if (trackDynamicMeshes)
+    {
+        m_meshDynamic.resize(m_meshList.size(), 0);
+    }
+    std::atomic<bool> dynamicSetChanged(false);
+
+    // The model buffer of this frame is written in place when it is current otherwise (its previous reader has finished:
+    // the fence was waited for), instead of being rewritten as a whole by updateUniformBuffers()
+    std::vector<uint64_t> * bufferVersions = nullptr;
+    if (m_settings.modelTransfer == ModelTransfer::DynamicUniform)
+    {
+        bufferVersions = &m_modelDynUniformBufferVersion;
+    }
+    else if (m_settings.modelTransfer == ModelTransfer::StorageBuffer)
+    {
+        bufferVersions = &m_modelStorageBufferVersion;
+    }
+    bool writeInPlace = (bufferVersions != nullptr && (*bufferVersions)[m_currentFrame] == m_modelVersion);
+    char * dynUniformData = static_cast<char *>(m_modelDynUniformBufferMemory[m_currentFrame].mappedData);
+    UboModel * storageData = static_cast<UboModel *>(m_modelStorageBufferMemory[m_currentFrame].mappedData);
+
+    // World matrices of the changed subtrees, straight into the Model matrices read by the push constants and the
+    // culling, and into the model buffer of this frame (one node per mesh: the ranges of the pool never write the same
+    // mesh nor the same slot of m_transformChangedObjects)
+    m_transformChangedObjects.resize(m_meshList.size());
+    std::atomic<uint32_t> changedCount(0);
+    uint32_t changedObjects = m_transformHierarchy.update(&m_threadPool, [&](int32_t objectIndex, const glm::mat4 &world) {
+        m_meshList[objectIndex].setModel(world);
+        m_transformChangedObjects[changedCount++] = static_cast<uint32_t>(objectIndex);
+        if (writeInPlace && objectIndex < static_cast<int32_t>(MAX_OBJECTS))
+        {
+            if (m_settings.modelTransfer == ModelTransfer::DynamicUniform)
+            {
+                memcpy(dynUniformData + objectIndex * m_modelUniformAlignment + offsetof(UboModel, model), &world, sizeof(glm::mat4));
+            }
+            else
+            {
+                storageData[objectIndex].model = world;
+            }
+        }
+        if (trackDynamicMeshes && m_meshDynamic[objectIndex] == 0)
+        {
+            m_meshDynamic[objectIndex] = 1;
+            dynamicSetChanged = true;
+        }
+    });
+
+    if (dynamicSetChanged)
+    {
+        m_dynamicSetVersion++;
+    }
+    if (changedObjects == 0)
+    {
+        return;
+    }
+
+    uint64_t previousModelVersion = m_modelVersion;
+    m_modelVersion++;
+    if (bufferVersions == nullptr)
+    {
+        return;
+    }
+
+    // The buffers that were current stay current: this frame's has been written, the other frames in flight write the
+    // changed objects when they come around (a stale buffer is rewritten as a whole anyway)
+    for (uint32_t frameIdx = 0; frameIdx < MAX_FRAME_DRAWS; frameIdx++)
+    {
+        if ((*bufferVersions)[frameIdx] != previousModelVersion)
+        {
+            continue;
+        }
+
+        if (frameIdx == m_currentFrame)
+        {
+            m_frameStatistics.uniformBytesWritten += changedObjects * sizeof(glm::mat4);
+        }
+        else
+        {
+            // Past the object count, the whole buffer costs less than the list: left stale
+            std::vector<uint32_t> &dirtyObjects = m_modelDirtyObjects[frameIdx];
+            if (dirtyObjects.size() + changedObjects > m_meshList.size())
+            {
+                dirtyObjects.clear();
+                continue;
+            }
+            for (uint32_t i = 0; i < changedObjects; i++)
+            {
+                if (m_transformChangedObjects[i] < static_cast<uint32_t>(MAX_OBJECTS))
+                {
+                    dirtyObjects.push_back(m_transformChangedObjects[i]);
+                }
+            }
+        }
+        (*bufferVersions)[frameIdx] = m_modelVersion;
+    }
+}
+//------------------------------------------------------------------------------
+void VulkanRenderer::updateCpuCulling()
+{
+    // Visibility only depends on the Model matrices, the camera and the mesh list
+    bool meshListChanged = (m_frustumCuller.getObjectCount() != m_meshList.size());
+    if (!meshListChanged && m_cpuCullingModelVersion == m_modelVersion && m_cpuCullingViewProjectionVersion == m_viewProjectionVersion)
+    {
+        return;
+    }
+
+    // World space bounding spheres (the radius follows the largest scale of the Model matrix, like the culling shaders)
+    if (meshListChanged || m_cpuCullingModelVersion != m_modelVersion)
+    {
+        m_frustumCuller.resize(static_cast<uint32_t>(m_meshList.size()));
+        for (uint32_t i = 0; i < static_cast<uint32_t>(m_meshList.size()); i++)
+        {
+            glm::mat4 model = m_meshList[i].getModel().model;
+            glm::vec4 boundingSphere = m_meshList[i].getBoundingSphere();
+            glm::vec3 center = glm::vec3(model * glm::vec4(glm::vec3(boundingSphere), 1.0f));
+            float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+            m_frustumCuller.setSphere(i, glm::vec4(center, boundingSphere.w * scale));
+        }
+        m_cpuCullingModelVersion = m_modelVersion;
+    }
+
+    std::swap(m_previousVisibleMeshes, m_visibleMeshes);
+    m_frustumCuller.cull(m_uboViewProjection.projection * m_uboViewProjection.view, m_visibleMeshes);
+    m_cpuCullingViewProjectionVersion = m_viewProjectionVersion;
+
+    m_frameStatistics.submittedObjects = m_meshList.size();
+    m_frameStatistics.visibleObjects = m_visibleMeshes.size();
+
+    // Other meshes to draw: rewrite the indirect commands / re-record the direct draws
+    if (m_visibleMeshes != m_previousVisibleMeshes)
+    {
+        m_drawListVersion++;
+    }
+}
+//------------------------------------------------------------------------------
+void VulkanRenderer::updateStreaming()
+{
+    // Uploads completed (their batch fence is signalled): the meshes become drawable
+    size_t meshCount = m_meshList.size();
+    for (size_t i = 0; i < m_streamedUploads.size();)
+    {
+        if (!m_uploadBatcher.isComplete(m_streamedUploads[i].uploadTicket))
+        {
+            i++;
+            continue;
+        }
+
+        if (m_meshList.size() < MAX_OBJECTS)
+        {
+            m_meshList.push_back(m_streamedUploads[i].mesh);
+        }
+        else
+        {
+            cout << "Streamed mesh dropped: too many objects (MAX_OBJECTS)" << endl;
+            m_streamedUploads[i].mesh.destroyBuffers();     // Safe: the only use of its ranges was the completed upload
+        }
+        m_streamedUploads[i] = m_streamedUploads.back();
+        m_streamedUploads.pop_back();
+    }
+
+    m_frameStatistics.streamedMeshesAdded = m_meshList.size() - meshCount;
+    if (m_meshList.size() != meshCount)
+    {
+        m_drawListVersion++;
+        m_modelVersion++;       // Their Model matrices aren't in the buffers yet
+    }
+
+    // Next uploads, within the budget of a frame: the decoding is done, staging them is a copy per mesh
+    glm::vec3 cameraPosition = glm::vec3(glm::inverse(m_uboViewProjection.view)[3]);
+    std::vector<StreamedMesh> streamedMeshes = m_assetStreamer.takeDecoded(m_settings.streamingBytesPerFrame, cameraPosition);
+    if (!streamedMeshes.empty())
+    {
+        bool allowShortIndices = (m_settings.drawSubmission == DrawSubmission::Direct);
+        for (const auto &streamedMesh : streamedMeshes)
+        {
+            StreamedUpload streamedUpload;
+            streamedUpload.mesh = Mesh(&m_geometryPool, streamedMesh.getMeshData(), allowShortIndices);
+            streamedUpload.mesh.setModel(streamedMesh.model);
+            streamedUpload.uploadTicket = streamedUpload.mesh.getUploadTicket();
+            m_streamedUploads.push_back(streamedUpload);
+        }
+        m_uploadBatcher.flush();
+    }
+
+    m_frameStatistics.streamingMeshesPending = m_assetStreamer.getPendingCount() + m_streamedUploads.size();
+}
+//------------------------------------------------------------------------------
+void VulkanRenderer::recordCommands()
+{
+    // Every object needs its own slot in the dynamic uniform buffers
+    if (m_meshList.size() > MAX_OBJECTS)
+    {
+        throw std::runtime_error("Too many objects for the Model dynamic uniform buffers (MAX_OBJECTS)!");
+    }
+
+    m_commandBufferModelVersion.assign(m_commandBuffers.size(), 0);
+    m_commandBufferDrawListVersion.assign(m_commandBuffers.size(), 0);
+
+    // Called when something not versioned changes too (e.g. the instanced meshes)
+    for (auto &staticDrawCache : m_staticDrawCaches)
+    {
+        staticDrawCache.drawListVersion = 0;
+    }
+
+    // Recorded by draw() before each submission: only leave them in the initial state
+    // (N.B.: every caller waited for the device to be idle, none is pending)
+    if (m_settings.recordEveryFrame)
+    {
+        for (auto commandPool : m_frameCommandPools)
+        {
+            vkResetCommandPool(m_mainDevice.logicalDevice, commandPool, 0);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < m_commandBuffers.size(); i++)
+    {
+        recordCommandBuffer(i);
+    }
+}
+//------------------------------------------------------------------------------
+void VulkanRenderer::recordCommandBuffer(size_t commandBufferIdx)
+{
+    // Command buffers are laid out as [image][frame in flight]
+    size_t imageIdx = commandBufferIdx / MAX_FRAME_DRAWS;
+    size_t frameIdx = commandBufferIdx % MAX_FRAME_DRAWS;
+    VkCommandBuffer commandBuffer = m_commandBuffers[commandBufferIdx];
+
+    // Information about how to begin each command buffer
+    VkCommandBufferBeginInfo bufferBeginInfo = {};
+    bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;   // Buffer can be resubmitted when it has already been submitted and is awaiting execution
+    if (m_settings.recordEveryFrame)
+    {
+        bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;  // Submitted once, then reset with its pool (simultaneous use can be slower)
+    }
+
+    // Information about how to begin a render pass (only needed for graphical applications)
+    VkRenderPassBeginInfo renderPassBeginInfo = {};
+    renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassBeginInfo.renderPass = m_renderPass;                          // Render Pass to begin
     renderPassBeginInfo.renderArea.offset = { 0, 0 };                       // Start point of render pass in pixels
     renderPassBeginInfo.renderArea.extent = m_swapChainExtent;              // Size of region to run render pass on (starting at offset)
@@ -944,54 +2144,323 @@ void VulkanRenderer::recordCommands()
     };
     renderPassBeginInfo.pClearValues = clearValues;                         // List of clear values (TODO: Depth Attachment Clear Value)
     renderPassBeginInfo.clearValueCount = 1;
+    renderPassBeginInfo.framebuffer = m_swapChainFramebuffers[imageIdx];
 
-    for (size_t i = 0; i < m_commandBuffers.size(); i++)
+    // Start recording commands to command buffer! (implicitly resets it, the pool allows resetting single buffers)
+    VkResult result = vkBeginCommandBuffer(commandBuffer, &bufferBeginInfo);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to START recording a Command Buffer!");
+    }
+
+        // GPU culling writes the draw commands read by the render pass (N.B.: compute can't run inside a render pass)
+        if (m_settings.gpuCulling)
+        {
+            recordCulling(commandBuffer, frameIdx);
+        }
+
+        // Begin Render Pass (its draws recorded in secondary command buffers with parallel recording or cached static draws)
+        bool secondaryContents = (m_settings.parallelRecording || m_settings.cacheStaticDraws);
+        VkSubpassContents subpassContents = secondaryContents ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+        vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, subpassContents);
+
+            if (m_settings.cacheStaticDraws)
+            {
+                // Static draws recorded again only if what they were recorded with has changed, dynamic ones every time
+                StaticDrawCache &staticDrawCache = m_staticDrawCaches[commandBufferIdx];
+                bool staticDrawsValid = (staticDrawCache.drawListVersion == m_drawListVersion) &&
+                                        (staticDrawCache.dynamicSetVersion == m_dynamicSetVersion) &&
+                                        (staticDrawCache.geometryGeneration == m_geometryPool.getGeneration()) &&
+                                        (staticDrawCache.pipeline == m_graphicsPipeline) &&
+                                        (staticDrawCache.framebuffer == m_swapChainFramebuffers[imageIdx]);
+                if (staticDrawsValid)
+                {
+                    m_frameStatistics.staticCacheHits++;
+                }
+                else
+                {
+                    recordDrawSet(commandBufferIdx, DrawSet::Static);
+                    staticDrawCache.drawListVersion = m_drawListVersion;
+                    staticDrawCache.dynamicSetVersion = m_dynamicSetVersion;
+                    staticDrawCache.geometryGeneration = m_geometryPool.getGeneration();
+                    staticDrawCache.pipeline = m_graphicsPipeline;
+                    staticDrawCache.framebuffer = m_swapChainFramebuffers[imageIdx];
+                    m_frameStatistics.staticCacheInvalidations++;
+                }
+                recordDrawSet(commandBufferIdx, DrawSet::Dynamic);
+
+                VkCommandBuffer secondaryCommandBuffers[] = { staticDrawCache.commandBuffer, m_dynamicCommandBuffers[commandBufferIdx] };
+                vkCmdExecuteCommands(commandBuffer, 2, secondaryCommandBuffers);
+            }
+            else if (m_settings.parallelRecording)
+            {
+                uint32_t sliceCount = static_cast<uint32_t>(m_recordingCommandPools.size());
+                recordSecondaryCommandBuffers(commandBufferIdx);
+                vkCmdExecuteCommands(commandBuffer, sliceCount, &m_secondaryCommandBuffers[commandBufferIdx * sliceCount]);
+            }
+            else
+            {
+                recordDraws(commandBuffer, frameIdx, 0, getDirectDrawCount(), true);
+            }
+
+        // End Render Pass
+        vkCmdEndRenderPass(commandBuffer);
+
+    // Stop recording to command buffer
+    result = vkEndCommandBuffer(commandBuffer);
+    if (result != VK_SUCCESS)
     {
-        renderPassBeginInfo.framebuffer = m_swapChainFramebuffers[i];
+        throw std::runtime_error("Failed to STOP recording a Command Buffer!");
+    }
 
-        // Start recording commands to command buffer!
-        VkResult result = vkBeginCommandBuffer(m_commandBuffers[i], &bufferBeginInfo);
-        if (result != VK_SUCCESS)
+    m_commandBufferModelVersion[commandBufferIdx] = m_modelVersion;
+    m_commandBufferDrawListVersion[commandBufferIdx] = m_drawListVersion;
+    m_recordedGeometryGeneration = m_geometryPool.getGeneration();
+}
+//------------------------------------------------------------------------------
+void VulkanRenderer::recordSecondaryCommandBuffers(size_t commandBufferIdx)
+{
+    size_t imageIdx = commandBufferIdx / MAX_FRAME_DRAWS;
+    size_t frameIdx = commandBufferIdx % MAX_FRAME_DRAWS;
+    uint32_t sliceCount = static_cast<uint32_t>(m_recordingCommandPools.size());
+    size_t drawCount = getDirectDrawCount();
+
+    // Executed inside the render pass of the primary command buffer (no state is inherited: each one binds its own)
+    VkCommandBufferInheritanceInfo inheritanceInfo = {};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = m_renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = m_swapChainFramebuffers[imageIdx];
+
+    VkCommandBufferBeginInfo bufferBeginInfo = {};
+    bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    if (!m_settings.recordEveryFrame)
+    {
+        bufferBeginInfo.flags |= VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;      // Like their primary (otherwise it isn't simultaneous either)
+    }
+    bufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    // One range per slice: a slice is recorded by a single thread, with the command pool of that slice only
+    // (command pools are externally synchronized). The instanced meshes go last, like in the inline recording
+    m_threadPool.parallelFor(sliceCount, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t slice = begin; slice < end; slice++)
         {
-            throw std::runtime_error("Failed to START recording a Command Buffer!");
+            VkCommandBuffer commandBuffer = m_secondaryCommandBuffers[commandBufferIdx * sliceCount + slice];
+            if (vkBeginCommandBuffer(commandBuffer, &bufferBeginInfo) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to START recording a Secondary Command Buffer!");
+            }
+
+            size_t firstDraw = drawCount * slice / sliceCount;
+            size_t drawEnd = drawCount * (slice + 1) / sliceCount;
+            recordDraws(commandBuffer, frameIdx, firstDraw, drawEnd, slice + 1 == sliceCount);
+
+            if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to STOP recording a Secondary Command Buffer!");
+            }
         }
+    });
+}
+//------------------------------------------------------------------------------
+void VulkanRenderer::recordDrawSet(size_t commandBufferIdx, DrawSet drawSet)
+{
+    size_t imageIdx = commandBufferIdx / MAX_FRAME_DRAWS;
+    size_t frameIdx = commandBufferIdx % MAX_FRAME_DRAWS;
+    VkCommandBuffer commandBuffer = (drawSet == DrawSet::Static) ? m_staticDrawCaches[commandBufferIdx].commandBuffer : m_dynamicCommandBuffers[commandBufferIdx];
+
+    VkCommandBufferInheritanceInfo inheritanceInfo = {};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = m_renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = m_swapChainFramebuffers[imageIdx];
+
+    // Executed by every recording of their primary command buffer until they are recorded again (not one time submit),
+    // never by two pending primary command buffers (not simultaneous use either)
+    VkCommandBufferBeginInfo bufferBeginInfo = {};
+    bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    bufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
 
-            // Begin Render Pass
-            vkCmdBeginRenderPass(m_commandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    if (vkBeginCommandBuffer(commandBuffer, &bufferBeginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to START recording a Secondary Command Buffer!");
+    }
 
-                // Bind Pipeline to be used in render pass
-                vkCmdBindPipeline(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+    // The instanced meshes never move: with the static draws
+    recordDraws(commandBuffer, frameIdx, 0, getDirectDrawCount(), drawSet == DrawSet::Static, drawSet);
 
-                // Loop Mesh list
-                for (size_t meshIdx = 0; meshIdx < m_meshList.size(); meshIdx++)
-                {
-                    // Bind mesh Vertex buffers
-                    VkBuffer vertexBuffers[] = { m_meshList[meshIdx].getVertexBuffer() };             // Buffers to bind
-                    VkDeviceSize offsets[] = { 0 };                                             // Offsets into buffers being bound
-                    vkCmdBindVertexBuffers(m_commandBuffers[i], 0, 1, vertexBuffers, offsets);  // Command to bind vertex buffer before drawing with them
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to STOP recording a Secondary Command Buffer!");
+    }
+}
+//------------------------------------------------------------------------------
+void VulkanRenderer::recordDraws(VkCommandBuffer commandBuffer, size_t frameIdx, size_t firstDraw, size_t drawEnd, bool instancedMeshes, DrawSet drawSet)
+{
+    // Bind Pipeline to be used in render pass
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+
+    // Only the dynamic uniform buffer path rebinds per draw: otherwise Descriptor Sets are bound once, the dynamic offset is irrelevant
+    if (m_settings.modelTransfer != ModelTransfer::DynamicUniform)
+    {
+        uint32_t dynamicOffset = 0;
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout,
+            0, 1, &m_descriptorSets[frameIdx], 1, &dynamicOffset);
+    }
 
-                    // Bind mesh Index buffer (with 0 offset and using the uint32 type)
-                    vkCmdBindIndexBuffer(m_commandBuffers[i], m_meshList[meshIdx].getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    // Bind the Vertex and Index buffers shared by all the meshes (each mesh is drawn through its offsets)
+    VkBuffer vertexBuffers[] = { m_geometryPool.getVertexBuffer() };        // Buffers to bind
+    VkDeviceSize offsets[] = { 0 };                                         // Offsets into buffers being bound
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);    // Command to bind vertex buffer before drawing with them
 
-                    // Bind Descriptor Sets
-                    vkCmdBindDescriptorSets(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout,
-                        0, 1, &m_descriptorSets[i], 0, nullptr);
+    // The Index buffer is (re)bound with the index type of the mesh to draw, whenever it changes
+    VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
 
-                    // Execute pipeline
-                    vkCmdDrawIndexed(m_commandBuffers[i], m_meshList[meshIdx].getIndexCount(), 1, 0, 0, 0);
-                }
+    if (m_settings.drawSubmission == DrawSubmission::Indirect)
+    {
+        // Meshes drawn indirectly always have uint32 indices
+        boundIndexType = VK_INDEX_TYPE_UINT32;
+        vkCmdBindIndexBuffer(commandBuffer, m_geometryPool.getIndexBuffer(), 0, boundIndexType);
+
+        // The whole scene in a single command: the draws are read from the indirect buffer of this frame in flight
+        VkBuffer drawIndirectBuffer = m_drawIndirectBuffer[frameIdx];
+        uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+        if (m_enabledFeatures.drawIndirectCount && m_enabledFeatures.multiDrawIndirect)
+        {
+            // Draw count read by the GPU too: the command buffer stays valid when meshes are added or removed
+            m_vkCmdDrawIndexedIndirectCount(commandBuffer, drawIndirectBuffer, 0, drawIndirectBuffer, DRAW_COUNT_OFFSET, MAX_CLUSTERS, stride);
+        }
+        else if (m_enabledFeatures.multiDrawIndirect)
+        {
+            vkCmdDrawIndexedIndirect(commandBuffer, drawIndirectBuffer, 0, getIndirectDrawCount(), stride);
+        }
+        else
+        {
+            // Without multiDrawIndirect drawCount must be 1
+            uint32_t drawCount = getIndirectDrawCount();
+            for (uint32_t drawIdx = 0; drawIdx < drawCount; drawIdx++)
+            {
+                vkCmdDrawIndexedIndirect(commandBuffer, drawIndirectBuffer, drawIdx * stride, 1, stride);
+            }
+        }
+    }
+    else
+    {
+        // Loop the slice of the Mesh list (only its visible meshes with CPU culling)
+        for (size_t drawIdx = firstDraw; drawIdx < drawEnd; drawIdx++)
+        {
+            size_t meshIdx = m_settings.cpuCulling ? m_visibleMeshes[drawIdx] : drawIdx;
+            if (drawSet != DrawSet::All && isMeshDynamic(meshIdx) != (drawSet == DrawSet::Dynamic))
+            {
+                continue;
+            }
 
-            // End Render Pass
-            vkCmdEndRenderPass(m_commandBuffers[i]);
+            // Bind Index buffer (with 0 offset: firstIndex counts in indices of the bound type)
+            if (m_meshList[meshIdx].getIndexType() != boundIndexType)
+            {
+                boundIndexType = m_meshList[meshIdx].getIndexType();
+                vkCmdBindIndexBuffer(commandBuffer, m_geometryPool.getIndexBuffer(), 0, boundIndexType);
+            }
 
-        // Stop recording to command buffer
-        result = vkEndCommandBuffer(m_commandBuffers[i]);
-        if (result != VK_SUCCESS)
+            if (m_settings.modelTransfer == ModelTransfer::PushConstant)
+            {
+                // "Push" the Model matrix directly into the shader (no buffer write, no descriptor rebind)
+                UboModel uboModel = m_meshList[meshIdx].getModel();
+                vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(UboModel), &uboModel);
+            }
+            else if (m_settings.modelTransfer == ModelTransfer::DynamicUniform)
+            {
+                // Dynamic Offset Amount (position of this object's Model matrix in the dynamic uniform buffer)
+                uint32_t dynamicOffset = static_cast<uint32_t>(m_modelUniformAlignment * meshIdx);
+
+                // Bind Descriptor Sets
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout,
+                    0, 1, &m_descriptorSets[frameIdx], 1, &dynamicOffset);
+            }
+
+            // Execute pipeline (indices are relative to the first vertex of the mesh, the instance index is the object index)
+            MeshLod meshLod = getSelectedLod(meshIdx);
+            vkCmdDrawIndexed(commandBuffer, meshLod.indexCount, 1,
+                meshLod.firstIndex, m_meshList[meshIdx].getVertexOffset(), static_cast<uint32_t>(meshIdx));
+        }
+    }
+
+    // Instanced meshes: a single draw each, whatever the number of instances (descriptor sets stay bound)
+    if (instancedMeshes && !m_instancedMeshList.empty())
+    {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_instancedPipeline);
+
+        // The dynamic uniform buffer path binds the sets per object only: make sure they are bound
+        if (m_settings.modelTransfer == ModelTransfer::DynamicUniform)
+        {
+            uint32_t dynamicOffset = 0;
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout,
+                0, 1, &m_descriptorSets[frameIdx], 1, &dynamicOffset);
+        }
+
+        for (auto &instancedMesh : m_instancedMeshList)
         {
-            throw std::runtime_error("Failed to STOP recording a Command Buffer!");
+            VkBuffer instancedVertexBuffers[] = { m_geometryPool.getVertexBuffer(), instancedMesh.getInstanceBuffer() };
+            VkDeviceSize instancedOffsets[] = { 0, 0 };
+            vkCmdBindVertexBuffers(commandBuffer, 0, 2, instancedVertexBuffers, instancedOffsets);
+
+            if (instancedMesh.getIndexType() != boundIndexType)
+            {
+                boundIndexType = instancedMesh.getIndexType();
+                vkCmdBindIndexBuffer(commandBuffer, m_geometryPool.getIndexBuffer(), 0, boundIndexType);
+            }
+
+            UboModel uboModel = instancedMesh.getModel();
+            vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(UboModel), &uboModel);
+
+            vkCmdDrawIndexed(commandBuffer, instancedMesh.getIndexCount(), instancedMesh.getInstanceCount(),
+                instancedMesh.getFirstIndex(), instancedMesh.getVertexOffset(), 0);
         }
     }
 }
+//------------------------------------------------------------------------------
+void VulkanRenderer::recordCulling(VkCommandBuffer commandBuffer, size_t frameIdx)
+{
+    VkBuffer drawIndirectBuffer = m_drawIndirectBuffer[frameIdx];
+
+    // Reset the draw count the visible objects are appended at
+    vkCmdFillBuffer(commandBuffer, drawIndirectBuffer, DRAW_COUNT_OFFSET, sizeof(uint32_t), 0);
+
+    // Clear -> compute shader (atomic add on the draw count)
+    VkBufferMemoryBarrier clearBarrier = {};
+    clearBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    clearBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    clearBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    clearBarrier.buffer = drawIndirectBuffer;
+    clearBarrier.offset = DRAW_COUNT_OFFSET;
+    clearBarrier.size = sizeof(uint32_t);
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+        0, nullptr, 1, &clearBarrier, 0, nullptr);
+
+    // One invocation per object (workgroups of 64, see cull.comp), which also picks its LOD, or per cluster (cull_clusters.comp)
+    CullPushConstants pushConstants = {};
+    pushConstants.objectCount = getIndirectDrawCount();
+    pushConstants.lodPixelScale = 0.5f * m_swapChainExtent.height / m_settings.lodPixelError;
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipelineLayout, 0, 1, &m_cullDescriptorSets[frameIdx], 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &pushConstants);
+    vkCmdDispatch(commandBuffer, (pushConstants.objectCount + 63) / 64, 1, 1);
+
+    // Compute shader -> indirect draws of the render pass (and the host, which reads the visible count back for the statistics)
+    VkBufferMemoryBarrier cullBarrier = clearBarrier;
+    cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+    cullBarrier.offset = 0;
+    cullBarrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0,
+        0, nullptr, 1, &cullBarrier, 0, nullptr);
+}
 
 //------------------------------------------------------------------------------
 void VulkanRenderer::getPhysicalDevice()
@@ -1019,6 +2488,12 @@ void VulkanRenderer::getPhysicalDevice()
             break;
         }
     }
+
+    // Get properties of our new device
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(m_mainDevice.physicalDevice, &deviceProperties);
+
+    m_minUniformBufferOffset = deviceProperties.limits.minUniformBufferOffsetAlignment;
 }
 
 //------------------------------------------------------------------------------
@@ -1110,6 +2585,25 @@ bool VulkanRenderer::checkDeviceExtensionSupport(VkPhysicalDevice device)
     return true;
 }
 //------------------------------------------------------------------------------
+bool VulkanRenderer::checkDeviceExtensionSupport(VkPhysicalDevice device, const char * extensionName)
+{
+    uint32_t extensionsCount = 0;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, nullptr);
+
+    std::vector<VkExtensionProperties> extensions(extensionsCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, extensions.data());
+
+    for (const auto &extension : extensions)
+    {
+        if (strcmp(extensionName, extension.extensionName) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+//------------------------------------------------------------------------------
 bool VulkanRenderer::checkValidationLayerSupport()
 {
     uint32_t validationLayerCount;
@@ -1171,6 +2665,65 @@ bool VulkanRenderer::checkDeviceSuitable(VkPhysicalDevice device)
     return indices.isValid() && extensionsSupported && swapChainValid;
 }
 
+//------------------------------------------------------------------------------
+RendererSettings VulkanRenderer::resolveSettings(const RendererSettings &requested)
+{
+    RendererSettings settings = requested;
+
+    // Clusters are culled by a compute shader too
+    if (settings.clusterCulling)
+    {
+        settings.gpuCulling = true;
+    }
+
+    // The compute shader culls already
+    if (settings.gpuCulling)
+    {
+        settings.cpuCulling = false;
+    }
+
+    // The culling compute shader writes the draws to the indirect buffer
+    if (settings.gpuCulling)
+    {
+        settings.drawSubmission = DrawSubmission::Indirect;
+    }
+
+    // Indirect draws can't push constants nor bind a dynamic offset per draw: each one reads its Model matrix by instance index
+    // (and a single draw call has nothing to record in parallel)
+    if (settings.drawSubmission == DrawSubmission::Indirect)
+    {
+        settings.modelTransfer = ModelTransfer::StorageBuffer;
+        settings.parallelRecording = false;
+        settings.cacheStaticDraws = false;
+    }
+
+    // The static draws are recorded once, the dynamic ones are expected to be few: not split across threads
+    if (settings.cacheStaticDraws)
+    {
+        settings.parallelRecording = false;
+    }
+
+    return settings;
+}
+//------------------------------------------------------------------------------
+void VulkanRenderer::checkCachedMeshSupport()
+{
+    // A cached mesh is stored with a single LOD and is drawn as a single meshlet (see Mesh(EncodedMeshData))
+    if (m_cachedMeshWarningPrinted || (m_settings.meshLodCount <= 1 && !m_settings.clusterCulling))
+    {
+        return;
+    }
+
+    if (m_settings.meshLodCount > 1)
+    {
+        cout << "WARNING: meshes from a mesh cache have a single LOD (--lods ignored for them)" << endl;
+    }
+    if (m_settings.clusterCulling)
+    {
+        cout << "WARNING: meshes from a mesh cache have no meshlets (--cluster-culling culls each of them as a whole)" << endl;
+    }
+    m_cachedMeshWarningPrinted = true;
+}
 //------------------------------------------------------------------------------
 std::vector<const char*> VulkanRenderer::getRequiredInstanceExtensions()
 {
@@ -1204,12 +2757,15 @@ QueueFamilyIndices VulkanRenderer::getQueueFamilies(VkPhysicalDevice device)
     vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilyList.data());
 
     // Go through each queue family and check if it has at least 1 of the required types of queue
+    int transferFamilyIdx = -1;
+    bool transferFamilyIsTransferOnly = false;
     uint32_t idx = 0;
     for (const auto &queueFamily : queueFamilyList)
     {
         // First check if queue family has at least 1 queue in that family (could have no queue)
         // Queue can be multiple types defined through bitfield 'queueFlags'
-        if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+        // N.B.: all the families are visited (the transfer one may come last), so keep the first valid Graphics/Presentation ones
+        if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT && indices.graphicsFamily < 0)
         {
             indices.graphicsFamily = idx;   // If queue family is valid, then get index
         }
@@ -1218,20 +2774,29 @@ QueueFamilyIndices VulkanRenderer::getQueueFamilies(VkPhysicalDevice device)
         VkBool32 presentationSupport = false;
         vkGetPhysicalDeviceSurfaceSupportKHR(device, idx, m_surface, &presentationSupport);
         // Check if queue is presentation type (it can be both presentation and graphics)
-        if (queueFamily.queueCount > 0 && presentationSupport)
+        if (queueFamily.queueCount > 0 && presentationSupport && indices.presentationFamily < 0)
         {
             indices.presentationFamily = idx;
         }
 
-        // Check if queue family indices are in a valid state, stop searching if so
-        if (indices.isValid())
+        // Look for a Transfer family that can't do graphics, so uploads can run alongside rendering:
+        // prefer transfer-only families (usually backed by the DMA engines), then any other non-graphics family
+        if (queueFamily.queueCount > 0 && (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT))
         {
-            break;
+            bool transferOnly = !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT);
+            if (transferFamilyIdx < 0 || (transferOnly && !transferFamilyIsTransferOnly))
+            {
+                transferFamilyIdx = idx;
+                transferFamilyIsTransferOnly = transferOnly;
+            }
         }
 
         idx++;
     }
 
+    // No separate family (e.g. lavapipe, many integrated GPUs): uploads go through the graphics queue
+    indices.transferFamily = (transferFamilyIdx >= 0) ? transferFamilyIdx : indices.graphicsFamily;
+
     return indices;
 }
 //------------------------------------------------------------------------------
@@ -1267,6 +2832,56 @@ SwapchainDetails VulkanRenderer::getSwapchainDetails(VkPhysicalDevice device)
 
     return swapChainDetails;
 }
+//------------------------------------------------------------------------------
+MeshLod VulkanRenderer::getSelectedLod(size_t meshIdx)
+{
+    // Not selected (yet): full resolution
+    uint32_t lod = (meshIdx < m_meshLodSelection.size()) ? m_meshLodSelection[meshIdx] : 0;
+    return m_meshList[meshIdx].getLod(lod);
+}
+//------------------------------------------------------------------------------
+size_t VulkanRenderer::getDirectDrawCount()
+{
+    return m_settings.cpuCulling ? m_visibleMeshes.size() : m_meshList.size();
+}
+//------------------------------------------------------------------------------
+bool VulkanRenderer::isMeshDynamic(size_t meshIdx)
+{
+    return (meshIdx < m_meshDynamic.size()) && (m_meshDynamic[meshIdx] != 0);
+}
+//------------------------------------------------------------------------------
+void VulkanRenderer::setMeshDynamic(size_t meshIdx)
+{
+    // Only push constants bake the Model matrices in the draws
+    if (!m_settings.cacheStaticDraws || m_settings.modelTransfer != ModelTransfer::PushConstant || isMeshDynamic(meshIdx))
+    {
+        return;
+    }
+
+    m_meshDynamic.resize(std::max(m_meshDynamic.size(), m_meshList.size()), 0);
+    m_meshDynamic[meshIdx] = 1;
+    m_dynamicSetVersion++;
+}
+//------------------------------------------------------------------------------
+uint32_t VulkanRenderer::getIndirectDrawCount()
+{
+    size_t objectCount = std::min(m_meshList.size(), static_cast<size_t>(MAX_OBJECTS));
+    if (m_settings.cpuCulling)
+    {
+        return static_cast<uint32_t>(std::min(m_visibleMeshes.size(), objectCount));
+    }
+    if (!m_settings.clusterCulling)
+    {
+        return static_cast<uint32_t>(objectCount);
+    }
+
+    size_t clusterCount = 0;
+    for (size_t meshIdx = 0; meshIdx < objectCount; meshIdx++)
+    {
+        clusterCount += m_meshList[meshIdx].getMeshletCount();
+    }
+    return static_cast<uint32_t>(std::min(clusterCount, static_cast<size_t>(MAX_CLUSTERS)));
+}
 
 //------------------------------------------------------------------------------
 VkSurfaceFormatKHR VulkanRenderer::chooseBestSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& formats)
@@ -1337,6 +2952,41 @@ VkExtent2D VulkanRenderer::chooseBestSwapExtent(const VkSurfaceCapabilitiesKHR&
         return newExtent;
     }
 }
+//------------------------------------------------------------------------------
+uint32_t VulkanRenderer::chooseMeshLod(Mesh &mesh)
+{
+    if (mesh.getLodCount() <= 1)
+    {
+        return 0;
+    }
+
+    // Distance from the camera to the bounding sphere (N.B.: same computation as cull.comp)
+    glm::mat4 model = mesh.getModel().model;
+    glm::vec4 boundingSphere = mesh.getBoundingSphere();
+    glm::vec3 viewCenter = glm::vec3(m_uboViewProjection.view * model * glm::vec4(glm::vec3(boundingSphere), 1.0f));
+    float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    float distance = glm::length(viewCenter) - boundingSphere.w * scale;
+    if (distance <= 0.0f)
+    {
+        return 0;       // Camera inside the bounding sphere
+    }
+
+    // Model space units to pixels at that distance, relative to the tolerated error
+    float lodPixelScale = 0.5f * m_swapChainExtent.height / m_settings.lodPixelError;
+    float unitToPixels = scale * std::abs(m_uboViewProjection.projection[1][1]) * lodPixelScale / distance;
+
+    // Coarsest LOD whose error stays under the tolerance on screen
+    uint32_t lod = 0;
+    for (uint32_t i = 1; i < mesh.getLodCount(); i++)
+    {
+        if (mesh.getLod(i).error * unitToPixels <= 1.0f)
+        {
+            lod = i;
+        }
+    }
+
+    return lod;
+}
 
 //------------------------------------------------------------------------------
 VkImageView VulkanRenderer::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags)
@@ -1385,5 +3035,27 @@ VkShaderModule VulkanRenderer::createShaderModule(const std::vector<char>& code)
 
     return shaderModule;
 }
+//------------------------------------------------------------------------------
+Mesh VulkanRenderer::createMesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices, bool allowShortIndices,
+                                uint32_t maxLodCount)
+{
+    // Vertices and indices are copies: the optimization reorders them in place (and the caller may share them between meshes)
+    if (m_settings.optimizeMeshes)
+    {
+        MeshOptimizer::Statistics statistics = MeshOptimizer::optimize(vertices, indices);
+        cout << "Mesh optimization: ACMR " << statistics.acmrBefore << " -> " << statistics.acmrAfter
+             << ", vertices " << statistics.vertexCountBefore << " -> " << statistics.vertexCountAfter << endl;
+    }
+
+    Mesh mesh = Mesh(&m_geometryPool, &vertices, &indices, allowShortIndices, m_settings.vertexFormat, maxLodCount);
+
+    // Clusters culled on their own (after the optimization: the meshlets follow the triangle order)
+    if (m_settings.clusterCulling)
+    {
+        mesh.buildMeshlets(vertices, indices);
+    }
+
+    return mesh;
+}
 
 #pragma warning( pop )
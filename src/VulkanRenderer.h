@@ -13,13 +13,24 @@
 // C++ STL
 #include <array>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <set>
 #include <stdexcept>
 #include <vector>
 
 // Project includes
+#include "AssetStreamer.h"
+#include "Benchmarks.h"
+#include "FrustumCuller.h"
 #include "Mesh.h"
+#include "MeshCache.h"
+#include "MeshImporter.h"
+#include "MeshOptimizer.h"
+#include "PipelineCache.h"
+#include "ThreadPool.h"
+#include "TransformHierarchy.h"
 #include "Utilities.h"
 #include "VulkanValidation.h"
 
@@ -27,6 +38,88 @@
 #pragma warning( push )
 #pragma warning(disable : 26812) // The enum type * is unscoped. Prefer 'enum class' over 'enum'.
 
+// Counters of the last frame drawn (and running totals)
+struct FrameStatistics {
+    uint64_t    frameCount = 0;
+    uint64_t    uniformBytesWritten = 0;        // Bytes written to uniform buffers by the last frame
+    uint64_t    commandBuffersRecorded = 0;     // Command buffers (re-)recorded by the last frame
+    double      recordMilliseconds = 0.0;       // CPU time of the last frame recording command buffers
+    uint64_t    staticCacheHits = 0;            // Command buffers recorded by the last frame reusing their cached static draws
+    uint64_t    staticCacheInvalidations = 0;   // Cached static draws recorded again by the last frame (first use or stale)
+    uint64_t    totalUniformBytesWritten = 0;
+    uint64_t    submittedObjects = 0;           // Objects (or clusters) given to the GPU or CPU culling (0 without it)
+    uint64_t    visibleObjects = 0;             // Objects (or clusters) that survived the culling (GPU: read back MAX_FRAME_DRAWS frames late)
+    uint64_t    selectedTriangles = 0;          // Triangles of the LODs picked on the CPU (every object, before culling; 0 with GPU culling)
+    uint64_t    streamedMeshesAdded = 0;        // Streamed meshes that became drawable in the last frame
+    uint64_t    streamingMeshesPending = 0;     // Streamed meshes requested but not drawable yet (files not read count as 1)
+};
+
+// Per-object data read by the culling compute shader (matches CullObject in cull.comp, std430)
+struct CullObject {
+    glm::vec4   boundingSphere;                 // Model space: xyz center, w radius
+    uint32_t    lodIndexCount[MAX_MESH_LODS];   // Index range of every LOD (the shader picks one from the projected size)
+    uint32_t    lodFirstIndex[MAX_MESH_LODS];
+    float       lodError[MAX_MESH_LODS];        // Model space error of every LOD (see MeshLod)
+    int32_t     vertexOffset;
+    uint32_t    lodCount;
+    uint32_t    padding[2];
+};
+
+// Per-cluster data read by the cluster culling compute shader (matches CullCluster in cull_clusters.comp, std430)
+struct CullCluster {
+    glm::vec4   boundingSphere;     // Model space: xyz center, w radius
+    glm::vec4   normalCone;         // Model space: xyz axis, w sine of the half angle (see Meshlet)
+    uint32_t    indexCount;
+    uint32_t    firstIndex;
+    int32_t     vertexOffset;
+    uint32_t    objectIndex;        // Mesh of the cluster (index of its Model matrix)
+};
+
+// Per-object normal matrix read by the cluster culling compute shader (matches NormalMatrix in cull_clusters.comp, std430):
+// computed once per object on the CPU instead of once per cluster on the GPU. Stored after the MAX_CLUSTERS CullCluster
+struct CullNormalMatrix {
+    glm::vec4   columns[3];         // transpose(inverse(mat3(Model))), w unused
+};
+
+// Push constants of the culling compute shaders
+struct CullPushConstants {
+    uint32_t    objectCount;        // Objects, or clusters
+    float       lodPixelScale;      // Half the framebuffer height over RendererSettings::lodPixelError
+};
+
+// How the per-object Model matrix reaches the vertex shader (N.B.: values match MODEL_SOURCE in shader.vert)
+enum class ModelTransfer {
+    PushConstant = 0,   // vkCmdPushConstants before every draw (baked in the command buffers: re-recorded when a Model changes)
+    DynamicUniform = 1, // Slot of the dynamic uniform buffer, selected by the dynamic offset of every draw
+    StorageBuffer = 2   // Storage buffer indexed by the instance index (firstInstance of every draw is the object index)
+};
+
+// How the draws of the scene are submitted
+enum class DrawSubmission {
+    Direct,             // One vkCmdDrawIndexed per mesh, recorded by the CPU
+    Indirect            // VkDrawIndexedIndirectCommand records in a GPU buffer, the whole scene in one vkCmdDrawIndexedIndirect(Count)
+};
+
+// Renderer options (set before init())
+struct RendererSettings {
+    ModelTransfer   modelTransfer = ModelTransfer::PushConstant;
+    DrawSubmission  drawSubmission = DrawSubmission::Direct;    // Indirect forces ModelTransfer::StorageBuffer
+    bool            gpuCulling = false;                         // Frustum culling in a compute shader (forces DrawSubmission::Indirect)
+    bool            clusterCulling = false;                     // GPU culling per meshlet, frustum and backface (forces gpuCulling, LOD 0 only)
+    bool            cpuCulling = false;                         // Frustum culling of the objects on the CPU (SIMD) before their draws are emitted (not with gpuCulling)
+    VertexFormat    vertexFormat = VertexFormat::Float;         // Layout of every mesh vertex (quantized when the meshes are created)
+    bool            optimizeMeshes = false;                     // Vertex cache/overdraw/fetch reordering of the meshes before upload
+    uint32_t        meshLodCount = 1;                           // >1: LOD chain of every (non instanced) mesh, up to MAX_MESH_LODS
+    float           lodPixelError = 1.0f;                       // Coarsest LOD whose error projects to at most this many pixels
+    std::string     meshCachePath;                              // Meshes loaded from this mesh cache instead of the built-in ones (sets vertexFormat)
+    std::string     importPath;                                 // Meshes imported from this OBJ/glTF file instead of the built-in ones
+    VkDeviceSize    streamingBytesPerFrame = 4ULL * 1024 * 1024;  // Geometry of streamed meshes staged per frame (at least one mesh)
+    bool            parallelRecording = false;                  // Direct draws recorded in secondary command buffers, a slice of the draw list per thread
+    bool            recordEveryFrame = false;                   // Command buffer of the frame recorded before every submission (transient pool per frame in flight)
+    std::string     pipelineCachePath = "pipeline_cache.bin";   // Pipeline cache of the previous launches, written back at cleanup() (empty: no file)
+    bool            cacheStaticDraws = false;                   // Draws of the meshes never moved recorded once in secondary command buffers (Direct only)
+};
+
 class VulkanRenderer
 {
 public:
@@ -34,13 +127,37 @@ public:
     ~VulkanRenderer();
 
     // API
+    void        setSettings(const RendererSettings &settings);     // Call before init()
     int         init(GLFWwindow * newWindow);
     
-    void        updateModel(glm::mat4 newModel);
+    void        updateModel(int modelId, glm::mat4 newModel);
+
+    // Node of the transform hierarchy (parentNode < 0: a root), whose world matrix becomes the Model matrix of the mesh
+    // 'modelId' (if any) at every draw() after a change of its local matrix or of one of its ancestors. Returns its id
+    // (N.B.: meant for loading; updateModel() of that mesh is overwritten by the next change). Throws if 'modelId'
+    // is already bound to another node
+    int         addTransformNode(int parentNode, glm::mat4 local, int modelId = -1);
+    void        updateTransformNode(int nodeId, glm::mat4 local);
+
+    // Loads the meshes of a mesh cache file in the background, placed with 'model': they are appended to the scene
+    // (after the meshes present then) as soon as their upload has completed, closest to the camera first
+    // within a priority. Returns immediately
+    void        streamMeshes(const std::string &filename, glm::mat4 model, int priority = 0);
+
+    // A mesh drawn 'instances->size()' times by a single draw (per-instance transform and colour). Returns its id
+    // (N.B.: waits for the device to be idle and re-records the command buffers: meant for loading, not for every frame)
+    int         addInstancedMesh(std::vector<Vertex> * vertices, std::vector<uint32_t> * indices, std::vector<InstanceData> * instances);
 
     void        draw();
     void        cleanup();
 
+    void        runBenchmarks();
+
+    const FrameStatistics & getFrameStatistics() const;
+
+    // Meshes of the scene when no mesh cache is given (also the input of the mesh cache converter)
+    static std::vector<MeshSource> getBuiltInMeshes();
+
 private:
     // GLFW Components
     GLFWwindow *                    m_pWindow = nullptr;
@@ -48,13 +165,33 @@ private:
 
     // Scene Objects
     std::vector<Mesh>               m_meshList;
+    std::vector<Mesh>               m_instancedMeshList;    // Drawn with m_instancedPipeline, one draw for all the instances
 
     // Scene Settings
-    struct MVP {
+    struct UboViewProjection {
         glm::mat4 projection;
         glm::mat4 view;
-        glm::mat4 model;
-    }                               m_mvp;                  // Model-View-Projection matrices
+    }                               m_uboViewProjection;    // View-Projection matrices (Model matrices are per Mesh)
+    uint64_t                        m_viewProjectionVersion = 1U;   // Incremented at every change of m_uboViewProjection
+    uint64_t                        m_modelVersion = 1U;            // Incremented at every change of a Mesh Model matrix
+    RendererSettings                m_settings;
+    RendererSettings                m_requestedSettings;            // As given to setSettings(), before the mode interactions and device fallbacks
+    uint64_t                        m_drawListVersion = 1U;         // Incremented at every change of m_meshList (or of the LODs drawn)
+    bool                            m_cachedMeshWarningPrinted = false;
+
+    std::vector<uint32_t>           m_meshLodSelection;             // LOD drawn for each mesh of m_meshList (CPU selection)
+    uint64_t                        m_lodSelectionModelVersion = 0U;            // m_modelVersion of the last selection
+    uint64_t                        m_lodSelectionViewProjectionVersion = 0U;   // m_viewProjectionVersion of the last selection
+
+    TransformHierarchy              m_transformHierarchy;           // Model matrices of the meshes attached to its nodes
+
+    FrustumCuller                   m_frustumCuller;                // World space bounding spheres of m_meshList (CPU culling)
+    std::vector<uint32_t>           m_visibleMeshes;                // Indices into m_meshList of the meshes drawn (CPU culling)
+    std::vector<uint32_t>           m_previousVisibleMeshes;        // Last visibility, to detect changes (no allocation per frame)
+    uint64_t                        m_cpuCullingModelVersion = 0U;          // m_modelVersion of the bounding spheres
+    uint64_t                        m_cpuCullingViewProjectionVersion = 0U; // m_viewProjectionVersion of the last culling
+
+    FrameStatistics                 m_frameStatistics;
 
     // Vulkan Components
     // - Main
@@ -66,12 +203,38 @@ private:
     }                               m_mainDevice;
     VkQueue                         m_graphicsQueue = nullptr;
     VkQueue                         m_presentationQueue = nullptr;
+    VkQueue                         m_transferQueue = nullptr;      // Uploads (dedicated family if available, otherwise the graphics queue)
+    struct {
+        bool    multiDrawIndirect = false;          // drawCount > 1 in vkCmdDrawIndexedIndirect
+        bool    drawIndirectFirstInstance = false;  // firstInstance != 0 in indirect commands
+        bool    drawIndirectCount = false;          // VK_KHR_draw_indirect_count
+    }                               m_enabledFeatures;
+    PFN_vkCmdDrawIndexedIndirectCountKHR    m_vkCmdDrawIndexedIndirectCount = nullptr;
     VkSurfaceKHR                    m_surface = 0;      // '0' instead of 'nullptr' for compatibility with 32bit version
     VkSwapchainKHR                  m_swapChain = 0;    // '0' instead of 'nullptr' for compatibility with 32bit version
 
     std::vector<SwapchainImage>     m_swapchainImages;
     std::vector<VkFramebuffer>      m_swapChainFramebuffers;
     std::vector<VkCommandBuffer>    m_commandBuffers;
+    std::vector<uint64_t>           m_commandBufferModelVersion;    // m_modelVersion baked in each command buffer (push constants)
+    std::vector<uint64_t>           m_commandBufferDrawListVersion; // m_drawListVersion baked in each command buffer (direct draws)
+    uint64_t                        m_recordedGeometryGeneration = 0U;  // m_geometryPool generation bound by the command buffers
+    std::vector<VkCommandBuffer>    m_secondaryCommandBuffers;      // Parallel recording: [command buffer][slice], executed by their primary
+
+    // Cached static draws: secondary command buffers of the meshes whose Model matrix is never baked again, recorded again
+    // only when what they were recorded with changes (N.B.: without push constants every mesh is static)
+    struct StaticDrawCache {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        uint64_t        drawListVersion = 0U;       // m_drawListVersion recorded (0: invalid)
+        uint64_t        dynamicSetVersion = 0U;     // m_dynamicSetVersion recorded
+        uint64_t        geometryGeneration = 0U;    // m_geometryPool generation bound
+        VkPipeline      pipeline = VK_NULL_HANDLE;
+        VkFramebuffer   framebuffer = VK_NULL_HANDLE;
+    };
+    std::vector<StaticDrawCache>    m_staticDrawCaches;             // One per command buffer ([image][frame])
+    std::vector<VkCommandBuffer>    m_dynamicCommandBuffers;        // Draws of the dynamic meshes, recorded with their primary
+    std::vector<uint8_t>            m_meshDynamic;                  // 1: the Model matrix of the mesh of m_meshList has changed (push constants)
+    uint64_t                        m_dynamicSetVersion = 1U;       // Incremented whenever a mesh becomes dynamic
 
     // - Descriptors
     VkDescriptorSetLayout           m_descriptorSetLayout;
@@ -79,16 +242,69 @@ private:
     VkDescriptorPool                m_descriptorPool;
     std::vector<VkDescriptorSet>    m_descriptorSets;
 
-    std::vector<VkBuffer>           m_uniformBuffer;
-    std::vector<VkDeviceMemory>     m_uniformBufferMemory;
+    std::vector<VkBuffer>           m_vpUniformBuffer;
+    std::vector<MemoryAllocation>   m_vpUniformBufferMemory;
+    std::vector<uint64_t>           m_vpUniformBufferVersion;       // m_viewProjectionVersion last written to each buffer
+
+    std::vector<VkBuffer>           m_modelDynUniformBuffer;        // MAX_OBJECTS Model matrices, m_modelUniformAlignment apart
+    std::vector<MemoryAllocation>   m_modelDynUniformBufferMemory;
+    std::vector<uint64_t>           m_modelDynUniformBufferVersion; // m_modelVersion last written to each buffer
+
+    std::vector<VkBuffer>           m_modelStorageBuffer;           // MAX_OBJECTS Model matrices, indexed by the instance index
+    std::vector<MemoryAllocation>   m_modelStorageBufferMemory;
+    std::vector<uint64_t>           m_modelStorageBufferVersion;    // m_modelVersion last written to each buffer
+
+    // Per frame in flight: objects moved by the transform hierarchy whose Model matrix is still to be written to the
+    // model buffer of that frame (the buffer version is current otherwise, see updateTransforms())
+    std::vector<std::vector<uint32_t>> m_modelDirtyObjects;
+    std::vector<uint32_t>           m_transformChangedObjects;      // Objects written by the last TransformHierarchy::update()
+
+    std::vector<VkBuffer>           m_drawIndirectBuffer;           // MAX_OBJECTS VkDrawIndexedIndirectCommand + draw count
+    std::vector<MemoryAllocation>   m_drawIndirectBufferMemory;
+    std::vector<uint64_t>           m_drawIndirectBufferVersion;    // m_drawListVersion last written to each buffer
+
+    std::vector<VkBuffer>           m_cullObjectBuffer;             // MAX_OBJECTS CullObject, or MAX_CLUSTERS CullCluster (culling input)
+    std::vector<MemoryAllocation>   m_cullObjectBufferMemory;
+    std::vector<uint64_t>           m_cullObjectBufferVersion;      // m_drawListVersion last written to each buffer
+    std::vector<uint64_t>           m_cullNormalMatrixVersion;      // m_modelVersion of the normal matrices in each buffer (cluster culling)
+
+    VkDescriptorSetLayout           m_cullDescriptorSetLayout;
+    std::vector<VkDescriptorSet>    m_cullDescriptorSets;           // One for every frame in flight
+
+    VkDeviceSize                    m_minUniformBufferOffset = 0;   // Device limit for dynamic uniform buffer offsets
+    VkDeviceSize                    m_modelUniformAlignment = 0;    // sizeof(UboModel) rounded up to m_minUniformBufferOffset
 
     // - Pipeline
     VkPipeline                      m_graphicsPipeline;
     VkPipelineLayout                m_pipelineLayout;
+    VkPipeline                      m_instancedPipeline;                    // Same as m_graphicsPipeline + per-instance vertex binding
+    VkPipeline                      m_cullPipeline = VK_NULL_HANDLE;        // Compute: frustum culling, writes the indirect draws
+    VkPipelineLayout                m_cullPipelineLayout = VK_NULL_HANDLE;
     VkRenderPass                    m_renderPass;
+    PipelineCache                   m_pipelineCache;        // Every pipeline is created through it (persisted to m_settings.pipelineCachePath)
 
     // - Pools
     VkCommandPool                   m_graphicsCommandPool;
+    VkCommandPool                   m_transferCommandPool;
+    std::vector<VkCommandPool>      m_recordingCommandPools;        // Parallel recording: one per slice (recorded by one thread at a time)
+    std::vector<VkCommandPool>      m_frameCommandPools;            // Recording every frame: one per frame in flight, reset as a whole
+
+    // - Memory
+    DeviceMemoryAllocator           m_allocator;        // Every buffer memory is sub-allocated from here
+    StagingRing                     m_stagingRing;      // Persistently mapped staging memory for uploads to the GPU
+    UploadBatcher                   m_uploadBatcher;    // Records uploads and submits them in batches (no CPU wait)
+    GeometryPool                    m_geometryPool;     // Vertex and Index buffers shared by all the meshes
+
+    // - Streaming
+    struct StreamedUpload {
+        Mesh        mesh;
+        uint64_t    uploadTicket = 0;
+    };
+    // Two pools: a frame waiting on parallelFor() never queues behind the file reads of the streaming tasks
+    ThreadPool                      m_threadPool;           // Frame work (transforms, command recording) and loading at startup
+    ThreadPool                      m_streamingThreadPool;  // Workers of the CPU side of the streaming (file reads and decoding)
+    AssetStreamer                   m_assetStreamer;        // Streamed meshes waiting to be read or uploaded
+    std::vector<StreamedUpload>     m_streamedUploads;  // Uploads in flight: drawn once their batch is complete
 
     // - Utility
     VkFormat                        m_swapChainImageFormat = VK_FORMAT_UNDEFINED;
@@ -109,6 +325,7 @@ private:
     void createRenderPass();
     void createDescriptorSetLayout();
     void createGraphicsPipeline();
+    void createCullPipeline();
     void createFramebuffers();
     void createCommandPool();
     void createCommandBuffers();
@@ -118,10 +335,29 @@ private:
     void createDescriptorPool();
     void createDescriptorSets();
 
-    void updateUniformBuffer(uint32_t imageIndex);
+    void updateUniformBuffers(uint32_t frameIndex);
+    void updateDrawIndirectCommands(uint32_t frameIndex);
+    void updateCullObjects(uint32_t frameIndex);
+    void updateCullClusters(uint32_t frameIndex);
+    void updateLodSelection();
+    void updateStreaming();
+    void updateTransforms();
+    void updateCpuCulling();
 
     // - Record Functions
     void recordCommands();
+    void recordCommandBuffer(size_t commandBufferIdx);
+    void recordSecondaryCommandBuffers(size_t commandBufferIdx);
+    // Meshes of m_meshList drawn by recordDraws()
+    enum class DrawSet {
+        All,
+        Static,             // Not dynamic (see m_meshDynamic)
+        Dynamic
+    };
+    void recordDrawSet(size_t commandBufferIdx, DrawSet drawSet);  // Static or dynamic draws, into their secondary command buffer
+    // Everything drawn inside the render pass; direct draws [firstDraw, drawEnd) of 'drawSet' only (the indirect draw is always the whole scene)
+    void recordDraws(VkCommandBuffer commandBuffer, size_t frameIdx, size_t firstDraw, size_t drawEnd, bool instancedMeshes, DrawSet drawSet = DrawSet::All);
+    void recordCulling(VkCommandBuffer commandBuffer, size_t frameIdx);
 
     // - Get Functions
     void getPhysicalDevice();
@@ -130,22 +366,34 @@ private:
     // -- Checker Functions
     bool checkInstanceExtensionSupport(std::vector<const char*> * extensionsToCheck);
     bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+    bool checkDeviceExtensionSupport(VkPhysicalDevice device, const char * extensionName);     // Single optional extension
     bool checkValidationLayerSupport();
     bool checkDeviceSuitable(VkPhysicalDevice device);
+    void checkCachedMeshSupport();  // Warns (once) about the settings a mesh cache can't honour (single LOD, no meshlets)
+    // Requested settings with the mode interactions applied (GPU culling forces indirect draws, which force the storage buffer...)
+    static RendererSettings resolveSettings(const RendererSettings &requested);
 
     // -- Getter Functions
     std::vector<const char*>    getRequiredInstanceExtensions();
     QueueFamilyIndices          getQueueFamilies(VkPhysicalDevice device);
     SwapchainDetails            getSwapchainDetails(VkPhysicalDevice device);
+    MeshLod                     getSelectedLod(size_t meshIdx);
+    size_t                      getDirectDrawCount();           // Meshes drawn by direct draws (only the visible ones with CPU culling)
+    bool                        isMeshDynamic(size_t meshIdx);
+    void                        setMeshDynamic(size_t meshIdx); // A Model matrix change (cached static draws with push constants only)
+    uint32_t                    getIndirectDrawCount();         // Commands in the indirect buffer before compaction (objects or clusters)
 
     // -- Choose Functions
     VkSurfaceFormatKHR          chooseBestSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& formats);
     VkPresentModeKHR            chooseBestPresentationMode(const std::vector<VkPresentModeKHR>& presentationModes);
     VkExtent2D                  chooseBestSwapExtent(const VkSurfaceCapabilitiesKHR &surfaceCapabilities);
+    uint32_t                    chooseMeshLod(Mesh &mesh);      // From the projected size of its error
 
     // -- Create Functions
     VkImageView                 createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
     VkShaderModule              createShaderModule(const std::vector<char> &code);
+    Mesh                        createMesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices, bool allowShortIndices,
+                                           uint32_t maxLodCount);
 };
 
 #pragma warning( pop )
@@ -3,12 +3,20 @@
 #include <GLFW/glfw3.h>
 
 // C++ STL
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
 //#include <stdexcept>
 #include <string>
 #include <vector>
 
 // Project includes
+#include "Benchmarks.h"
+#include "MeshCache.h"
+#include "MeshImporter.h"
+#include "MeshOptimizer.h"
+#include "ThreadPool.h"
 #include "VulkanRenderer.h"
 #include "Utilities.h"
 
@@ -35,8 +43,206 @@ void initWindow(std::string name = "Test Window", const int width = 1024, const
     glfwMakeContextCurrent(window);
 }
 
-int main()
+// A square grid of 'count' small quads, all drawn by a single instanced draw (after the other objects: no depth buffer yet)
+void addInstancedGrid(int count)
 {
+    // Unit quad, white: the colour comes from each instance
+    std::vector<Vertex> quadVertices = {
+        { { -0.5, -0.5, 0.0 },  { 1.0f, 1.0f, 1.0f } },
+        { { -0.5, 0.5, 0.0 },   { 1.0f, 1.0f, 1.0f } },
+        { { 0.5, 0.5, 0.0 },    { 1.0f, 1.0f, 1.0f } },
+        { { 0.5, -0.5, 0.0 },   { 1.0f, 1.0f, 1.0f } },
+    };
+    std::vector<uint32_t> quadIndices = {
+        0, 1, 2,
+        2, 3, 0
+    };
+
+    int side = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(count))));
+    float cellSize = 1.6f / side;
+
+    std::vector<InstanceData> instances(count);
+    for (int i = 0; i < count; i++)
+    {
+        float u = static_cast<float>(i % side) / side;
+        float v = static_cast<float>(i / side) / side;
+
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(-0.8f + (u * 1.6f) + cellSize * 0.5f, -0.8f + (v * 1.6f) + cellSize * 0.5f, -0.5f));
+        instances[i].transform = glm::scale(transform, glm::vec3(cellSize * 0.8f));
+        instances[i].colour = glm::vec4(u, v, 1.0f - u, 1.0f);
+    }
+
+    vulkanRenderer.addInstancedMesh(&quadVertices, &quadIndices, &instances);
+}
+
+int main(int argc, char * argv[])
+{
+    // Command line options
+    bool runBenchmarks = false;     // "--benchmark": run the performance measurements and quit
+    bool checkMeshOptimizer = false; // "--check-mesh-optimizer": CPU only check of MeshOptimizer (exit code) and quit
+    bool printStatistics = false;   // "--stats": print the renderer frame counters once per second
+    bool modelUniform = false;      // "--model-ubo": Model matrices through the dynamic uniform buffer instead of push constants
+    bool drawIndirect = false;      // "--indirect": the whole scene in one indirect draw (Model matrices through a storage buffer)
+    bool gpuCulling = false;        // "--gpu-culling": frustum culling in a compute shader, which writes the indirect draws
+    bool clusterCulling = false;    // "--cluster-culling": GPU culling per meshlet (frustum and backface)
+    bool cpuCulling = false;        // "--cpu-culling": frustum culling of the objects on the CPU (SIMD) before their draws
+    bool quantizedVertices = false; // "--quantized": snorm16 positions and unorm8 colours (12 bytes per vertex instead of 24)
+    bool optimizeMeshes = false;    // "--optimize-meshes": vertex cache/overdraw/fetch reordering of the meshes (ACMR printed)
+    bool parallelRecording = false; // "--parallel-recording": direct draws recorded in secondary command buffers, across threads
+    bool recordEveryFrame = false;  // "--record-every-frame": the command buffer recorded again before every submission
+    bool cacheStaticDraws = false;  // "--cache-static-draws": draws of the meshes never moved recorded once, in secondary command buffers
+    int instanceCount = 0;          // "--instances <count>": a grid of <count> copies of a mesh, drawn by a single instanced draw
+    int lodCount = 1;               // "--lods <count>": LOD chain of up to <count> levels per mesh, picked from the projected size
+    std::string meshCachePath;      // "--mesh-cache <file>": the meshes of the scene from a mesh cache (see MeshCache)
+    std::string importPath;         // "--import <file>": the meshes of the scene from an OBJ or glTF binary (.glb) file
+    std::string convertPath;        // "--convert <file>": writes the scene meshes to a mesh cache and quits
+    std::string streamPath;         // "--stream <file>": loads the meshes of a mesh cache in the background, while drawing
+    int streamCopies = 1;           // "--stream-copies <count>": <count> copies of the streamed meshes, one behind the other
+    std::string pipelineCachePath = "pipeline_cache.bin";   // "--pipeline-cache <file>": pipeline cache file ("": none)
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--benchmark")
+        {
+            runBenchmarks = true;
+        }
+        else if (std::string(argv[i]) == "--check-mesh-optimizer")
+        {
+            checkMeshOptimizer = true;
+        }
+        else if (std::string(argv[i]) == "--stats")
+        {
+            printStatistics = true;
+        }
+        else if (std::string(argv[i]) == "--model-ubo")
+        {
+            modelUniform = true;
+        }
+        else if (std::string(argv[i]) == "--indirect")
+        {
+            drawIndirect = true;
+        }
+        else if (std::string(argv[i]) == "--gpu-culling")
+        {
+            gpuCulling = true;
+        }
+        else if (std::string(argv[i]) == "--cluster-culling")
+        {
+            clusterCulling = true;
+        }
+        else if (std::string(argv[i]) == "--cpu-culling")
+        {
+            cpuCulling = true;
+        }
+        else if (std::string(argv[i]) == "--quantized")
+        {
+            quantizedVertices = true;
+        }
+        else if (std::string(argv[i]) == "--optimize-meshes")
+        {
+            optimizeMeshes = true;
+        }
+        else if (std::string(argv[i]) == "--parallel-recording")
+        {
+            parallelRecording = true;
+        }
+        else if (std::string(argv[i]) == "--record-every-frame")
+        {
+            recordEveryFrame = true;
+        }
+        else if (std::string(argv[i]) == "--cache-static-draws")
+        {
+            cacheStaticDraws = true;
+        }
+        else if (std::string(argv[i]) == "--instances" && i + 1 < argc)
+        {
+            instanceCount = std::max(0, std::atoi(argv[++i]));
+        }
+        else if (std::string(argv[i]) == "--lods" && i + 1 < argc)
+        {
+            lodCount = std::max(1, std::min(MAX_MESH_LODS, std::atoi(argv[++i])));
+        }
+        else if (std::string(argv[i]) == "--mesh-cache" && i + 1 < argc)
+        {
+            meshCachePath = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--import" && i + 1 < argc)
+        {
+            importPath = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--convert" && i + 1 < argc)
+        {
+            convertPath = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--stream" && i + 1 < argc)
+        {
+            streamPath = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--stream-copies" && i + 1 < argc)
+        {
+            streamCopies = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (std::string(argv[i]) == "--pipeline-cache" && i + 1 < argc)
+        {
+            pipelineCachePath = argv[++i];
+        }
+    }
+
+    // Mesh optimizer check: no window nor device, fails the process if the output is wrong
+    if (checkMeshOptimizer)
+    {
+        return Benchmarks::meshOptimizer() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Mesh cache converter: no window nor device, the meshes are encoded on the CPU
+    // (in the vertex format and index type the same options would draw them with)
+    if (!convertPath.empty())
+    {
+        std::vector<MeshSource> meshes;
+        try
+        {
+            if (!importPath.empty())
+            {
+                ThreadPool threadPool;
+                threadPool.init();
+                MeshImporter::Statistics statistics;
+                meshes = MeshImporter::import(importPath, &threadPool, &statistics);
+                MeshImporter::printStatistics(importPath, statistics);
+            }
+            else
+            {
+                meshes = VulkanRenderer::getBuiltInMeshes();
+            }
+        }
+        catch (const std::runtime_error &e)
+        {
+            cout << "ERROR: " << e.what() << endl;
+            return EXIT_FAILURE;
+        }
+
+        if (optimizeMeshes)
+        {
+            for (auto &mesh : meshes)
+            {
+                MeshOptimizer::optimize(mesh.vertices, mesh.indices);
+            }
+        }
+
+        try
+        {
+            bool allowShortIndices = !drawIndirect && !gpuCulling && !clusterCulling;
+            uint64_t fileSize = MeshCache::write(convertPath, meshes, quantizedVertices ? VertexFormat::Quantized : VertexFormat::Float,
+                                                 allowShortIndices);
+            cout << "Mesh cache '" << convertPath << "': " << meshes.size() << " meshes, " << fileSize << " bytes" << endl;
+        }
+        catch (const std::runtime_error &e)
+        {
+            cout << "ERROR: " << e.what() << endl;
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
     // Initialize Main Window
     initWindow("Vulkan Test App", 1440, 900);
 
@@ -77,15 +283,61 @@ int main()
     cout << endl;
 
     // Initialize Vulkan Renderer instance
+    RendererSettings rendererSettings;
+    rendererSettings.modelTransfer = modelUniform ? ModelTransfer::DynamicUniform : ModelTransfer::PushConstant;
+    rendererSettings.drawSubmission = drawIndirect ? DrawSubmission::Indirect : DrawSubmission::Direct;
+    rendererSettings.gpuCulling = gpuCulling;
+    rendererSettings.clusterCulling = clusterCulling;
+    rendererSettings.cpuCulling = cpuCulling;
+    rendererSettings.vertexFormat = quantizedVertices ? VertexFormat::Quantized : VertexFormat::Float;
+    rendererSettings.optimizeMeshes = optimizeMeshes;
+    rendererSettings.parallelRecording = parallelRecording;
+    rendererSettings.recordEveryFrame = recordEveryFrame;
+    rendererSettings.cacheStaticDraws = cacheStaticDraws;
+    rendererSettings.meshLodCount = static_cast<uint32_t>(lodCount);
+    rendererSettings.meshCachePath = meshCachePath;
+    rendererSettings.importPath = importPath;
+    rendererSettings.pipelineCachePath = pipelineCachePath;
+    vulkanRenderer.setSettings(rendererSettings);
     if (EXIT_FAILURE == vulkanRenderer.init(window))
     {
         return EXIT_FAILURE;
     }
 
+    if (instanceCount > 0)
+    {
+        addInstancedGrid(instanceCount);
+    }
+
+    // Requested farthest first: the streamer still uploads the closest ones first
+    if (!streamPath.empty())
+    {
+        for (int i = streamCopies - 1; i >= 0; i--)
+        {
+            vulkanRenderer.streamMeshes(streamPath, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -1.0f - i * 0.5f)));
+        }
+    }
+
+    if (runBenchmarks)
+    {
+        vulkanRenderer.runBenchmarks();
+
+        vulkanRenderer.cleanup();
+        glfwDestroyWindow(window);
+        glfwTerminate();
+
+        return EXIT_SUCCESS;
+    }
+
+    // Object 1 is attached to object 0: its rotation is relative to the one of object 0
+    int parentNode = vulkanRenderer.addTransformNode(-1, glm::mat4(1.0f), 0);
+    int childNode = vulkanRenderer.addTransformNode(parentNode, glm::mat4(1.0f), 1);
+
     // 3D Model update variables
     float angle = 0.0f;
     float deltaTime = 0.0f;
     float lastTime = 0.0f;
+    float lastStatisticsTime = 0.0f;
 
     // Main loop until window closed
     while (!glfwWindowShouldClose(window))
@@ -101,11 +353,41 @@ int main()
         angle += 10.0f * deltaTime;
         if (angle > 360.0f) { angle -= 360.0f; }
 
-        vulkanRenderer.updateModel(glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0.0f, 0.0f, 1.0f)));
+        // Local matrices: the world one of object 1 is its parent's times its own (-2 * angle, as before)
+        vulkanRenderer.updateTransformNode(parentNode, glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0.0f, 0.0f, 1.0f)));
+        vulkanRenderer.updateTransformNode(childNode, glm::rotate(glm::mat4(1.0f), glm::radians(-angle * 3.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
         /**/
 
         /* Vulkan Draw current frame */
         vulkanRenderer.draw();
+
+        /* Frame counters */
+        if (printStatistics && now - lastStatisticsTime >= 1.0f)
+        {
+            const FrameStatistics &stats = vulkanRenderer.getFrameStatistics();
+            cout    << "Frame " << stats.frameCount << ": "
+                    << stats.uniformBytesWritten << " uniform bytes written "
+                    << "(" << stats.totalUniformBytesWritten << " in total), "
+                    << stats.commandBuffersRecorded << " command buffer(s) recorded in " << stats.recordMilliseconds << " ms";
+            if (stats.staticCacheHits + stats.staticCacheInvalidations > 0)
+            {
+                cout << " (static draws: " << stats.staticCacheHits << " cached, " << stats.staticCacheInvalidations << " recorded again)";
+            }
+            if (stats.submittedObjects > 0)
+            {
+                cout << ", " << stats.visibleObjects << "/" << stats.submittedObjects << " objects (or clusters) visible";
+            }
+            if (stats.selectedTriangles > 0)
+            {
+                cout << ", " << stats.selectedTriangles << " triangles in the selected LODs";
+            }
+            if (stats.streamingMeshesPending > 0)
+            {
+                cout << ", " << stats.streamingMeshesPending << " streamed meshes pending";
+            }
+            cout << endl;
+            lastStatisticsTime = now;
+        }
     }
 
     vulkanRenderer.cleanup();